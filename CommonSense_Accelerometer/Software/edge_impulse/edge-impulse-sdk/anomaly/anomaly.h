@@ -25,8 +25,39 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <stdint.h>
 #include "model-parameters/anomaly_types.h"
+#include "edge-impulse-sdk/dsp/config.hpp"
+#if EIDSP_USE_CMSIS_DSP
+#include "edge-impulse-sdk/CMSIS/DSP/Include/arm_math.h"
+#endif
+
+/** Vectorize distance calculation over all clusters with CMSIS-DSP */
+#ifndef EI_ANOMALY_USE_CMSIS_DSP
+#define EI_ANOMALY_USE_CMSIS_DSP        EIDSP_USE_CMSIS_DSP
+#endif
+
+/** Clusters are scored in blocks of this many, centroid rows are padded to a multiple */
+#define EI_ANOMALY_SOA_LANES            4
+#define EI_ANOMALY_SOA_STRIDE(clusters) \
+    ((((clusters) + EI_ANOMALY_SOA_LANES - 1) / EI_ANOMALY_SOA_LANES) * EI_ANOMALY_SOA_LANES)
+/** Number of floats needed by ei_anomaly_soa_init */
+#define EI_ANOMALY_SOA_BUFFER_SIZE(clusters, axes) (EI_ANOMALY_SOA_STRIDE(clusters) * ((axes) + 3))
+
+/**
+ * Clusters laid out structure-of-arrays: one row per axis holding that
+ * coordinate of every centroid, so the clusters can be scored side by side.
+ */
+typedef struct {
+    size_t cluster_count;
+    size_t axis_size;
+    size_t stride;              // cluster_count rounded up to EI_ANOMALY_SOA_LANES
+    float *centroids;           // [axis_size][stride]
+    float *max_error;           // [stride], padding is -FLT_MAX so it never wins
+    float *distance;            // [stride] scratch for the CMSIS-DSP path
+    float *scratch;             // [stride] scratch for the CMSIS-DSP path
+} ei_anomaly_soa_t;
 
 #ifdef __cplusplus
 namespace {
@@ -40,44 +71,154 @@ namespace {
  * @param mean Array of mean values (obtain from StandardScaler in Python)
  * @param input_size Size of input, scale and mean arrays
  */
-void standard_scaler(float *input, const float *scale, const float *mean, size_t input_size) {
+__attribute__((unused)) void standard_scaler(float *input, const float *scale, const float *mean, size_t input_size) {
     for (size_t ix = 0; ix < input_size; ix++) {
         input[ix] = (input[ix] - mean[ix]) / scale[ix];
     }
 }
 
 /**
- * Calculate the distance between input vector and the cluster
- * @param input Array of input values (already scaled by standard_scaler)
- * @param input_size Size of the input array
- * @param cluster A cluster (number of centroids should match input_size)
+ * Lay out clusters for ei_anomaly_soa_min_distance
+ * @param soa Engine state to fill
+ * @param centroid First coordinate of the first cluster
+ * @param max_error max_error of the first cluster
+ * @param cluster_stride Number of floats from one cluster to the next
+ *        (sizeof(ei_classifier_anom_cluster_t) / sizeof(float) for the model clusters)
+ * @param cluster_count Number of clusters
+ * @param axis_size Number of coordinates per cluster
+ * @param buffer EI_ANOMALY_SOA_BUFFER_SIZE(cluster_count, axis_size) floats, kept by soa
+ */
+void ei_anomaly_soa_init(ei_anomaly_soa_t *soa, const float *centroid, const float *max_error,
+    size_t cluster_stride, size_t cluster_count, size_t axis_size, float *buffer) {
+
+    size_t stride = EI_ANOMALY_SOA_STRIDE(cluster_count);
+
+    soa->cluster_count = cluster_count;
+    soa->axis_size = axis_size;
+    soa->stride = stride;
+    soa->centroids = buffer;
+    soa->max_error = buffer + stride * axis_size;
+    soa->distance = soa->max_error + stride;
+    soa->scratch = soa->distance + stride;
+
+    for (size_t cx = 0; cx < stride; cx++) {
+        for (size_t ax = 0; ax < axis_size; ax++) {
+            soa->centroids[ax * stride + cx] = cx < cluster_count ? centroid[cx * cluster_stride + ax] : 0.0f;
+        }
+        soa->max_error[cx] = cx < cluster_count ? max_error[cx * cluster_stride] : -FLT_MAX;
+    }
+}
+
+/**
+ * Squared distance below which a cluster can still score lower than best.
+ * Rounded up by margin, so a cluster is only skipped when it certainly
+ * scores best or higher, also if its distance was summed with other rounding.
  */
-float calculate_cluster_distance(float *input, size_t input_size, const ei_classifier_anom_cluster_t *cluster) {
-    // todo: check input_size and centroid size?
+static inline float ei_anomaly_soa_limit(float best, float max_error, float margin) {
+    if (best == FLT_MAX) {
+        return FLT_MAX;
+    }
+    // sqrt(distance) - max_error >= -max_error, so nothing left to beat
+    float reach = best + max_error;
+    if (reach <= 0.0f) {
+        return 0.0f;
+    }
+    return reach * reach * margin;
+}
 
+/**
+ * Score of one cluster, sqrt(sum of pow(input - centroid, 2)) - max_error,
+ * evaluated exactly like the brute force scorer did so the result is identical
+ */
+static inline float ei_anomaly_soa_score(const ei_anomaly_soa_t *soa, const float *input, size_t cluster) {
     float dist = 0.0f;
-    for (size_t ix = 0; ix < input_size; ix++) {
-        dist += pow(input[ix] - cluster->centroid[ix], 2);
+    for (size_t ax = 0; ax < soa->axis_size; ax++) {
+        dist += pow(input[ax] - soa->centroids[ax * soa->stride + cluster], 2);
     }
-    return sqrt(dist) - cluster->max_error;
+    return sqrt(dist) - soa->max_error[cluster];
 }
 
 /**
- * Get minimum distance to a cluster
+ * Get minimum distance to a cluster: min over all clusters of
+ * (distance - max_error), the same value as scoring every cluster.
+ * Squared distances are summed in float and compared against the best score
+ * so far. A cluster is dropped as soon as its partial sum is out of reach,
+ * only clusters that may take the lead get their exact score (and sqrt).
+ * @param soa Clusters, see ei_anomaly_soa_init
  * @param input Array of input values (already scaled by standard_scaler)
- * @param input_size Size of the input array
- * @param clusters Array of clusters
- * @param cluster_size Size of cluster array
  */
-float get_min_distance_to_cluster(float *input, size_t input_size, const ei_classifier_anom_cluster_t *clusters, size_t cluster_size) {
-    float min = 1000.0f;
-    for (size_t ix = 0; ix < cluster_size; ix++) {
-        float dist = calculate_cluster_distance(input, input_size, &clusters[ix]);
-        if (dist < min) {
-            min = dist;
+float ei_anomaly_soa_min_distance(const ei_anomaly_soa_t *soa, const float *input) {
+    const size_t stride = soa->stride;
+    // worst case rounding difference between the float sums and the exact score
+    const float margin = 1.00001f + (float)(soa->axis_size + 2) * 2.4e-7f;
+    float best = FLT_MAX;
+
+#if EI_ANOMALY_USE_CMSIS_DSP == 1
+    // squared distances of all clusters at once, one axis at a time
+    arm_fill_f32(0.0f, soa->distance, stride);
+    for (size_t ax = 0; ax < soa->axis_size; ax++) {
+        arm_offset_f32(&soa->centroids[ax * stride], -input[ax], soa->scratch, stride);
+        arm_mult_f32(soa->scratch, soa->scratch, soa->scratch, stride);
+        arm_add_f32(soa->distance, soa->scratch, soa->distance, stride);
+    }
+
+    for (size_t cx = 0; cx < soa->cluster_count; cx++) {
+        if (soa->distance[cx] >= ei_anomaly_soa_limit(best, soa->max_error[cx], margin)) {
+            continue;
+        }
+        float score = ei_anomaly_soa_score(soa, input, cx);
+        if (score < best) {
+            best = score;
         }
     }
-    return min;
+#else
+    for (size_t block = 0; block < stride; block += EI_ANOMALY_SOA_LANES) {
+        float dist[EI_ANOMALY_SOA_LANES];
+        float limit[EI_ANOMALY_SOA_LANES];
+        bool reachable = false;
+
+        for (size_t lane = 0; lane < EI_ANOMALY_SOA_LANES; lane++) {
+            dist[lane] = 0.0f;
+            limit[lane] = ei_anomaly_soa_limit(best, soa->max_error[block + lane], margin);
+            reachable |= limit[lane] > 0.0f;
+        }
+        if (!reachable) {
+            continue;
+        }
+
+        for (size_t ax = 0; ax < soa->axis_size; ax++) {
+            const float *row = &soa->centroids[ax * stride + block];
+            for (size_t lane = 0; lane < EI_ANOMALY_SOA_LANES; lane++) {
+                float diff = input[ax] - row[lane];
+                dist[lane] += diff * diff;
+            }
+
+            // partial distance early exit, every few axes to keep the inner loop tight
+            if ((ax & 3) == 3) {
+                bool out_of_reach = true;
+                for (size_t lane = 0; lane < EI_ANOMALY_SOA_LANES; lane++) {
+                    out_of_reach &= dist[lane] >= limit[lane];
+                }
+                if (out_of_reach) {
+                    break;
+                }
+            }
+        }
+
+        for (size_t lane = 0; lane < EI_ANOMALY_SOA_LANES; lane++) {
+            // best may have improved on an earlier lane
+            if (dist[lane] >= ei_anomaly_soa_limit(best, soa->max_error[block + lane], margin)) {
+                continue;
+            }
+            float score = ei_anomaly_soa_score(soa, input, block + lane);
+            if (score < best) {
+                best = score;
+            }
+        }
+    }
+#endif
+
+    return best;
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,273 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _EDGE_IMPULSE_ANOMALY_BASELINE_H_
+#define _EDGE_IMPULSE_ANOMALY_BASELINE_H_
+
+#include <math.h>
+#include <float.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "edge-impulse-sdk/anomaly/anomaly.h"
+
+/**
+ * On-device anomaly baseline. Learns the normal state of one machine from
+ * the same features the exported clusters use, in three equal phases:
+ *  1. running mean and variance of the raw features (Welford), which
+ *     become the standard scaler
+ *  2. online k-means (MacQueen) on the scaled features
+ *  3. centroids fixed, max_error of every cluster is the largest distance
+ *     seen, the same definition as the exported clusters
+ * Once trained the score is min(distance - max_error) over the learned
+ * clusters. Windows that fall inside a cluster keep pulling its centroid
+ * slowly, so the baseline follows drift of a healthy machine. Each window
+ * costs O(features x clusters). Saving is left to the caller, update()
+ * only says when the state is worth saving.
+ */
+
+/** Number of clusters learned on the device */
+#ifndef EI_ANOMALY_BASELINE_CLUSTERS
+#define EI_ANOMALY_BASELINE_CLUSTERS        8
+#endif
+
+/** Windows to learn from, split over the three phases */
+#ifndef EI_ANOMALY_BASELINE_WINDOWS
+#define EI_ANOMALY_BASELINE_WINDOWS         600
+#endif
+
+/** Save the state every this many learned windows */
+#ifndef EI_ANOMALY_BASELINE_SAVE_EVERY
+#define EI_ANOMALY_BASELINE_SAVE_EVERY      100
+#endif
+
+/** Once trained, normal windows move their centroid by 1 / (1 << shift) */
+#ifndef EI_ANOMALY_BASELINE_ADAPT_SHIFT
+#define EI_ANOMALY_BASELINE_ADAPT_SHIFT     10
+#endif
+
+/** Once trained, save the state after this many centroid moves */
+#ifndef EI_ANOMALY_BASELINE_ADAPT_SAVE_EVERY
+#define EI_ANOMALY_BASELINE_ADAPT_SAVE_EVERY 1000
+#endif
+
+#define EI_ANOMALY_BASELINE_MAGIC           0x4C534241  // "ABSL"
+#define EI_ANOMALY_BASELINE_VERSION         2
+
+/** Learner state, stored as is */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t axis_size;
+    uint8_t cluster_count;
+    uint32_t windows;                           // windows learned, stops at EI_ANOMALY_BASELINE_WINDOWS
+    uint32_t adapted;                           // centroid moves since the last save request
+    float mean[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    float m2[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    float scale[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    ei_classifier_anom_cluster_t clusters[EI_ANOMALY_BASELINE_CLUSTERS];
+    uint32_t members[EI_ANOMALY_BASELINE_CLUSTERS];
+    uint32_t checksum;
+} ei_anomaly_baseline_t;
+
+/**
+ * Storage for the state, implemented by the platform
+ * @return 0 on success
+ */
+int ei_anomaly_baseline_load(void *state, size_t size);
+int ei_anomaly_baseline_save(const void *state, size_t size);
+
+#ifdef __cplusplus
+namespace {
+#endif // __cplusplus
+
+/**
+ * FNV-1a over the state, without the checksum field
+ */
+uint32_t ei_anomaly_baseline_checksum(const ei_anomaly_baseline_t *b) {
+    const uint8_t *data = (const uint8_t *)b;
+    uint32_t hash = 2166136261u;
+    for (size_t ix = 0; ix < offsetof(ei_anomaly_baseline_t, checksum); ix++) {
+        hash = (hash ^ data[ix]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Start learning from scratch
+ */
+void ei_anomaly_baseline_reset(ei_anomaly_baseline_t *b) {
+    memset(b, 0, sizeof(ei_anomaly_baseline_t));
+    b->magic = EI_ANOMALY_BASELINE_MAGIC;
+    b->version = EI_ANOMALY_BASELINE_VERSION;
+    b->axis_size = EI_CLASSIFIER_ANOM_AXIS_SIZE;
+    b->cluster_count = EI_ANOMALY_BASELINE_CLUSTERS;
+}
+
+/**
+ * Check a state read back from storage
+ */
+bool ei_anomaly_baseline_valid(const ei_anomaly_baseline_t *b) {
+    return b->magic == EI_ANOMALY_BASELINE_MAGIC
+        && b->version == EI_ANOMALY_BASELINE_VERSION
+        && b->axis_size == EI_CLASSIFIER_ANOM_AXIS_SIZE
+        && b->cluster_count == EI_ANOMALY_BASELINE_CLUSTERS
+        && b->windows <= EI_ANOMALY_BASELINE_WINDOWS
+        && b->checksum == ei_anomaly_baseline_checksum(b);
+}
+
+bool ei_anomaly_baseline_trained(const ei_anomaly_baseline_t *b) {
+    return b->windows >= EI_ANOMALY_BASELINE_WINDOWS;
+}
+
+/**
+ * Nearest cluster to scaled features, among the clusters seeded so far
+ * @param score Set to distance - max_error of that cluster
+ * @return Index of the cluster with the lowest score
+ */
+size_t ei_anomaly_baseline_nearest(const ei_anomaly_baseline_t *b, const float *scaled, size_t cluster_count, float *score) {
+    size_t nearest = 0;
+    float best = FLT_MAX;
+
+    for (size_t cx = 0; cx < cluster_count; cx++) {
+        float dist = 0.0f;
+        for (size_t ax = 0; ax < EI_CLASSIFIER_ANOM_AXIS_SIZE; ax++) {
+            float diff = scaled[ax] - b->clusters[cx].centroid[ax];
+            dist += diff * diff;
+        }
+        float s = sqrtf(dist) - b->clusters[cx].max_error;
+        if (s < best) {
+            best = s;
+            nearest = cx;
+        }
+    }
+
+    *score = best;
+    return nearest;
+}
+
+/**
+ * Score one window of features without learning from it
+ * @param features Raw features (not scaled), EI_CLASSIFIER_ANOM_AXIS_SIZE values
+ * @return Anomaly score, 0 until trained
+ */
+float ei_anomaly_baseline_score(const ei_anomaly_baseline_t *b, const float *features) {
+    float scaled[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    float score = 0.0f;
+
+    if (ei_anomaly_baseline_trained(b)) {
+        for (size_t ax = 0; ax < EI_CLASSIFIER_ANOM_AXIS_SIZE; ax++) {
+            scaled[ax] = (features[ax] - b->mean[ax]) / b->scale[ax];
+        }
+        ei_anomaly_baseline_nearest(b, scaled, EI_ANOMALY_BASELINE_CLUSTERS, &score);
+    }
+
+    return score;
+}
+
+/**
+ * Learn from, or score, one window of features
+ * @param b Learner state
+ * @param features Raw features (not scaled), EI_CLASSIFIER_ANOM_AXIS_SIZE values
+ * @param score Set to the anomaly score once trained
+ * @return true if the state should be saved
+ */
+bool ei_anomaly_baseline_update(ei_anomaly_baseline_t *b, const float *features, float *score) {
+    const uint32_t phase = EI_ANOMALY_BASELINE_WINDOWS / 3;
+    float scaled[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    size_t nearest;
+    float s;
+
+    *score = 0.0f;
+
+    if (b->windows < phase) {
+        // 1. Welford running mean and variance
+        float n = (float)(b->windows + 1);
+        for (size_t ax = 0; ax < EI_CLASSIFIER_ANOM_AXIS_SIZE; ax++) {
+            float delta = features[ax] - b->mean[ax];
+            b->mean[ax] += delta / n;
+            b->m2[ax] += delta * (features[ax] - b->mean[ax]);
+        }
+        if (b->windows + 1 == phase) {
+            for (size_t ax = 0; ax < EI_CLASSIFIER_ANOM_AXIS_SIZE; ax++) {
+                float var = phase > 1 ? b->m2[ax] / (float)(phase - 1) : 0.0f;
+                b->scale[ax] = var > 1e-12f ? sqrtf(var) : 1.0f;
+            }
+        }
+    }
+    else {
+        for (size_t ax = 0; ax < EI_CLASSIFIER_ANOM_AXIS_SIZE; ax++) {
+            scaled[ax] = (features[ax] - b->mean[ax]) / b->scale[ax];
+        }
+
+        if (b->windows < 2 * phase) {
+            // 2. online k-means, the first windows seed the clusters
+            uint32_t seen = b->windows - phase;
+            if (seen < EI_ANOMALY_BASELINE_CLUSTERS) {
+                nearest = seen;
+                memcpy(b->clusters[nearest].centroid, scaled, sizeof(scaled));
+            }
+            else {
+                nearest = ei_anomaly_baseline_nearest(b, scaled, EI_ANOMALY_BASELINE_CLUSTERS, &s);
+                float rate = 1.0f / (float)(b->members[nearest] + 1);
+                for (size_t ax = 0; ax < EI_CLASSIFIER_ANOM_AXIS_SIZE; ax++) {
+                    b->clusters[nearest].centroid[ax] += (scaled[ax] - b->clusters[nearest].centroid[ax]) * rate;
+                }
+            }
+            b->members[nearest]++;
+        }
+        else if (b->windows < EI_ANOMALY_BASELINE_WINDOWS) {
+            // 3. centroids fixed, max_error is the largest distance in the cluster
+            nearest = ei_anomaly_baseline_nearest(b, scaled, EI_ANOMALY_BASELINE_CLUSTERS, &s);
+            float dist = s + b->clusters[nearest].max_error;
+            if (dist > b->clusters[nearest].max_error) {
+                b->clusters[nearest].max_error = dist;
+            }
+        }
+        else {
+            // trained, score and follow slow drift of normal windows
+            nearest = ei_anomaly_baseline_nearest(b, scaled, EI_ANOMALY_BASELINE_CLUSTERS, score);
+            if (*score > 0.0f) {
+                return false;
+            }
+            for (size_t ax = 0; ax < EI_CLASSIFIER_ANOM_AXIS_SIZE; ax++) {
+                float diff = scaled[ax] - b->clusters[nearest].centroid[ax];
+                b->clusters[nearest].centroid[ax] += ldexpf(diff, -EI_ANOMALY_BASELINE_ADAPT_SHIFT);
+            }
+            if (++b->adapted < EI_ANOMALY_BASELINE_ADAPT_SAVE_EVERY) {
+                return false;
+            }
+            b->adapted = 0;
+            return true;
+        }
+    }
+
+    b->windows++;
+
+    return (b->windows % EI_ANOMALY_BASELINE_SAVE_EVERY) == 0 || b->windows == EI_ANOMALY_BASELINE_WINDOWS;
+}
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
+#endif // _EDGE_IMPULSE_ANOMALY_BASELINE_H_
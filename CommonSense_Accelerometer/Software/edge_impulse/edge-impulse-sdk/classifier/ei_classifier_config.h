@@ -64,5 +64,30 @@
 #endif // CPU_ARC
 #endif // EI_CLASSIFIER_TFLITE_ENABLE_ARC
 
+// Compiled models only: init and prepare the model once and keep it, instead of
+// around every inference. Best combined with EI_CLASSIFIER_ALLOCATION_STATIC.
+#ifndef EI_CLASSIFIER_PERSISTENT_INTERPRETER
+#define EI_CLASSIFIER_PERSISTENT_INTERPRETER        0
+#endif // EI_CLASSIFIER_PERSISTENT_INTERPRETER
+
+// Compiled models with a persistent interpreter and int8 input only: DSP blocks
+// quantize their features straight into the input tensor, without a float
+// feature buffer in between. Only the features anomaly detection uses stay float.
+#ifndef EI_CLASSIFIER_DSP_TO_TENSOR
+#define EI_CLASSIFIER_DSP_TO_TENSOR                 1
+#endif // EI_CLASSIFIER_DSP_TO_TENSOR
+
+// Run the DSP on int16 input in fixed point (run_classifier_i16, spectral
+// analysis through dsp/spectral/plan_q15.hpp). Follows the exported model
+// (model_metadata.h) unless set at build time.
+#ifndef EI_CLASSIFIER_QUANTIZED_DSP
+#define EI_CLASSIFIER_QUANTIZED_DSP                 EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK
+#endif // EI_CLASSIFIER_QUANTIZED_DSP
+
+// Learn the anomaly baseline on the device, see anomaly_baseline.h
+#ifndef EI_CLASSIFIER_ANOMALY_BASELINE
+#define EI_CLASSIFIER_ANOMALY_BASELINE              0
+#endif // EI_CLASSIFIER_ANOMALY_BASELINE
+
 // clang-format on
 #endif // _EI_CLASSIFIER_CONFIG_H_
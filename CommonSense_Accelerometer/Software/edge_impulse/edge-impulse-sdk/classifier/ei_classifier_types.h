@@ -48,6 +48,7 @@ typedef struct {
     int64_t dsp_us;
     int64_t classification_us;
     int64_t anomaly_us;
+    int64_t classification_setup_us;    // part of classification_us spent on model init/prepare and teardown
 } ei_impulse_result_timing_t;
 
 typedef struct {
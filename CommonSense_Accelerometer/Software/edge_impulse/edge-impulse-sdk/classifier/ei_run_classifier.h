@@ -24,12 +24,16 @@
 #define _EDGE_IMPULSE_RUN_CLASSIFIER_H_
 
 #include "model-parameters/model_metadata.h"
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
 #if EI_CLASSIFIER_HAS_MODEL_VARIABLES == 1
 #include "model-parameters/model_variables.h"
 #endif
 
 #if EI_CLASSIFIER_HAS_ANOMALY == 1
 #include "model-parameters/anomaly_clusters.h"
+#if EI_CLASSIFIER_ANOMALY_BASELINE == 1
+#include "edge-impulse-sdk/anomaly/anomaly_baseline.h"
+#endif
 #endif
 #include "ei_run_dsp.h"
 #include "ei_classifier_types.h"
@@ -39,6 +43,7 @@
 #include "ei_sampler.h"
 #endif
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "edge-impulse-sdk/dsp/ei_profiler.h"
 #include "model-parameters/dsp_blocks.h"
 
 #if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED != 1)
@@ -120,6 +125,9 @@ static EI_IMPULSE_ERROR can_run_classifier_image_quantized();
 static void calc_cepstral_mean_and_var_normalization_mfcc(ei_matrix *matrix, void *config_ptr);
 static void calc_cepstral_mean_and_var_normalization_mfe(ei_matrix *matrix, void *config_ptr);
 static void calc_cepstral_mean_and_var_normalization_spectrogram(ei_matrix *matrix, void *config_ptr);
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_PERSISTENT_INTERPRETER == 1)
+static EI_IMPULSE_ERROR inference_tflite_init_persistent(void);
+#endif
 
 /* Private variables ------------------------------------------------------- */
 #if EI_CLASSIFIER_LABEL_COUNT > 0
@@ -130,8 +138,140 @@ ei_impulse_maf classifier_maf[0];
 
 static uint64_t classifier_continuous_features_written = 0;
 
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+static float anomaly_soa_buffer[EI_ANOMALY_SOA_BUFFER_SIZE(EI_CLASSIFIER_ANOM_CLUSTER_COUNT, EI_CLASSIFIER_ANOM_AXIS_SIZE)];
+static ei_anomaly_soa_t anomaly_soa = { 0 };
+#if EI_CLASSIFIER_ANOMALY_BASELINE == 1
+static ei_anomaly_baseline_t anomaly_baseline;
+static bool anomaly_baseline_loaded = false;
+static bool anomaly_baseline_held = false;
+static bool anomaly_baseline_unsaved = false;
+#endif
+#endif
+
 /* Private functions ------------------------------------------------------- */
 
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+/**
+ * @brief      Anomaly score of the scaled input against the model clusters.
+ *             The clusters are laid out for ei_anomaly_soa_min_distance on
+ *             first use.
+ *
+ * @param      input  Array of EI_CLASSIFIER_ANOM_AXIS_SIZE values (already scaled by standard_scaler)
+ *
+ * @return     Minimum distance to a cluster
+ */
+static float run_anomaly_score(const float *input)
+{
+    if (anomaly_soa.cluster_count == 0) {
+        ei_anomaly_soa_init(&anomaly_soa,
+            &ei_classifier_anom_clusters[0].centroid[0], &ei_classifier_anom_clusters[0].max_error,
+            sizeof(ei_classifier_anom_cluster_t) / sizeof(float),
+            EI_CLASSIFIER_ANOM_CLUSTER_COUNT, EI_CLASSIFIER_ANOM_AXIS_SIZE, anomaly_soa_buffer);
+    }
+
+    return ei_anomaly_soa_min_distance(&anomaly_soa, input);
+}
+
+#if EI_CLASSIFIER_ANOMALY_BASELINE == 1
+/**
+ * @brief      Load the baseline from storage, or start a new one
+ */
+static void run_anomaly_baseline_load(void)
+{
+    if (ei_anomaly_baseline_load(&anomaly_baseline, sizeof(anomaly_baseline)) != 0
+        || !ei_anomaly_baseline_valid(&anomaly_baseline)) {
+        ei_anomaly_baseline_reset(&anomaly_baseline);
+    }
+    anomaly_baseline_loaded = true;
+}
+
+/**
+ * @brief      Feed the raw anomaly features to the on-device baseline. Saving
+ *             is only flagged here, run_anomaly_baseline_save_pending() does
+ *             it outside of inference.
+ *
+ * @param      input  Array of EI_CLASSIFIER_ANOM_AXIS_SIZE values (not scaled)
+ * @param      score  Anomaly score against the baseline, once trained
+ * @param[in]  learn  false to only score, e.g. for debug runs
+ *
+ * @return     true if the baseline is trained and score is valid
+ */
+static bool run_anomaly_baseline(const float *input, float *score, bool learn)
+{
+    if (!anomaly_baseline_loaded) {
+        run_anomaly_baseline_load();
+    }
+
+    bool trained = ei_anomaly_baseline_trained(&anomaly_baseline);
+
+    if (!learn || anomaly_baseline_held) {
+        *score = ei_anomaly_baseline_score(&anomaly_baseline, input);
+    }
+    else if (ei_anomaly_baseline_update(&anomaly_baseline, input, score)) {
+        anomaly_baseline_unsaved = true;
+    }
+
+    return trained;
+}
+#endif
+
+/**
+ * @brief      Anomaly detection over the features EI_CLASSIFIER_ANOM_AXIS selects
+ *
+ * @param      input    EI_CLASSIFIER_ANOM_AXIS_SIZE features, scaled in place
+ * @param      result   Output classifier results, anomaly and its timing are set
+ * @param[in]  debug    Debug output enable
+ */
+static void run_anomaly_detection_axes(float *input, ei_impulse_result_t *result, bool debug)
+{
+    uint64_t anomaly_start_us = ei_read_timer_us();
+    EI_PROFILER_STAGE_BEGIN(anomaly_mark);
+
+#if EI_CLASSIFIER_ANOMALY_BASELINE == 1
+    float baseline_score;
+    bool baseline_trained = run_anomaly_baseline(input, &baseline_score, !debug);
+#endif
+    standard_scaler(input, ei_classifier_anom_scale, ei_classifier_anom_mean, EI_CLASSIFIER_ANOM_AXIS_SIZE);
+    float anomaly = run_anomaly_score(input);
+#if EI_CLASSIFIER_ANOMALY_BASELINE == 1
+    if (baseline_trained) {
+        anomaly = baseline_score;
+    }
+#endif
+
+    EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_ANOMALY, anomaly_mark);
+    uint64_t anomaly_end_us = ei_read_timer_us();
+
+    result->timing.anomaly_us = anomaly_end_us - anomaly_start_us;
+    result->timing.anomaly = (int)(result->timing.anomaly_us / 1000);
+    result->anomaly = anomaly;
+
+    if (debug) {
+        ei_printf("Anomaly score (time: %d ms.): ", result->timing.anomaly);
+        ei_printf_float(anomaly);
+        ei_printf("\n");
+    }
+}
+
+/**
+ * @brief      Anomaly detection over the processed feature matrix
+ *
+ * @param      fmatrix  Processed matrix (one window)
+ * @param      result   Output classifier results, anomaly and its timing are set
+ * @param[in]  debug    Debug output enable
+ */
+static void run_anomaly_detection(ei::matrix_t *fmatrix, ei_impulse_result_t *result, bool debug)
+{
+    float input[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    for (size_t ix = 0; ix < EI_CLASSIFIER_ANOM_AXIS_SIZE; ix++) {
+        input[ix] = fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]];
+    }
+
+    run_anomaly_detection_axes(input, result, debug);
+}
+#endif
+
 /**
  * @brief      Run a moving average filter over the classification result.
  *             The size of the filter determines the response of the filter.
@@ -173,18 +313,83 @@ static void clear_moving_average_filter(ei_impulse_maf *maf)
 }
 
 /**
- * @brief      Init static vars
+ * @brief      Init static vars and set up the FFT plans for the model's FFT
+ *             lengths. With EI_CLASSIFIER_PERSISTENT_INTERPRETER the compiled
+ *             model is also prepared here, if it was not yet.
  */
 extern "C" void run_classifier_init(void)
 {
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_PERSISTENT_INTERPRETER == 1)
+    inference_tflite_init_persistent();
+#endif
+
     classifier_continuous_features_written = 0;
     ei_dsp_clear_continuous_audio_state();
+    ei_dsp_clear_continuous_spectral_state();
+
+    // not fatal, an FFT whose plan is missing sets itself up on first use
+    int ret = ei::numpy::preload_fft_plans();
+    if (ret != EIDSP_OK) {
+        ei_printf("ERR: Failed to set up the FFT plans (%d)\n", ret);
+    }
 
     for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
         clear_moving_average_filter(&classifier_maf[ix]);
     }
 }
 
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+/**
+ * @brief      State of the on-device anomaly baseline
+ */
+extern "C" const ei_anomaly_baseline_t *run_anomaly_baseline_state(void)
+{
+    if (!anomaly_baseline_loaded) {
+        run_anomaly_baseline_load();
+    }
+    return &anomaly_baseline;
+}
+
+/**
+ * @brief      Forget the baseline and start learning again
+ */
+extern "C" void run_anomaly_baseline_reset(void)
+{
+    ei_anomaly_baseline_reset(&anomaly_baseline);
+    anomaly_baseline.checksum = ei_anomaly_baseline_checksum(&anomaly_baseline);
+    ei_anomaly_baseline_save(&anomaly_baseline, sizeof(anomaly_baseline));
+    anomaly_baseline_loaded = true;
+    anomaly_baseline_unsaved = false;
+}
+
+/**
+ * @brief      While held the baseline scores windows but does not learn from
+ *             them, e.g. during a benchmark that runs the same window many times
+ */
+extern "C" void run_anomaly_baseline_hold(bool hold)
+{
+    anomaly_baseline_held = hold;
+}
+
+/**
+ * @brief      Save the baseline if learning asked for it. Storage can be slow,
+ *             so call this between inferences, not from inside them.
+ *
+ * @return     0 if there was nothing to save or saving succeeded
+ */
+extern "C" int run_anomaly_baseline_save_pending(void)
+{
+    if (!anomaly_baseline_unsaved) {
+        return 0;
+    }
+
+    anomaly_baseline_unsaved = false;
+    anomaly_baseline.checksum = ei_anomaly_baseline_checksum(&anomaly_baseline);
+
+    return ei_anomaly_baseline_save(&anomaly_baseline, sizeof(anomaly_baseline));
+}
+#endif
+
 /**
  * @brief      Fill the complete matrix with sample slices. From there, run inference
  *             on the matrix.
@@ -192,7 +397,11 @@ extern "C" void run_classifier_init(void)
  * @param      signal  Sample data
  * @param      result  Classification output
  * @param[in]  debug   Debug output enable boot
- * @param      enable_maf Enables the moving average filter
+ * @param      enable_maf Enables the moving average filter (default): every
+ *             classification value is averaged over the last
+ *             EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW / 2 results, the anomaly
+ *             score is not. Without it the result is the one run_classifier
+ *             gives for the last window.
  *
  * @return     The ei impulse error.
  */
@@ -239,8 +448,12 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(signal_t *signal, ei_impul
             extract_fn_slice = &extract_mfe_per_slice_features;
             is_mfe = true;
         }
+        else if (block.extract_fn == static_cast<int (*)(ei::signal_t*, ei::matrix_t*, void*, const float)>(
+                &extract_spectral_analysis_features)) {
+            extract_fn_slice = &extract_spectral_analysis_per_slice_features;
+        }
         else {
-            ei_printf("ERR: Unknown extract function, only MFCC, MFE and spectrogram supported\n");
+            ei_printf("ERR: Unknown extract function, only MFCC, MFE, spectrogram and spectral analysis supported\n");
             return EI_IMPULSE_DSP_ERROR;
         }
 
@@ -584,6 +797,36 @@ __attribute__((unused)) static void fill_result_struct_f32(ei_impulse_result_t *
 
 #if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE)
 
+/** Time spent in the last inference_tflite_setup */
+static uint64_t tflite_setup_us = 0;
+
+#if (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_PERSISTENT_INTERPRETER == 1)
+static bool tflite_model_initialized = false;
+
+/**
+ * Init and prepare the compiled model, once. It stays in place for every
+ * following inference.
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR inference_tflite_init_persistent(void)
+{
+    if (tflite_model_initialized) {
+        return EI_IMPULSE_OK;
+    }
+
+    TfLiteStatus init_status = trained_model_init(ei_aligned_calloc);
+    if (init_status != kTfLiteOk) {
+        ei_printf("Failed to allocate TFLite arena (error code %d)\n", init_status);
+        trained_model_reset(ei_aligned_free);
+        return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+    }
+
+    tflite_model_initialized = true;
+    return EI_IMPULSE_OK;
+}
+#endif
+
 /**
  * Setup the TFLite runtime
  *
@@ -604,7 +847,14 @@ static EI_IMPULSE_ERROR inference_tflite_setup(uint64_t *ctx_start_us, TfLiteTen
     tflite::MicroInterpreter** micro_interpreter,
 #endif
     uint8_t** micro_tensor_arena) {
-#if (EI_CLASSIFIER_COMPILED == 1)
+    *ctx_start_us = ei_read_timer_us();
+
+#if (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_PERSISTENT_INTERPRETER == 1)
+    EI_IMPULSE_ERROR init_res = inference_tflite_init_persistent();
+    if (init_res != EI_IMPULSE_OK) {
+        return init_res;
+    }
+#elif (EI_CLASSIFIER_COMPILED == 1)
     TfLiteStatus init_status = trained_model_init(ei_aligned_calloc);
     if (init_status != kTfLiteOk) {
         ei_printf("Failed to allocate TFLite arena (error code %d)\n", init_status);
@@ -620,8 +870,6 @@ static EI_IMPULSE_ERROR inference_tflite_setup(uint64_t *ctx_start_us, TfLiteTen
     *micro_tensor_arena = tensor_arena;
 #endif
 
-    *ctx_start_us = ei_read_timer_us();
-
     static bool tflite_first_run = true;
 
 #if (EI_CLASSIFIER_COMPILED != 1)
@@ -711,13 +959,67 @@ static EI_IMPULSE_ERROR inference_tflite_setup(uint64_t *ctx_start_us, TfLiteTen
 #endif
         tflite_first_run = false;
     }
+
+    tflite_setup_us = ei_read_timer_us() - *ctx_start_us;
+
     return EI_IMPULSE_OK;
 }
 
+/**
+ * Copy the features into the input tensor, quantize if it is int8
+ *
+ * @param   input           Input tensor
+ * @param   fmatrix         Processed matrix
+ */
+__attribute__((unused)) static void inference_tflite_fill_input(TfLiteTensor *input, ei::matrix_t *fmatrix) {
+    bool int8_input = input->type == TfLiteType::kTfLiteInt8;
+    for (size_t ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
+        // Quantize the input if it is int8
+        if (int8_input) {
+            input->data.int8[ix] = static_cast<int8_t>(round(fmatrix->buffer[ix] / input->params.scale) + input->params.zero_point);
+        } else {
+            input->data.f[ix] = fmatrix->buffer[ix];
+        }
+    }
+}
+
+/**
+ * Copy q15 features (value * 32768 in 32 bit, see run_classifier_i16) into the
+ * input tensor. int8 inputs are quantized with an integer multiplier, which is
+ * only worked out again when the input scale changes.
+ *
+ * @param   input           Input tensor
+ * @param   fmatrix         Processed matrix
+ */
+__attribute__((unused)) static void inference_tflite_fill_input_i32(TfLiteTensor *input, ei::matrix_i32_t *fmatrix) {
+    static float multiplier_scale = 0.0f;
+    static int32_t multiplier_mantissa;
+    static int multiplier_shift;
+
+    if (input->type == TfLiteType::kTfLiteInt8) {
+        if (input->params.scale != multiplier_scale) {
+            numpy::quantize_multiplier(1.0f / (input->params.scale * 32768.0f), &multiplier_mantissa, &multiplier_shift);
+            multiplier_scale = input->params.scale;
+        }
+
+        for (size_t ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
+            int32_t v = numpy::multiply_by_quantized_multiplier(fmatrix->buffer[ix],
+                multiplier_mantissa, multiplier_shift);
+            input->data.int8[ix] = static_cast<int8_t>(numpy::saturate((int64_t)v + input->params.zero_point, 8));
+        }
+    } else {
+        for (size_t ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
+            input->data.f[ix] = (float)fmatrix->buffer[ix] / 32768.f;
+        }
+    }
+}
+
 /**
  * Run TFLite model
  *
- * @param   ctx_start_us    Start time of the setup function (see above)
+ * @param   ctx_start_us    Start time of the setup function (see above), the
+ *                          time spent in setup and teardown is reported in
+ *                          result->timing.classification_setup_us
  * @param   output          Output tensor
  * @param   interpreter     TFLite interpreter (non-compiled models)
  * @param   tensor_arena    Allocated arena (will be freed)
@@ -738,6 +1040,7 @@ static EI_IMPULSE_ERROR inference_tflite_run(uint64_t ctx_start_us,
     uint8_t* tensor_arena,
     ei_impulse_result_t *result,
     bool debug) {
+    EI_PROFILER_STAGE_BEGIN(invoke_mark);
 #if (EI_CLASSIFIER_COMPILED == 1)
     trained_model_invoke();
 #else
@@ -750,6 +1053,7 @@ static EI_IMPULSE_ERROR inference_tflite_run(uint64_t ctx_start_us,
     }
     delete interpreter;
 #endif
+    EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_INVOKE, invoke_mark);
 
     uint64_t ctx_end_us = ei_read_timer_us();
 
@@ -758,7 +1062,7 @@ static EI_IMPULSE_ERROR inference_tflite_run(uint64_t ctx_start_us,
 
     // Read the predicted y value from the model's output tensor
     if (debug) {
-        ei_printf("Predictions (time: %d ms.):\n", result->timing.classification);
+        ei_printf("Predictions (time: %d ms., setup: %d us.):\n", result->timing.classification, (int)tflite_setup_us);
     }
 
 #if EI_CLASSIFIER_OBJECT_DETECTION_CONSTRAINED == 1
@@ -784,12 +1088,18 @@ static EI_IMPULSE_ERROR inference_tflite_run(uint64_t ctx_start_us,
     }
 #endif
 
-#if (EI_CLASSIFIER_COMPILED == 1)
+    uint64_t teardown_start_us = ei_read_timer_us();
+
+#if (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_PERSISTENT_INTERPRETER == 1)
+    // model stays prepared for the next inference
+#elif (EI_CLASSIFIER_COMPILED == 1)
     trained_model_reset(ei_aligned_free);
 #else
     ei_aligned_free(tensor_arena);
 #endif
 
+    result->timing.classification_setup_us = tflite_setup_us + (ei_read_timer_us() - teardown_start_us);
+
     if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
         return EI_IMPULSE_CANCELED;
     }
@@ -856,16 +1166,9 @@ extern "C" EI_IMPULSE_ERROR run_inference(
             }
         }
 #else
-        bool int8_input = input->type == TfLiteType::kTfLiteInt8;
-        for (size_t ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
-            // Quantize the input if it is int8
-            if (int8_input) {
-                input->data.int8[ix] = static_cast<int8_t>(round(fmatrix->buffer[ix] / input->params.scale) + input->params.zero_point);
-                // printf("float %ld : %d\r\n", ix, input->data.int8[ix]);
-            } else {
-                input->data.f[ix] = fmatrix->buffer[ix];
-            }
-        }
+        EI_PROFILER_STAGE_BEGIN(quantize_mark);
+        inference_tflite_fill_input(input, fmatrix);
+        EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_QUANTIZE, quantize_mark);
 #endif
 
 #if (EI_CLASSIFIER_COMPILED == 1)
@@ -1111,32 +1414,7 @@ extern "C" EI_IMPULSE_ERROR run_inference(
 #endif
 
 #if EI_CLASSIFIER_HAS_ANOMALY == 1
-
-    // Anomaly detection
-    {
-        uint64_t anomaly_start_us = ei_read_timer_us();
-
-        float input[EI_CLASSIFIER_ANOM_AXIS_SIZE];
-        for (size_t ix = 0; ix < EI_CLASSIFIER_ANOM_AXIS_SIZE; ix++) {
-            input[ix] = fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]];
-        }
-        standard_scaler(input, ei_classifier_anom_scale, ei_classifier_anom_mean, EI_CLASSIFIER_ANOM_AXIS_SIZE);
-        float anomaly = get_min_distance_to_cluster(
-            input, EI_CLASSIFIER_ANOM_AXIS_SIZE, ei_classifier_anom_clusters, EI_CLASSIFIER_ANOM_CLUSTER_COUNT);
-
-        uint64_t anomaly_end_us = ei_read_timer_us();
-
-        result->timing.anomaly_us = anomaly_end_us - anomaly_start_us;
-        result->timing.anomaly = (int)(result->timing.anomaly_us / 1000);
-        result->anomaly = anomaly;
-
-        if (debug) {
-            ei_printf("Anomaly score (time: %d ms.): ", result->timing.anomaly);
-            ei_printf_float(anomaly);
-            ei_printf("\n");
-        }
-    }
-
+    run_anomaly_detection(fmatrix, result, debug);
 #endif
 
     if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
@@ -1157,7 +1435,7 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
 
 #if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE)
     {
-        uint64_t ctx_start_us;
+        uint64_t ctx_start_us = ei_read_timer_us();
         TfLiteTensor* input;
         TfLiteTensor* output;
         uint8_t* tensor_arena;
@@ -1175,23 +1453,10 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
             return init_res;
         }
 
-        EIDSP_i16 scale;
-        numpy::float_to_int16(&input->params.scale, &scale, 1);
-
         // Place our calculated x value in the model's input tensor
-        bool int8_input = input->type == TfLiteType::kTfLiteInt8;
-        for (size_t ix = 0; ix < fmatrix->rows * fmatrix->cols; ix++) {
-            // Quantize the input if it is int8
-            if (int8_input) {
-                int32_t calc = (int32_t)fmatrix->buffer[ix] << 8; // Shift for scaler
-                calc /= scale;
-                calc += 0x80; // Round by adding 0.5
-                calc >>= 8; // Shift to int8_t domain
-                input->data.int8[ix] = static_cast<int8_t>(calc + input->params.zero_point);
-            } else {
-                numpy::int16_to_float((EIDSP_i16 *)&fmatrix->buffer[ix], &input->data.f[ix], 1);
-            }
-        }
+        EI_PROFILER_STAGE_BEGIN(quantize_mark);
+        inference_tflite_fill_input_i32(input, fmatrix);
+        EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_QUANTIZE, quantize_mark);
 
 #if (EI_CLASSIFIER_COMPILED == 1)
         EI_IMPULSE_ERROR run_res = inference_tflite_run(ctx_start_us, output,
@@ -1201,6 +1466,8 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
             interpreter, tensor_arena, result, debug);
 #endif
 
+        result->timing.classification_us = ei_read_timer_us() - ctx_start_us;
+
         if (run_res != EI_IMPULSE_OK) {
             return run_res;
         }
@@ -1215,33 +1482,168 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
 
 #if EI_CLASSIFIER_HAS_ANOMALY == 1
 
-    // Anomaly detection
+    // Anomaly detection, only the selected features go back to float
     {
-        uint64_t anomaly_start_us = ei_read_timer_us();
-
         float input[EI_CLASSIFIER_ANOM_AXIS_SIZE];
         for (size_t ix = 0; ix < EI_CLASSIFIER_ANOM_AXIS_SIZE; ix++) {
-            // input[ix] = fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]];
-            // numpy::int16_to_float(&fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]], &input[ix], 1);
             input[ix] = (float)fmatrix->buffer[EI_CLASSIFIER_ANOM_AXIS[ix]] / 32768.f;
         }
-        standard_scaler(input, ei_classifier_anom_scale, ei_classifier_anom_mean, EI_CLASSIFIER_ANOM_AXIS_SIZE);
-        float anomaly = get_min_distance_to_cluster(
-            input, EI_CLASSIFIER_ANOM_AXIS_SIZE, ei_classifier_anom_clusters, EI_CLASSIFIER_ANOM_CLUSTER_COUNT);
 
-        uint64_t anomaly_end_us = ei_read_timer_us();
+        run_anomaly_detection_axes(input, result, debug);
+    }
+
+#endif
 
-        result->timing.anomaly_us = anomaly_end_us - anomaly_start_us;
-        result->timing.anomaly = (int)(result->timing.anomaly_us / 1000);
-        result->anomaly = anomaly;
+    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+        return EI_IMPULSE_CANCELED;
+    }
 
-        if (debug) {
-            ei_printf("Anomaly score (time: %d ms.): ", result->timing.anomaly);
-            ei_printf_float(anomaly);
-            ei_printf("\n");
+    return EI_IMPULSE_OK;
+#endif // OBJECT_DETECTION
+}
+
+/**
+ * @brief      Run all DSP blocks over one window
+ *
+ * @param      signal    Sample data
+ * @param      features  Output, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE features
+ * @param      result    DSP timing is set here
+ * @param[in]  debug     Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+static EI_IMPULSE_ERROR run_dsp_blocks(
+    signal_t *signal,
+    ei::feature_sink_t *features,
+    ei_impulse_result_t *result,
+    bool debug)
+{
+    uint64_t dsp_start_us = ei_read_timer_us();
+
+    int (*spectral_fn)(ei::signal_t*, ei::matrix_t*, void*, const float) = &extract_spectral_analysis_features;
+    size_t out_features_index = 0;
+
+    for (size_t ix = 0; ix < ei_dsp_blocks_size; ix++) {
+        ei_model_dsp_t block = ei_dsp_blocks[ix];
+
+        if (out_features_index + block.n_output_features > features->size) {
+            ei_printf("ERR: Would write outside feature buffer\n");
+            return EI_IMPULSE_DSP_ERROR;
+        }
+
+        ei::feature_sink_t block_features = features->slice(out_features_index, block.n_output_features);
+
+#if EIDSP_SIGNAL_C_FN_POINTER
+        if (block.axes_size != EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME) {
+            ei_printf("ERR: EIDSP_SIGNAL_C_FN_POINTER can only be used when all axes are selected for DSP blocks\n");
+            return EI_IMPULSE_DSP_ERROR;
+        }
+        signal_t *block_signal = signal;
+#else
+        SignalWithAxes swa(signal, block.axes, block.axes_size);
+        signal_t *block_signal = swa.get_signal();
+#endif
+
+        int ret;
+        if (block.extract_fn == spectral_fn) {
+            // writes into the sink axis by axis
+            ret = extract_spectral_analysis_features(block_signal, &block_features, block.config, EI_CLASSIFIER_FREQUENCY);
+        }
+        else {
+            // other blocks go through a float matrix, in place for float sinks
+            ei::matrix_t fm(1, block.n_output_features, block_features.buffer);
+            if (!fm.buffer) {
+                return EI_IMPULSE_ALLOC_FAILED;
+            }
+            ret = block.extract_fn(block_signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY);
+            if (ret == EIDSP_OK && !block_features.write(0, fm.buffer, block.n_output_features)) {
+                ret = EIDSP_OUT_OF_BOUNDS;
+            }
         }
+
+        if (ret != EIDSP_OK) {
+            ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
+            return EI_IMPULSE_DSP_ERROR;
+        }
+
+        if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+            return EI_IMPULSE_CANCELED;
+        }
+
+        out_features_index += block.n_output_features;
+    }
+
+    result->timing.dsp_us = ei_read_timer_us() - dsp_start_us;
+    result->timing.dsp = (int)(result->timing.dsp_us / 1000);
+
+    if (debug) {
+        ei_printf("Features (%d ms.): ", result->timing.dsp);
+        for (size_t ix = 0; ix < features->size; ix++) {
+            ei_printf_float(features->get(ix));
+            ei_printf(" ");
+        }
+        ei_printf("\n");
     }
 
+    return EI_IMPULSE_OK;
+}
+
+#if (EI_CLASSIFIER_DSP_TO_TENSOR == 1) && (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && \
+    (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_PERSISTENT_INTERPRETER == 1) && \
+    (EI_CLASSIFIER_TFLITE_INPUT_QUANTIZED == 1) && !(EI_CLASSIFIER_OBJECT_DETECTION)
+#define EI_CLASSIFIER_RUN_DSP_TO_TENSOR     1
+
+/**
+ * @brief      Run the DSP blocks straight into the int8 input tensor of the
+ *             persistent model, then invoke it. The features anomaly
+ *             detection uses are kept as float on the way.
+ *
+ * @param      signal  Sample data
+ * @param      result  Output classifier results
+ * @param[in]  debug   Debug output enable
+ *
+ * @return     The ei impulse error.
+ */
+static EI_IMPULSE_ERROR run_classifier_to_tensor(
+    signal_t *signal,
+    ei_impulse_result_t *result,
+    bool debug)
+{
+    TfLiteTensor* input;
+    TfLiteTensor* output;
+    uint8_t* tensor_arena;
+    uint64_t ctx_start_us;
+
+    EI_IMPULSE_ERROR res = inference_tflite_setup(&ctx_start_us, &input, &output, &tensor_arena);
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+
+    ei::feature_sink_t features(input->data.int8, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE,
+        input->params.scale, input->params.zero_point);
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+    float anomaly_input[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    features.set_capture(EI_CLASSIFIER_ANOM_AXIS, EI_CLASSIFIER_ANOM_AXIS_SIZE, anomaly_input);
+#endif
+
+    res = run_dsp_blocks(signal, &features, result, debug);
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+
+    if (debug) {
+        ei_printf("Running neural network...\n");
+    }
+
+    // the setup ran before the DSP blocks, count it in the classification time
+    // like run_inference does, but not the DSP in between
+    res = inference_tflite_run(ei_read_timer_us() - tflite_setup_us, output, tensor_arena, result, debug);
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+    run_anomaly_detection_axes(anomaly_input, result, debug);
 #endif
 
     if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
@@ -1249,8 +1651,8 @@ extern "C" EI_IMPULSE_ERROR run_inference_i16(
     }
 
     return EI_IMPULSE_OK;
-#endif // OBJECT_DETECTION
 }
+#endif
 
 /**
  * Run the classifier over a raw features array
@@ -1264,6 +1666,8 @@ extern "C" EI_IMPULSE_ERROR run_classifier(
     ei_impulse_result_t *result,
     bool debug = false)
 {
+    EI_PROFILER_TRACE_SCOPE("run_classifier");
+
 #if EI_CLASSIFIER_TFLITE_INPUT_QUANTIZED == 1 && EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE
     // Shortcut for quantized image models
     if (can_run_classifier_image_quantized() == EI_IMPULSE_OK) {
@@ -1285,73 +1689,203 @@ extern "C" EI_IMPULSE_ERROR run_classifier(
 
     memset(result, 0, sizeof(ei_impulse_result_t));
 
+#if EI_CLASSIFIER_RUN_DSP_TO_TENSOR == 1
+    return run_classifier_to_tensor(signal, result, debug);
+#else
     ei::matrix_t features_matrix(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+    ei::feature_sink_t features(features_matrix.buffer, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
 
-    uint64_t dsp_start_us = ei_read_timer_us();
+    EI_IMPULSE_ERROR dsp_res = run_dsp_blocks(signal, &features, result, debug);
+    if (dsp_res != EI_IMPULSE_OK) {
+        return dsp_res;
+    }
 
-    size_t out_features_index = 0;
+#if EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_NONE
+    if (debug) {
+        ei_printf("Running neural network...\n");
+    }
+#endif
 
-    for (size_t ix = 0; ix < ei_dsp_blocks_size; ix++) {
-        ei_model_dsp_t block = ei_dsp_blocks[ix];
+    return run_inference(&features_matrix, result, debug);
+#endif
+}
 
-        if (out_features_index + block.n_output_features > EI_CLASSIFIER_NN_INPUT_FRAME_SIZE) {
-            ei_printf("ERR: Would write outside feature buffer\n");
-            return EI_IMPULSE_DSP_ERROR;
+/**
+ * @brief      Classify a batch of windows one by one with run_classifier, for
+ *             the engines and models run_classifier_batch has no shared setup
+ *             for
+ */
+__attribute__((unused)) static EI_IMPULSE_ERROR run_classifier_batch_each(
+    signal_t *signals,
+    size_t count,
+    ei_impulse_result_t *results,
+    bool debug)
+{
+    for (size_t ix = 0; ix < count; ix++) {
+        EI_IMPULSE_ERROR res = run_classifier(&signals[ix], &results[ix], debug);
+        if (res != EI_IMPULSE_OK) {
+            return res;
         }
+    }
 
-        ei::matrix_t fm(1, block.n_output_features, features_matrix.buffer + out_features_index);
+    return EI_IMPULSE_OK;
+}
 
-#if EIDSP_SIGNAL_C_FN_POINTER
-        if (block.axes_size != EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME) {
-            ei_printf("ERR: EIDSP_SIGNAL_C_FN_POINTER can only be used when all axes are selected for DSP blocks\n");
-            return EI_IMPULSE_DSP_ERROR;
-        }
-        int ret = block.extract_fn(signal, &fm, block.config, EI_CLASSIFIER_FREQUENCY);
+/**
+ * @brief      Classify a batch of windows, e.g. a stored backlog. The model is
+ *             set up and torn down once for the whole batch and invoked once
+ *             per window, its batch dimension is fixed at 1.
+ *
+ * @param      signals  Array of count signals
+ * @param[in]  count    Number of windows
+ * @param      results  Array of count results. Per window timing covers its
+ *                      own DSP and invoke, the one-off model setup and
+ *                      teardown is reported in results[0].timing.classification_setup_us
+ * @param[in]  debug    Debug output enable
+ *
+ * @return     The ei impulse error. On error the windows before the failing one
+ *             have their results filled in.
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_batch(
+    signal_t *signals,
+    size_t count,
+    ei_impulse_result_t *results,
+    bool debug = false)
+{
+    EI_PROFILER_TRACE_SCOPE("run_classifier_batch");
+
+    if (count == 0) {
+        return EI_IMPULSE_OK;
+    }
+
+#if (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && !(EI_CLASSIFIER_OBJECT_DETECTION)
+#if EI_CLASSIFIER_TFLITE_INPUT_QUANTIZED == 1
+    // Quantized image models take their own path
+    if (can_run_classifier_image_quantized() == EI_IMPULSE_OK) {
+        return run_classifier_batch_each(signals, count, results, debug);
+    }
+#endif
+
+#if EI_CLASSIFIER_RUN_DSP_TO_TENSOR != 1
+    ei::matrix_t features_matrix(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+    if (features_matrix.buffer == NULL) {
+        return EI_IMPULSE_OUT_OF_MEMORY;
+    }
+#endif
+
+    TfLiteTensor* input;
+    TfLiteTensor* output;
+    uint8_t* tensor_arena = NULL;
+    uint64_t ctx_start_us;
+
+#if (EI_CLASSIFIER_COMPILED == 1)
+    EI_IMPULSE_ERROR res = inference_tflite_setup(&ctx_start_us, &input, &output, &tensor_arena);
 #else
-        SignalWithAxes swa(signal, block.axes, block.axes_size);
-        int ret = block.extract_fn(swa.get_signal(), &fm, block.config, EI_CLASSIFIER_FREQUENCY);
+    tflite::MicroInterpreter* interpreter;
+    EI_IMPULSE_ERROR res = inference_tflite_setup(&ctx_start_us, &input, &output, &interpreter, &tensor_arena);
 #endif
+    if (res != EI_IMPULSE_OK) {
+        return res;
+    }
+    uint64_t setup_us = tflite_setup_us;
 
-        if (ret != EIDSP_OK) {
-            ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
-            return EI_IMPULSE_DSP_ERROR;
+#if EI_CLASSIFIER_RUN_DSP_TO_TENSOR == 1
+    // the DSP blocks write straight into the input tensor, see run_classifier_to_tensor
+    ei::feature_sink_t features(input->data.int8, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE,
+        input->params.scale, input->params.zero_point);
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+    float anomaly_input[EI_CLASSIFIER_ANOM_AXIS_SIZE];
+    features.set_capture(EI_CLASSIFIER_ANOM_AXIS, EI_CLASSIFIER_ANOM_AXIS_SIZE, anomaly_input);
+#endif
+#else
+    ei::feature_sink_t features(features_matrix.buffer, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+#endif
+
+    for (size_t ix = 0; ix < count; ix++) {
+        ei_impulse_result_t *result = &results[ix];
+        memset(result, 0, sizeof(ei_impulse_result_t));
+
+        res = run_dsp_blocks(&signals[ix], &features, result, debug);
+        if (res != EI_IMPULSE_OK) {
+            break;
         }
 
-        if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
-            return EI_IMPULSE_CANCELED;
+        uint64_t invoke_start_us = ei_read_timer_us();
+
+#if EI_CLASSIFIER_RUN_DSP_TO_TENSOR != 1
+        EI_PROFILER_STAGE_BEGIN(quantize_mark);
+        inference_tflite_fill_input(input, &features_matrix);
+        EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_QUANTIZE, quantize_mark);
+#endif
+
+        EI_PROFILER_STAGE_BEGIN(invoke_mark);
+#if (EI_CLASSIFIER_COMPILED == 1)
+        TfLiteStatus invoke_status = trained_model_invoke();
+#else
+        TfLiteStatus invoke_status = interpreter->Invoke();
+#endif
+        EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_INVOKE, invoke_mark);
+        if (invoke_status != kTfLiteOk) {
+            ei_printf("ERR: Invoke failed (%d)\n", invoke_status);
+            res = EI_IMPULSE_TFLITE_ERROR;
+            break;
         }
 
-        out_features_index += block.n_output_features;
-    }
+        result->timing.classification_us = ei_read_timer_us() - invoke_start_us;
+        result->timing.classification = (int)(result->timing.classification_us / 1000);
 
-    result->timing.dsp_us = ei_read_timer_us() - dsp_start_us;
-    result->timing.dsp = (int)(result->timing.dsp_us / 1000);
+        if (debug) {
+            ei_printf("Predictions (time: %d ms.):\n", result->timing.classification);
+        }
+        if (output->type == TfLiteType::kTfLiteInt8) {
+            fill_result_struct_i8(result, output->data.int8, output->params.zero_point, output->params.scale, debug);
+        }
+        else {
+            fill_result_struct_f32(result, output->data.f, debug);
+        }
 
-    if (debug) {
-        ei_printf("Features (%d ms.): ", result->timing.dsp);
-        for (size_t ix = 0; ix < features_matrix.cols; ix++) {
-            ei_printf_float(features_matrix.buffer[ix]);
-            ei_printf(" ");
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+#if EI_CLASSIFIER_RUN_DSP_TO_TENSOR == 1
+        run_anomaly_detection_axes(anomaly_input, result, debug);
+#else
+        run_anomaly_detection(&features_matrix, result, debug);
+#endif
+#endif
+
+        if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+            res = EI_IMPULSE_CANCELED;
+            break;
         }
-        ei_printf("\n");
     }
 
-#if EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_NONE
-    if (debug) {
-        ei_printf("Running neural network...\n");
-    }
+    uint64_t teardown_start_us = ei_read_timer_us();
+
+#if (EI_CLASSIFIER_COMPILED == 1) && (EI_CLASSIFIER_PERSISTENT_INTERPRETER == 1)
+    // model stays prepared for the next inference
+#elif (EI_CLASSIFIER_COMPILED == 1)
+    trained_model_reset(ei_aligned_free);
+#else
+    delete interpreter;
+    ei_aligned_free(tensor_arena);
 #endif
 
-    return run_inference(&features_matrix, result, debug);
+    results[0].timing.classification_setup_us = setup_us + (ei_read_timer_us() - teardown_start_us);
+
+    return res;
+#else
+    // no shared setup for this engine or model type
+    return run_classifier_batch_each(signals, count, results, debug);
+#endif
 }
 
-#if defined(EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK) && EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK == 1
+#if EI_CLASSIFIER_QUANTIZED_DSP == 1
 
 extern "C" EI_IMPULSE_ERROR run_classifier_i16(
     signal_i16_t *signal,
     ei_impulse_result_t *result,
     bool debug = false)
 {
+    EI_PROFILER_TRACE_SCOPE("run_classifier_i16");
 
     memset(result, 0, sizeof(ei_impulse_result_t));
 
@@ -1414,7 +1948,7 @@ extern "C" EI_IMPULSE_ERROR run_classifier_i16(
 
     return run_inference_i16(&features_matrix, result, debug);
 }
-#endif //EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK
+#endif // EI_CLASSIFIER_QUANTIZED_DSP
 
 /**
  * @brief      Calculates the cepstral mean and variable normalization.
@@ -1722,7 +2256,7 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_impulse(
     return r;
 }
 
-#if defined(EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK) && EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK == 1
+#if EI_CLASSIFIER_QUANTIZED_DSP == 1
 
 __attribute__((unused)) EI_IMPULSE_ERROR run_impulse_i16(
 #if defined(EI_CLASSIFIER_HAS_SAMPLER) && EI_CLASSIFIER_HAS_SAMPLER == 1
@@ -1773,7 +2307,7 @@ __attribute__((unused)) EI_IMPULSE_ERROR run_impulse_i16(
 
     return run_classifier_i16(&signal, result, debug);
 }
-#endif //EI_CLASSIFIER_USE_QUANTIZED_DSP_BLOCK
+#endif // EI_CLASSIFIER_QUANTIZED_DSP
 
 #if defined(EI_CLASSIFIER_HAS_SAMPLER) && EI_CLASSIFIER_HAS_SAMPLER == 1
 /**
@@ -27,6 +27,7 @@
 #include "edge-impulse-sdk/dsp/spectral/spectral.hpp"
 #include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
 #include "edge-impulse-sdk/classifier/ei_signal_with_range.h"
+#include "edge-impulse-sdk/dsp/ei_profiler.h"
 
 #if defined(__cplusplus) && EI_C_LINKAGE == 1
 extern "C" {
@@ -51,213 +52,352 @@ static float *ei_dsp_cont_current_frame = nullptr;
 static size_t ei_dsp_cont_current_frame_size = 0;
 static int ei_dsp_cont_current_frame_ix = 0;
 
-__attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
-    ei_dsp_config_spectral_analysis_t config = *((ei_dsp_config_spectral_analysis_t*)config_ptr);
+#ifndef EI_DSP_SPECTRAL_PLAN_COUNT
+#define EI_DSP_SPECTRAL_PLAN_COUNT      4
+#endif // EI_DSP_SPECTRAL_PLAN_COUNT
 
-    int ret;
+// precompiled spectral analysis plans, one per DSP block, shared between invocations
+typedef struct {
+    const void *config_ptr;
+    float frequency;
+    size_t samples_per_axis;
+    spectral::spectral_analysis_plan *plan;
+    spectral::spectral_analysis_plan_q15 *plan_q15;
+} ei_dsp_spectral_plan_t;
 
-    const float sampling_freq = frequency;
+static ei_dsp_spectral_plan_t ei_dsp_spectral_plans[EI_DSP_SPECTRAL_PLAN_COUNT];
 
-    // input matrix from the raw signal
-    matrix_t input_matrix(signal->total_length / config.axes, config.axes);
-    if (!input_matrix.buffer) {
-        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+static spectral::filter_t spectral_analysis_filter_type(ei_dsp_config_spectral_analysis_t *config)
+{
+    if (strcmp(config->filter_type, "low") == 0) {
+        return spectral::filter_lowpass;
+    }
+    else if (strcmp(config->filter_type, "high") == 0) {
+        return spectral::filter_highpass;
     }
+    return spectral::filter_none;
+}
 
-    signal->get_data(0, signal->total_length, input_matrix.buffer);
+static spectral::spectral_analysis_plan *create_spectral_analysis_plan(
+    ei_dsp_config_spectral_analysis_t *config,
+    const float frequency,
+    size_t samples_per_axis)
+{
+    return new spectral::spectral_analysis_plan(config->axes, samples_per_axis, frequency,
+        config->scale_axes, spectral_analysis_filter_type(config), config->filter_cutoff, config->filter_order,
+        config->fft_length, config->spectral_peaks_count, config->spectral_peaks_threshold,
+        config->spectral_power_edges);
+}
 
-    // scale the signal
-    ret = numpy::scale(&input_matrix, config.scale_axes);
-    if (ret != EIDSP_OK) {
-        ei_printf("ERR: Failed to scale signal (%d)\n", ret);
-        EIDSP_ERR(ret);
+static spectral::spectral_analysis_plan_q15 *create_spectral_analysis_plan_q15(
+    ei_dsp_config_spectral_analysis_t *config,
+    const float frequency,
+    size_t samples_per_axis)
+{
+    return new spectral::spectral_analysis_plan_q15(config->axes, samples_per_axis, frequency,
+        config->scale_axes, spectral_analysis_filter_type(config), config->filter_cutoff, config->filter_order,
+        config->fft_length, config->spectral_peaks_count, config->spectral_peaks_threshold,
+        config->spectral_power_edges);
+}
+
+/**
+ * Find the plan slot for this config, or claim a free one.
+ * Returns NULL if all slots are taken.
+ */
+static ei_dsp_spectral_plan_t *get_spectral_analysis_plan_entry(
+    void *config_ptr,
+    const float frequency,
+    size_t samples_per_axis)
+{
+    for (size_t ix = 0; ix < EI_DSP_SPECTRAL_PLAN_COUNT; ix++) {
+        ei_dsp_spectral_plan_t *entry = &ei_dsp_spectral_plans[ix];
+
+        if (entry->config_ptr == nullptr) {
+            entry->config_ptr = config_ptr;
+            entry->frequency = frequency;
+            entry->samples_per_axis = samples_per_axis;
+            return entry;
+        }
+
+        if (entry->config_ptr == config_ptr && entry->frequency == frequency &&
+                entry->samples_per_axis == samples_per_axis) {
+            return entry;
+        }
     }
 
-    // transpose the matrix so we have one row per axis (nifty!)
-    ret = numpy::transpose(&input_matrix);
-    if (ret != EIDSP_OK) {
-        ei_printf("ERR: Failed to transpose matrix (%d)\n", ret);
-        EIDSP_ERR(ret);
+    return nullptr;
+}
+
+/**
+ * Find the plan for this config, or create it if there's a free slot.
+ * Returns NULL if all slots are taken.
+ */
+static spectral::spectral_analysis_plan *get_spectral_analysis_plan(
+    void *config_ptr,
+    const float frequency,
+    size_t samples_per_axis)
+{
+    ei_dsp_spectral_plan_t *entry = get_spectral_analysis_plan_entry(config_ptr, frequency, samples_per_axis);
+    if (!entry) {
+        return nullptr;
     }
 
-    // the spectral edges that we want to calculate
-    matrix_t edges_matrix_in(64, 1);
-    size_t edge_matrix_ix = 0;
+    if (entry->plan == nullptr) {
+        entry->plan = create_spectral_analysis_plan(
+            (ei_dsp_config_spectral_analysis_t*)config_ptr, frequency, samples_per_axis);
+    }
+    return entry->plan;
+}
 
-    char spectral_str[128] = { 0 };
-    if (strlen(config.spectral_power_edges) > sizeof(spectral_str) - 1) {
-        EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+/**
+ * Find the fixed-point plan for this config, or create it if there's a free slot.
+ * Returns NULL if all slots are taken.
+ */
+static spectral::spectral_analysis_plan_q15 *get_spectral_analysis_plan_q15(
+    void *config_ptr,
+    const float frequency,
+    size_t samples_per_axis)
+{
+    ei_dsp_spectral_plan_t *entry = get_spectral_analysis_plan_entry(config_ptr, frequency, samples_per_axis);
+    if (!entry) {
+        return nullptr;
     }
-    memcpy(spectral_str, config.spectral_power_edges, strlen(config.spectral_power_edges));
 
-    // convert spectral_power_edges (string) into float array
-    char *spectral_ptr = spectral_str;
-    while (spectral_ptr != NULL) {
-        while((*spectral_ptr) == ' ') {
-            spectral_ptr++;
-        }
+    if (entry->plan_q15 == nullptr) {
+        entry->plan_q15 = create_spectral_analysis_plan_q15(
+            (ei_dsp_config_spectral_analysis_t*)config_ptr, frequency, samples_per_axis);
+    }
+    return entry->plan_q15;
+}
 
-        edges_matrix_in.buffer[edge_matrix_ix++] = atof(spectral_ptr);
+/**
+ * Spectral analysis features straight into a feature sink, e.g. the input
+ * tensor of a quantized model. The sink needs room for all features of the block.
+ */
+__attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal, feature_sink_t *sink, void *config_ptr, const float frequency) {
+    EI_PROFILER_TRACE_SCOPE("spectral_analysis");
 
-        // find next (spectral) delimiter (or '\0' character)
-        while((*spectral_ptr != ',')) {
-            spectral_ptr++;
-            if (*spectral_ptr == '\0') break;
-        }
+    ei_dsp_config_spectral_analysis_t config = *((ei_dsp_config_spectral_analysis_t*)config_ptr);
 
-        if (*spectral_ptr == '\0') {
-            spectral_ptr = NULL;
-        }
-        else  {
-            spectral_ptr++;
+    int ret;
+
+    size_t samples_per_axis = signal->total_length / config.axes;
+
+    bool temporary_plan = false;
+    spectral::spectral_analysis_plan *plan = get_spectral_analysis_plan(config_ptr, frequency, samples_per_axis);
+    if (!plan) {
+        // no free slot (raise EI_DSP_SPECTRAL_PLAN_COUNT), build one just for this window
+        plan = create_spectral_analysis_plan(&config, frequency, samples_per_axis);
+        temporary_plan = true;
+    }
+    if (!plan) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+
+    ret = plan->status();
+    if (ret != EIDSP_OK) {
+        ei_printf("ERR: Failed to create spectral analysis plan (%d)\n", ret);
+        if (temporary_plan) {
+            delete plan;
         }
+        EIDSP_ERR(ret);
     }
-    edges_matrix_in.rows = edge_matrix_ix;
 
-    // calculate how much room we need for the output matrix
-    size_t output_matrix_cols = spectral::feature::calculate_spectral_buffer_size(
-        true, config.spectral_peaks_count, edges_matrix_in.rows
-    );
-    // ei_printf("output_matrix_size %hux%zu\n", input_matrix.rows, output_matrix_cols);
-    if (output_matrix->cols * output_matrix->rows != static_cast<uint32_t>(output_matrix_cols * config.axes)) {
+    if (sink->size != plan->get_features_per_axis() * config.axes) {
+        if (temporary_plan) {
+            delete plan;
+        }
         EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
     }
 
-    output_matrix->cols = output_matrix_cols;
-    output_matrix->rows = config.axes;
-
-    spectral::filter_t filter_type;
-    if (strcmp(config.filter_type, "low") == 0) {
-        filter_type = spectral::filter_lowpass;
-    }
-    else if (strcmp(config.filter_type, "high") == 0) {
-        filter_type = spectral::filter_highpass;
-    }
-    else {
-        filter_type = spectral::filter_none;
+    ret = plan->run(signal, sink);
+    if (temporary_plan) {
+        delete plan;
     }
-
-    ret = spectral::feature::spectral_analysis(output_matrix, &input_matrix,
-        sampling_freq, filter_type, config.filter_cutoff, config.filter_order,
-        config.fft_length, config.spectral_peaks_count, config.spectral_peaks_threshold, &edges_matrix_in);
     if (ret != EIDSP_OK) {
         ei_printf("ERR: Failed to calculate spectral features (%d)\n", ret);
         EIDSP_ERR(ret);
     }
 
-    // flatten again
-    output_matrix->cols = config.axes * output_matrix_cols;
-    output_matrix->rows = 1;
-
     return EIDSP_OK;
 }
 
-matrix_i16_t *create_edges_matrix(ei_dsp_config_spectral_analysis_t config, const float sampling_freq)
-{
-    // the spectral edges that we want to calculate
-    static matrix_i16_t edges_matrix_in(64, 1);
-    static bool matrix_created = false;
-    size_t edge_matrix_ix = 0;
+__attribute__((unused)) int extract_spectral_analysis_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
+    feature_sink_t sink(output_matrix->buffer, output_matrix->rows * output_matrix->cols);
 
-    if(matrix_created == false) {
+    int ret = extract_spectral_analysis_features(signal, &sink, config_ptr, frequency);
+    if (ret != EIDSP_OK) {
+        return ret;
+    }
 
-        char spectral_str[128] = { 0 };
-        if (strlen(config.spectral_power_edges) > sizeof(spectral_str) - 1) {
-            return NULL;
-        }
-        memcpy(spectral_str, config.spectral_power_edges, strlen(config.spectral_power_edges));
+    // flatten again
+    output_matrix->cols = output_matrix->rows * output_matrix->cols;
+    output_matrix->rows = 1;
 
-        // convert spectral_power_edges (string) into float array
-        char *spectral_ptr = spectral_str;
-        while (spectral_ptr != NULL) {
-            while((*spectral_ptr) == ' ') {
-                spectral_ptr++;
-            }
+    return EIDSP_OK;
+}
 
-            float edge = (atof(spectral_ptr) / (float)(sampling_freq/2.f));
-            numpy::float_to_int16(&edge, &edges_matrix_in.buffer[edge_matrix_ix++], 1);
+// ring buffers with the last window of raw samples for continuous spectral analysis, one per DSP block
+typedef struct {
+    const void *config_ptr;
+    float *buffer;
+    size_t size;
+    size_t write_ix;
+    size_t filled;
+} ei_dsp_spectral_ring_t;
 
-            // find next (spectral) delimiter (or '\0' character)
-            while((*spectral_ptr != ',')) {
-                spectral_ptr++;
-                if (*spectral_ptr == '\0') break;
-            }
+static ei_dsp_spectral_ring_t ei_dsp_spectral_rings[EI_DSP_SPECTRAL_PLAN_COUNT];
+static ei_dsp_spectral_ring_t *ei_dsp_spectral_ring_current = nullptr;
 
-            if (*spectral_ptr == '\0') {
-                spectral_ptr = NULL;
-            }
-            else  {
-                spectral_ptr++;
-            }
-        }
-        edges_matrix_in.rows = edge_matrix_ix;
-        matrix_created = true;
+/**
+ * Read the window from the current ring buffer, oldest sample first
+ */
+static int spectral_ring_signal_get_data(size_t offset, size_t length, float *out_ptr) {
+    ei_dsp_spectral_ring_t *ring = ei_dsp_spectral_ring_current;
+
+    size_t read_ix = (ring->write_ix + offset) % ring->size;
+    size_t first = ring->size - read_ix;
+    if (first > length) {
+        first = length;
     }
 
-    return &edges_matrix_in;
+    memcpy(out_ptr, ring->buffer + read_ix, first * sizeof(float));
+    memcpy(out_ptr + first, ring->buffer, (length - first) * sizeof(float));
+
+    return 0;
 }
 
-__attribute__((unused)) int extract_spectral_analysis_features(signal_i16_t *signal, matrix_i32_t *output_matrix, void *config_ptr, const float frequency) {
+/**
+ * Continuous version of `extract_spectral_analysis_features`. Every slice is pushed into
+ * a ring buffer that holds a full window (EI_CLASSIFIER_RAW_SAMPLE_COUNT samples per axis),
+ * and the features are calculated over the last window whenever a slice comes in.
+ * Until the first window is complete no features are written (matrix_size_out is 0x0).
+ *
+ * Only the raw samples carry over between slices. Mean removal, the filter (which starts
+ * from rest at the first sample of the window) and the FFT are defined per window, so they
+ * run over the whole window again on every slice; the features are the ones
+ * `extract_spectral_analysis_features` gives for the same window. The per window setup
+ * (filter coefficients, FFT plan, power edges) is cached in the spectral plan.
+ */
+__attribute__((unused)) int extract_spectral_analysis_per_slice_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency, matrix_size_t *matrix_size_out) {
     ei_dsp_config_spectral_analysis_t config = *((ei_dsp_config_spectral_analysis_t*)config_ptr);
 
-    int ret;
+    matrix_size_out->rows = 0;
+    matrix_size_out->cols = 0;
+
+    if (signal->total_length == 0 || signal->total_length % config.axes != 0) {
+        EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+    }
 
-    const float sampling_freq = frequency;
+    const size_t window_size = EI_CLASSIFIER_RAW_SAMPLE_COUNT * config.axes;
+    if (signal->total_length > window_size) {
+        EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+    }
 
-    // input matrix from the raw signal
-    matrix_i16_t input_matrix(signal->total_length / config.axes, config.axes);
-    if (!input_matrix.buffer) {
+    ei_dsp_spectral_ring_t *ring = nullptr;
+    for (size_t ix = 0; ix < EI_DSP_SPECTRAL_PLAN_COUNT; ix++) {
+        if (ei_dsp_spectral_rings[ix].config_ptr == config_ptr || ei_dsp_spectral_rings[ix].config_ptr == nullptr) {
+            ring = &ei_dsp_spectral_rings[ix];
+            break;
+        }
+    }
+    if (!ring) {
+        ei_printf("ERR: No room for another continuous spectral block, raise EI_DSP_SPECTRAL_PLAN_COUNT\n");
         EIDSP_ERR(EIDSP_OUT_OF_MEM);
     }
 
-    signal->get_data(0, signal->total_length, (EIDSP_i16 *)&input_matrix.buffer[0]);
+    if (!ring->buffer) {
+        ring->buffer = (float*)ei_calloc(window_size * sizeof(float), 1);
+        if (!ring->buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        ring->config_ptr = config_ptr;
+        ring->size = window_size;
+        ring->write_ix = 0;
+        ring->filled = 0;
+    }
+
+    // append the slice, wrapping around the end of the ring
+    size_t offset = 0;
+    while (offset < signal->total_length) {
+        size_t length = ring->size - ring->write_ix;
+        if (length > signal->total_length - offset) {
+            length = signal->total_length - offset;
+        }
 
-    // scale the signal
-    ret = numpy::scale(&input_matrix, config.scale_axes);
-    if (ret != EIDSP_OK) {
-        ei_printf("ERR: Failed to scale signal (%d)\n", ret);
-        EIDSP_ERR(ret);
+        int ret = signal->get_data(offset, length, ring->buffer + ring->write_ix);
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+
+        offset += length;
+        ring->write_ix = (ring->write_ix + length) % ring->size;
     }
 
-    // transpose the matrix so we have one row per axis (nifty!)
-    ret = numpy::transpose(&input_matrix);
+    ring->filled += signal->total_length;
+    if (ring->filled < ring->size) {
+        return EIDSP_OK;
+    }
+    ring->filled = ring->size;
+
+    signal_t window_signal;
+    window_signal.total_length = ring->size;
+    window_signal.get_data = &spectral_ring_signal_get_data;
+    ei_dsp_spectral_ring_current = ring;
+
+    int ret = extract_spectral_analysis_features(&window_signal, output_matrix, config_ptr, frequency);
     if (ret != EIDSP_OK) {
-        ei_printf("ERR: Failed to transpose matrix (%d)\n", ret);
         EIDSP_ERR(ret);
     }
 
-    matrix_i16_t *edges_matrix_in = create_edges_matrix(config, sampling_freq);
+    matrix_size_out->rows = output_matrix->rows;
+    matrix_size_out->cols = output_matrix->cols;
 
-    if(edges_matrix_in == NULL) {
-        EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+    return EIDSP_OK;
+}
+
+__attribute__((unused)) int extract_spectral_analysis_features(signal_i16_t *signal, matrix_i32_t *output_matrix, void *config_ptr, const float frequency) {
+    EI_PROFILER_TRACE_SCOPE("spectral_analysis_q15");
+
+    ei_dsp_config_spectral_analysis_t config = *((ei_dsp_config_spectral_analysis_t*)config_ptr);
+
+    int ret;
+
+    size_t samples_per_axis = signal->total_length / config.axes;
+
+    bool temporary_plan = false;
+    spectral::spectral_analysis_plan_q15 *plan = get_spectral_analysis_plan_q15(config_ptr, frequency, samples_per_axis);
+    if (!plan) {
+        // no free slot (raise EI_DSP_SPECTRAL_PLAN_COUNT), build one just for this window
+        plan = create_spectral_analysis_plan_q15(&config, frequency, samples_per_axis);
+        temporary_plan = true;
+    }
+    if (!plan) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+
+    ret = plan->status();
+    if (ret != EIDSP_OK) {
+        ei_printf("ERR: Failed to create spectral analysis plan (%d)\n", ret);
+        if (temporary_plan) {
+            delete plan;
+        }
+        EIDSP_ERR(ret);
     }
 
     // calculate how much room we need for the output matrix
-    size_t output_matrix_cols = spectral::feature::calculate_spectral_buffer_size(
-        true, config.spectral_peaks_count, edges_matrix_in->rows
-    );
-    // ei_printf("output_matrix_size %hux%zu\n", input_matrix.rows, output_matrix_cols);
+    size_t output_matrix_cols = plan->get_features_per_axis();
     if (output_matrix->cols * output_matrix->rows != static_cast<uint32_t>(output_matrix_cols * config.axes)) {
+        if (temporary_plan) {
+            delete plan;
+        }
         EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
     }
 
-    output_matrix->cols = output_matrix_cols;
-    output_matrix->rows = config.axes;
-
-    spectral::filter_t filter_type;
-    if (strcmp(config.filter_type, "low") == 0) {
-        filter_type = spectral::filter_lowpass;
+    ret = plan->run(signal, output_matrix->buffer);
+    if (temporary_plan) {
+        delete plan;
     }
-    else if (strcmp(config.filter_type, "high") == 0) {
-        filter_type = spectral::filter_highpass;
-    }
-    else {
-        filter_type = spectral::filter_none;
-    }
-
-    ret = spectral::feature::spectral_analysis(output_matrix, &input_matrix,
-        sampling_freq, filter_type, config.filter_cutoff, config.filter_order,
-        config.fft_length, config.spectral_peaks_count, config.spectral_peaks_threshold, edges_matrix_in);
     if (ret != EIDSP_OK) {
         ei_printf("ERR: Failed to calculate spectral features (%d)\n", ret);
         EIDSP_ERR(ret);
@@ -1474,6 +1614,43 @@ __attribute__((unused)) int ei_dsp_clear_continuous_audio_state() {
     return EIDSP_OK;
 }
 
+/**
+ * Clear all state regarding continuous spectral analysis (the raw sample ring buffers).
+ */
+__attribute__((unused)) int ei_dsp_clear_continuous_spectral_state() {
+    for (size_t ix = 0; ix < EI_DSP_SPECTRAL_PLAN_COUNT; ix++) {
+        if (ei_dsp_spectral_rings[ix].buffer) {
+            ei_free(ei_dsp_spectral_rings[ix].buffer);
+        }
+        memset(&ei_dsp_spectral_rings[ix], 0, sizeof(ei_dsp_spectral_ring_t));
+    }
+    ei_dsp_spectral_ring_current = nullptr;
+
+    return EIDSP_OK;
+}
+
+/**
+ * Free all precompiled spectral analysis plans, and the FFT plans they share with
+ * the other DSP blocks. They're rebuilt on the next invocation.
+ */
+__attribute__((unused)) int ei_dsp_clear_spectral_analysis_plans() {
+    for (size_t ix = 0; ix < EI_DSP_SPECTRAL_PLAN_COUNT; ix++) {
+        if (ei_dsp_spectral_plans[ix].plan) {
+            delete ei_dsp_spectral_plans[ix].plan;
+        }
+        if (ei_dsp_spectral_plans[ix].plan_q15) {
+            delete ei_dsp_spectral_plans[ix].plan_q15;
+        }
+        ei_dsp_spectral_plans[ix].plan = nullptr;
+        ei_dsp_spectral_plans[ix].plan_q15 = nullptr;
+        ei_dsp_spectral_plans[ix].config_ptr = nullptr;
+    }
+
+    numpy::clear_fft_plans();
+
+    return EIDSP_OK;
+}
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
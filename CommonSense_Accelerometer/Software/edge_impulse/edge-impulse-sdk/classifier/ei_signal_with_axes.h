@@ -25,6 +25,7 @@
 
 #include "edge-impulse-sdk/dsp/numpy_types.h"
 #include "edge-impulse-sdk/dsp/returntypes.hpp"
+#include "edge-impulse-sdk/dsp/numpy.hpp"
 
 #if !EIDSP_SIGNAL_C_FN_POINTER
 
@@ -51,21 +52,40 @@ public:
             return this->get_data(offset, length, out_ptr);
         };
 #endif
+
+        // a buffer in memory: select the axes with a strided view, no copy
+        ei_signal_view_t frames;
+        if (numpy::signal_view_as_frames(&_original_signal->view, EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME, &frames)
+                && frames.axes == NULL) {
+            wrapped_signal.view = frames;
+            wrapped_signal.view.axes = _axes;
+            wrapped_signal.view.axes_count = _axes_count;
+        }
+        else {
+            wrapped_signal.view.buffer = NULL;
+        }
         return &wrapped_signal;
     }
 
     int get_data(size_t offset, size_t length, float *out_ptr) {
+        if (wrapped_signal.view.buffer) {
+            return numpy::signal_view_get_data(&wrapped_signal.view, offset, length, out_ptr);
+        }
+
+        // virtual source (e.g. the microphone), read one frame per call
         size_t offset_on_original_signal = offset / _axes_count * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
         size_t length_on_original_signal = length / _axes_count * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
 
         size_t out_ptr_ix = 0;
+        float frame[EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME];
 
         for (size_t ix = offset_on_original_signal; ix < offset_on_original_signal + length_on_original_signal; ix += EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME) {
+            int r = _original_signal->get_data(ix, EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME, frame);
+            if (r != 0) {
+                return r;
+            }
             for (size_t axis_ix = 0; axis_ix < this->_axes_count; axis_ix++) {
-                int r = _original_signal->get_data(ix + _axes[axis_ix], 1, &out_ptr[out_ptr_ix++]);
-                if (r != 0) {
-                    return r;
-                }
+                out_ptr[out_ptr_ix++] = frame[_axes[axis_ix]];
             }
         }
 
@@ -93,6 +113,7 @@ public:
         }
 
         wrapped_signal.total_length = _original_signal->total_length / EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME * _axes_count;
+        wrapped_signal.scale = _original_signal->scale;
 #ifdef __MBED__
         wrapped_signal.get_data = mbed::callback(this, &SignalWithAxesI16::get_data);
 #else
@@ -79,6 +79,7 @@ public:
         }
 
         wrapped_signal.total_length = _range_end - _range_start;
+        wrapped_signal.scale = _original_signal->scale;
 #ifdef __MBED__
         wrapped_signal.get_data = mbed::callback(this, &SignalWithRangeI16::get_data);
 #else
@@ -45,4 +45,116 @@ private:
     uint64_t timestamp;
 };
 
+// Per-stage timing of the impulse, recorded by firmware-sdk/ei_benchmark.cpp.
+// Off by default, the stage markers compile away.
+#ifndef EI_PROFILER_STAGES
+#define EI_PROFILER_STAGES          0
+#endif // EI_PROFILER_STAGES
+
+typedef enum {
+    EI_PROFILER_STAGE_ACQUISITION = 0,  // one sensor read, per sample timer tick
+    EI_PROFILER_STAGE_COPY,             // signal into the DSP input buffer
+    EI_PROFILER_STAGE_SCALE_TRANSPOSE,  // scale and transpose (fused) to one row per axis
+    EI_PROFILER_STAGE_MEAN,             // mean removal and RMS
+    EI_PROFILER_STAGE_FILTER,
+    EI_PROFILER_STAGE_FFT,
+    EI_PROFILER_STAGE_PEAKS,
+    EI_PROFILER_STAGE_POWER_EDGES,
+    EI_PROFILER_STAGE_QUANTIZE,         // features into the input tensor
+    EI_PROFILER_STAGE_INVOKE,
+    EI_PROFILER_STAGE_ANOMALY,
+    EI_PROFILER_STAGE_COUNT
+} ei_profiler_stage_t;
+
+typedef struct {
+    uint64_t start_us;
+    uint32_t allocs;
+    uint32_t alloc_bytes;
+} ei_profiler_mark_t;
+
+#if EI_PROFILER_STAGES == 1
+/**
+ * Start of a stage, only reads the timer while a benchmark is recording
+ */
+ei_profiler_mark_t ei_profiler_stage_begin(void);
+/**
+ * End of a stage, records one sample
+ */
+void ei_profiler_stage_end(ei_profiler_stage_t stage, const ei_profiler_mark_t *mark);
+/**
+ * End of a stage that runs once per axis, adds to the sample for the current
+ * window. The window is recorded by ei_profiler_stage_flush
+ */
+void ei_profiler_stage_add(ei_profiler_stage_t stage, const ei_profiler_mark_t *mark);
+void ei_profiler_stage_flush(void);
+
+#define EI_PROFILER_STAGE_BEGIN(mark)       ei_profiler_mark_t mark = ei_profiler_stage_begin()
+#define EI_PROFILER_STAGE_END(stage, mark)  ei_profiler_stage_end(stage, &mark)
+#define EI_PROFILER_STAGE_ADD(stage, mark)  ei_profiler_stage_add(stage, &mark)
+#else
+#define EI_PROFILER_STAGE_BEGIN(mark)
+#define EI_PROFILER_STAGE_END(stage, mark)
+#define EI_PROFILER_STAGE_ADD(stage, mark)
+#endif // EI_PROFILER_STAGES == 1
+
+// Scope trace into a fixed-size ring, read back by firmware-sdk/ei_trace.cpp.
+// Cortex-M3/M4/M7 count CPU cycles with the DWT, other targets nanoseconds
+// from clock_gettime. Off by default, the scope markers compile away.
+#ifndef EI_PROFILER_TRACE
+#define EI_PROFILER_TRACE           0
+#endif // EI_PROFILER_TRACE
+
+#if EI_PROFILER_TRACE == 1
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define EI_PROFILER_TRACE_DWT       1
+#ifndef EI_PROFILER_TRACE_CPU_HZ
+#define EI_PROFILER_TRACE_CPU_HZ    156000000
+#endif // EI_PROFILER_TRACE_CPU_HZ
+#define EI_PROFILER_TRACE_TICKS_PER_US  (EI_PROFILER_TRACE_CPU_HZ / 1000000)
+
+static inline uint32_t ei_profiler_trace_now(void)
+{
+    return *(volatile uint32_t *)0xE0001004; // DWT_CYCCNT
+}
+#else
+#include <time.h>
+#define EI_PROFILER_TRACE_DWT       0
+#define EI_PROFILER_TRACE_TICKS_PER_US  1000
+
+static inline uint32_t ei_profiler_trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+#endif // __ARM_ARCH_7M__ || __ARM_ARCH_7EM__
+
+/**
+ * Add one scope to the trace ring, safe from any thread or interrupt
+ */
+void ei_profiler_trace_record(const char *name, uint32_t start, uint32_t end);
+
+class EiTraceScope {
+public:
+    EiTraceScope(const char *name) : _name(name), _start(ei_profiler_trace_now())
+    {
+    }
+    ~EiTraceScope()
+    {
+        ei_profiler_trace_record(_name, _start, ei_profiler_trace_now());
+    }
+
+private:
+    EiTraceScope(const EiTraceScope&);
+    EiTraceScope& operator=(const EiTraceScope&);
+
+    const char *_name;
+    uint32_t _start;
+};
+
+#define EI_PROFILER_TRACE_SCOPE(name)   EiTraceScope ei_trace_scope(name)
+#else
+#define EI_PROFILER_TRACE_SCOPE(name)
+#endif // EI_PROFILER_TRACE == 1
+
 #endif  //!__EIPROFILER__H__
@@ -57,8 +57,35 @@
 
 #define EI_MAX_UINT16 65535
 
+#ifndef EIDSP_FFT_PLAN_COUNT
+#define EIDSP_FFT_PLAN_COUNT            8
+#endif // EIDSP_FFT_PLAN_COUNT
+
 namespace ei {
 
+typedef enum {
+    fft_plan_none = 0,
+    fft_plan_kiss_f32,
+    fft_plan_cmsis_f32,
+    fft_plan_cmsis_q15,
+    fft_plan_cmsis_q31
+} fft_plan_type_t;
+
+// real FFT setup for one length and type, shared between all invocations
+typedef struct {
+    fft_plan_type_t type;
+    size_t n_fft;
+    kiss_fftr_cfg kiss_cfg;
+    size_t kiss_cfg_size;
+#if EIDSP_USE_CMSIS_DSP
+    union {
+        arm_rfft_fast_instance_f32 f32;
+        arm_rfft_instance_q15 q15;
+        arm_rfft_instance_q31 q31;
+    } cmsis;
+#endif
+} fft_plan_t;
+
 // clang-format off
 // lookup table for quantized values between 0.0f and 1.0f
 static constexpr float quantized_values_one_zero[] = { (0.0f / 1.0f), (1.0f / 100.0f), (2.0f / 100.0f), (3.0f / 100.0f), (4.0f / 100.0f), (1.0f / 22.0f), (1.0f / 21.0f), (1.0f / 20.0f), (1.0f / 19.0f), (1.0f / 18.0f), (1.0f / 17.0f), (6.0f / 100.0f), (1.0f / 16.0f), (1.0f / 15.0f), (7.0f / 100.0f), (1.0f / 14.0f), (1.0f / 13.0f), (8.0f / 100.0f), (1.0f / 12.0f), (9.0f / 100.0f), (1.0f / 11.0f), (2.0f / 21.0f), (1.0f / 10.0f), (2.0f / 19.0f), (11.0f / 100.0f), (1.0f / 9.0f), (2.0f / 17.0f), (12.0f / 100.0f), (1.0f / 8.0f), (13.0f / 100.0f), (2.0f / 15.0f), (3.0f / 22.0f), (14.0f / 100.0f), (1.0f / 7.0f), (3.0f / 20.0f), (2.0f / 13.0f), (3.0f / 19.0f), (16.0f / 100.0f), (1.0f / 6.0f), (17.0f / 100.0f), (3.0f / 17.0f), (18.0f / 100.0f), (2.0f / 11.0f), (3.0f / 16.0f), (19.0f / 100.0f), (4.0f / 21.0f), (1.0f / 5.0f), (21.0f / 100.0f), (4.0f / 19.0f), (3.0f / 14.0f), (22.0f / 100.0f), (2.0f / 9.0f), (5.0f / 22.0f), (23.0f / 100.0f), (3.0f / 13.0f), (4.0f / 17.0f), (5.0f / 21.0f), (24.0f / 100.0f), (1.0f / 4.0f), (26.0f / 100.0f), (5.0f / 19.0f), (4.0f / 15.0f), (27.0f / 100.0f), (3.0f / 11.0f), (5.0f / 18.0f), (28.0f / 100.0f), (2.0f / 7.0f), (29.0f / 100.0f), (5.0f / 17.0f), (3.0f / 10.0f), (4.0f / 13.0f), (31.0f / 100.0f), (5.0f / 16.0f), (6.0f / 19.0f), (7.0f / 22.0f), (32.0f / 100.0f), (33.0f / 100.0f), (1.0f / 3.0f), (34.0f / 100.0f), (7.0f / 20.0f), (6.0f / 17.0f), (5.0f / 14.0f), (36.0f / 100.0f), (4.0f / 11.0f), (7.0f / 19.0f), (37.0f / 100.0f), (3.0f / 8.0f), (38.0f / 100.0f), (8.0f / 21.0f), (5.0f / 13.0f), (7.0f / 18.0f), (39.0f / 100.0f), (2.0f / 5.0f), (9.0f / 22.0f), (41.0f / 100.0f), (7.0f / 17.0f), (5.0f / 12.0f), (42.0f / 100.0f), (8.0f / 19.0f), (3.0f / 7.0f), (43.0f / 100.0f), (7.0f / 16.0f), (44.0f / 100.0f), (4.0f / 9.0f), (9.0f / 20.0f), (5.0f / 11.0f), (46.0f / 100.0f), (6.0f / 13.0f), (7.0f / 15.0f), (47.0f / 100.0f), (8.0f / 17.0f), (9.0f / 19.0f), (10.0f / 21.0f), (48.0f / 100.0f), (49.0f / 100.0f), (1.0f / 2.0f), (51.0f / 100.0f), (52.0f / 100.0f), (11.0f / 21.0f), (10.0f / 19.0f), (9.0f / 17.0f), (53.0f / 100.0f), (8.0f / 15.0f), (7.0f / 13.0f), (54.0f / 100.0f), (6.0f / 11.0f), (11.0f / 20.0f), (5.0f / 9.0f), (56.0f / 100.0f), (9.0f / 16.0f), (57.0f / 100.0f), (4.0f / 7.0f), (11.0f / 19.0f), (58.0f / 100.0f), (7.0f / 12.0f), (10.0f / 17.0f), (59.0f / 100.0f), (13.0f / 22.0f), (3.0f / 5.0f), (61.0f / 100.0f), (11.0f / 18.0f), (8.0f / 13.0f), (13.0f / 21.0f), (62.0f / 100.0f), (5.0f / 8.0f), (63.0f / 100.0f), (12.0f / 19.0f), (7.0f / 11.0f), (64.0f / 100.0f), (9.0f / 14.0f), (11.0f / 17.0f), (13.0f / 20.0f), (66.0f / 100.0f), (2.0f / 3.0f), (67.0f / 100.0f), (68.0f / 100.0f), (15.0f / 22.0f), (13.0f / 19.0f), (11.0f / 16.0f), (69.0f / 100.0f), (9.0f / 13.0f), (7.0f / 10.0f), (12.0f / 17.0f), (71.0f / 100.0f), (5.0f / 7.0f), (72.0f / 100.0f), (13.0f / 18.0f), (8.0f / 11.0f), (73.0f / 100.0f), (11.0f / 15.0f), (14.0f / 19.0f), (74.0f / 100.0f), (3.0f / 4.0f), (76.0f / 100.0f), (16.0f / 21.0f), (13.0f / 17.0f), (10.0f / 13.0f), (77.0f / 100.0f), (17.0f / 22.0f), (7.0f / 9.0f), (78.0f / 100.0f), (11.0f / 14.0f), (15.0f / 19.0f), (79.0f / 100.0f), (4.0f / 5.0f), (17.0f / 21.0f), (81.0f / 100.0f), (13.0f / 16.0f), (9.0f / 11.0f), (82.0f / 100.0f), (14.0f / 17.0f), (83.0f / 100.0f), (5.0f / 6.0f), (84.0f / 100.0f), (16.0f / 19.0f), (11.0f / 13.0f), (17.0f / 20.0f), (6.0f / 7.0f), (86.0f / 100.0f), (19.0f / 22.0f), (13.0f / 15.0f), (87.0f / 100.0f), (7.0f / 8.0f), (88.0f / 100.0f), (15.0f / 17.0f), (8.0f / 9.0f), (89.0f / 100.0f), (17.0f / 19.0f), (9.0f / 10.0f), (19.0f / 21.0f), (10.0f / 11.0f), (91.0f / 100.0f), (11.0f / 12.0f), (92.0f / 100.0f), (12.0f / 13.0f), (13.0f / 14.0f), (93.0f / 100.0f), (14.0f / 15.0f), (15.0f / 16.0f), (94.0f / 100.0f), (16.0f / 17.0f), (17.0f / 18.0f), (18.0f / 19.0f), (19.0f / 20.0f), (20.0f / 21.0f), (21.0f / 22.0f), (96.0f / 100.0f), (97.0f / 100.0f), (98.0f / 100.0f), (99.0f / 100.0f), (1.0f / 1.0f) ,
@@ -1395,7 +1422,7 @@ public:
         else {
             // hardware acceleration only works for the powers above...
             arm_rfft_fast_instance_f32 rfft_instance;
-            int status = cmsis_rfft_init_f32(&rfft_instance, n_fft);
+            int status = rfft_plan_f32(&rfft_instance, n_fft);
             if (status != ARM_MATH_SUCCESS) {
                 return status;
             }
@@ -1465,7 +1492,7 @@ public:
         } else {
             // hardware acceleration only works for the powers above...
             arm_rfft_instance_q15 rfft_instance;
-            arm_status status = arm_rfft_init_q15(&rfft_instance, n_fft, 0, 1);
+            arm_status status = rfft_plan_q15(&rfft_instance, n_fft);
             if (status != ARM_MATH_SUCCESS) {
                 return (int)status;
             }
@@ -1535,7 +1562,7 @@ public:
         } else {
             // hardware acceleration only works for the powers above...
             arm_rfft_instance_q31 rfft_instance;
-            arm_status status = arm_rfft_init_q31(&rfft_instance, n_fft, 0, 1);
+            arm_status status = rfft_plan_q31(&rfft_instance, n_fft);
             if (status != ARM_MATH_SUCCESS) {
                 return status;
             }
@@ -1617,7 +1644,7 @@ public:
         else {
             // hardware acceleration only works for the powers above...
             arm_rfft_fast_instance_f32 rfft_instance;
-            int status = cmsis_rfft_init_f32(&rfft_instance, n_fft);
+            int status = rfft_plan_f32(&rfft_instance, n_fft);
             if (status != ARM_MATH_SUCCESS) {
                 return status;
             }
@@ -1689,7 +1716,7 @@ public:
         else {
             // hardware acceleration only works for the powers above...
             arm_rfft_instance_q15 rfft_instance;
-            arm_status status = arm_rfft_init_q15(&rfft_instance, n_fft, 0, 1);
+            arm_status status = rfft_plan_q15(&rfft_instance, n_fft);
             if (status != ARM_MATH_SUCCESS) {
                 return status;
             }
@@ -1949,6 +1976,50 @@ public:
         signal->get_data = [data](size_t offset, size_t length, float *out_ptr) {
             return numpy::signal_get_data(data, offset, length, out_ptr);
         };
+#endif
+        signal->view.buffer = data;
+        signal->view.frame_stride = 1;
+        signal->view.axis_stride = 1;
+        signal->view.axes = NULL;
+        signal->view.axes_count = 1;
+        signal->view.frames = data_size;
+        signal->view.scale = 1.0f;
+        return EIDSP_OK;
+    }
+
+    /**
+     * Create a signal structure from a buffer that holds one row per axis
+     * (e.g. filled by the sampler), the signal itself is interleaved.
+     * @param data Buffer of axes * samples values, make sure to keep this pointer alive
+     * @param samples Samples per axis
+     * @param axes Number of axes
+     * @param scale Multiplier already applied to the values in data
+     * @param signal Output signal
+     * @returns EIDSP_OK if ok
+     */
+    static int signal_from_axes_buffer(const float *data, size_t samples, size_t axes, float scale, signal_t *signal)
+    {
+        if (axes == 0 || scale == 0.0f) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        signal->total_length = samples * axes;
+        signal->view.buffer = data;
+        signal->view.frame_stride = 1;
+        signal->view.axis_stride = samples;
+        signal->view.axes = NULL;
+        signal->view.axes_count = axes;
+        signal->view.frames = samples;
+        signal->view.scale = scale;
+
+        ei_signal_view_t view = signal->view;
+#ifdef __MBED__
+        // mbed::Callback cannot hold the view, read it through a copy on the signal
+        signal->get_data = mbed::callback(&numpy::signal_view_get_data, &signal->view);
+#else
+        signal->get_data = [view](size_t offset, size_t length, float *out_ptr) {
+            return numpy::signal_view_get_data(&view, offset, length, out_ptr);
+        };
 #endif
         return EIDSP_OK;
     }
@@ -1975,6 +2046,110 @@ public:
         return EIDSP_OK;
     }
 
+    /**
+     * Look at a signal view as frames of `axes_count` values. A plain buffer
+     * (one axis, stride 1) is split into interleaved frames.
+     * @param view Signal view
+     * @param axes_count Values per frame the caller expects
+     * @param out_view Output view, may be the same as view
+     * @returns false if there is no view, or it cannot be seen that way
+     */
+    static bool signal_view_as_frames(const ei_signal_view_t *view, size_t axes_count, ei_signal_view_t *out_view)
+    {
+        if (view->buffer == NULL || axes_count == 0) {
+            return false;
+        }
+        if (view->axes_count == axes_count) {
+            *out_view = *view;
+            return true;
+        }
+        if (view->axes_count == 1 && view->frame_stride == 1 && view->axes == NULL
+                && view->frames % axes_count == 0) {
+            out_view->buffer = view->buffer;
+            out_view->frame_stride = axes_count;
+            out_view->axis_stride = 1;
+            out_view->axes = NULL;
+            out_view->axes_count = axes_count;
+            out_view->frames = view->frames / axes_count;
+            out_view->scale = view->scale;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Copy values out of a signal view, in signal order (frames interleaved).
+     * The same as get_data, without a call per value.
+     * @param view Signal view
+     * @param offset Offset in values, the signal has frames * axes_count values
+     * @param length Number of values
+     * @param out_ptr Output buffer of length values
+     * @returns 0 if OK
+     */
+    static int signal_view_get_data(const ei_signal_view_t *view, size_t offset, size_t length, float *out_ptr)
+    {
+        if (offset + length > view->frames * view->axes_count) {
+            EIDSP_ERR(EIDSP_OUT_OF_BOUNDS);
+        }
+
+        // contiguous, one copy
+        if (view->axes == NULL && view->axis_stride == 1 && view->frame_stride == view->axes_count
+                && view->scale == 1.0f) {
+            memcpy(out_ptr, view->buffer + offset, length * sizeof(float));
+            return EIDSP_OK;
+        }
+
+        const float unscale = 1.0f / view->scale;
+        size_t frame = offset / view->axes_count;
+        size_t ax = offset % view->axes_count;
+        const float *frame_ptr = view->buffer + frame * view->frame_stride;
+        for (size_t ix = 0; ix < length; ix++) {
+            float v = frame_ptr[(view->axes ? view->axes[ax] : ax) * view->axis_stride];
+            out_ptr[ix] = view->scale == 1.0f ? v : v * unscale;
+            if (++ax == view->axes_count) {
+                ax = 0;
+                frame_ptr += view->frame_stride;
+            }
+        }
+        return EIDSP_OK;
+    }
+
+    /**
+     * Copy one axis of a signal view into a contiguous row, optionally scaled.
+     * A scale the view already applied is not applied again.
+     * @param view Signal view
+     * @param axis Axis index, below view->axes_count
+     * @param scale Multiplier for every value of the signal
+     * @param out_ptr Output buffer of view->frames values
+     * @returns 0 if OK
+     */
+    static int signal_view_get_axis(const ei_signal_view_t *view, size_t axis, float scale, float *out_ptr)
+    {
+        if (axis >= view->axes_count) {
+            EIDSP_ERR(EIDSP_OUT_OF_BOUNDS);
+        }
+
+        const float *in_ptr = view->buffer + (view->axes ? view->axes[axis] : axis) * view->axis_stride;
+        const size_t stride = view->frame_stride;
+        if (view->scale != 1.0f) {
+            scale = scale == view->scale ? 1.0f : scale / view->scale;
+        }
+        if (scale == 1.0f && stride == 1) {
+            memcpy(out_ptr, in_ptr, view->frames * sizeof(float));
+        }
+        else if (scale == 1.0f) {
+            for (size_t ix = 0; ix < view->frames; ix++) {
+                out_ptr[ix] = in_ptr[ix * stride];
+            }
+        }
+        else {
+            for (size_t ix = 0; ix < view->frames; ix++) {
+                out_ptr[ix] = in_ptr[ix * stride] * scale;
+            }
+        }
+        return EIDSP_OK;
+    }
+
 #if defined ( __GNUC__ )
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
@@ -1992,10 +2167,10 @@ public:
         float m, r, s, t, i, f;
         int32_t e, g;
 
-        g = (int32_t) * ((int32_t *)&a);
+        memcpy(&g, &a, sizeof(g));
         e = (g - 0x3f2aaaab) & 0xff800000;
         g = g - e;
-        m = (float) * ((float *)&g);
+        memcpy(&m, &g, sizeof(m));
         i = (float)e * 1.19209290e-7f; // 0x1.0p-23
         /* m in [2/3, 4/3] */
         f = m - 1.0f;
@@ -2095,6 +2270,93 @@ public:
         return (int32_t)val;
     }
 
+    /**
+     * Split a positive real multiplier into a q31 mantissa and a right shift,
+     * so it can be applied to integers with `multiply_by_quantized_multiplier`.
+     * Done once per scale, the per-value work is then integer only.
+     * @param multiplier Real multiplier, larger than 0
+     * @param mantissa Out, in [2^30, 2^31)
+     * @param shift Out, right shift after multiplying with the mantissa
+     * @returns 0 if OK
+     */
+    static int quantize_multiplier(float multiplier, int32_t *mantissa, int *shift)
+    {
+        if (!(multiplier > 0.0f)) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        int exponent;
+        double fraction = frexp((double)multiplier, &exponent);
+        int64_t m = (int64_t)::round(fraction * 2147483648.0);
+        if (m == ((int64_t)1 << 31)) {
+            m /= 2;
+            exponent++;
+        }
+
+        *mantissa = (int32_t)m;
+        *shift = 31 - exponent;
+        return EIDSP_OK;
+    }
+
+    /**
+     * Multiply an integer with a multiplier from `quantize_multiplier`, rounding
+     * to nearest. Large values are scaled down first so the product fits 64 bits,
+     * this only drops bits far below the precision of the mantissa.
+     * @param x Value
+     * @param mantissa Mantissa from `quantize_multiplier`
+     * @param shift Shift from `quantize_multiplier`, plus any extra right shift
+     * @returns Saturated 32 bit result
+     */
+    static int32_t multiply_by_quantized_multiplier(int64_t x, int32_t mantissa, int shift)
+    {
+        const int64_t limit = (int64_t)1 << 32;
+        while (x >= limit || x <= -limit) {
+            x /= 2;
+            shift--;
+        }
+
+        int64_t prod = x * mantissa;
+        if (shift > 62) {
+            return 0;
+        }
+        if (shift > 0) {
+            return saturate((prod + ((int64_t)1 << (shift - 1))) >> shift, 32);
+        }
+        // left shift, stop as soon as it saturates anyway
+        for (; shift < 0 && prod <= INT32_MAX && prod >= INT32_MIN; shift++) {
+            prod *= 2;
+        }
+        return saturate(prod, 32);
+    }
+
+    /**
+     * Integer square root, rounded down
+     * @param x Value
+     * @returns floor(sqrt(x))
+     */
+    static uint32_t sqrt_u64(uint64_t x)
+    {
+        uint64_t result = 0;
+        uint64_t bit = (uint64_t)1 << 62;
+
+        while (bit > x) {
+            bit >>= 2;
+        }
+
+        while (bit != 0) {
+            if (x >= result + bit) {
+                x -= result + bit;
+                result = (result >> 1) + bit;
+            }
+            else {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+
+        return (uint32_t)result;
+    }
+
     /**
      * Normalize a matrix to 0..1. Does an in-place replacement.
      * Normalization done per row.
@@ -2188,16 +2450,19 @@ private:
             EIDSP_ERR(EIDSP_OUT_OF_MEM);
         }
 
-        size_t kiss_fftr_mem_length;
+        size_t kiss_fftr_mem_length = 0;
 
-        // create fftr context
-        kiss_fftr_cfg cfg = kiss_fftr_alloc(n_fft, 0, NULL, NULL, &kiss_fftr_mem_length);
+        // use the cached fftr context, or create one if the cache is full
+        kiss_fftr_cfg cfg = get_kiss_fftr_plan(n_fft);
         if (!cfg) {
-            ei_dsp_free(fft_output, n_fft_out_features * sizeof(kiss_fft_cpx));
-            EIDSP_ERR(EIDSP_OUT_OF_MEM);
-        }
+            cfg = kiss_fftr_alloc(n_fft, 0, NULL, NULL, &kiss_fftr_mem_length);
+            if (!cfg) {
+                ei_dsp_free(fft_output, n_fft_out_features * sizeof(kiss_fft_cpx));
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
 
-        ei_dsp_register_alloc(kiss_fftr_mem_length, cfg);
+            ei_dsp_register_alloc(kiss_fftr_mem_length, cfg);
+        }
 
         // execute the rfft operation
         kiss_fftr(cfg, fft_input, fft_output);
@@ -2207,7 +2472,9 @@ private:
             output[ix] = sqrt(pow(fft_output[ix].r, 2) + pow(fft_output[ix].i, 2));
         }
 
-        ei_dsp_free(cfg, kiss_fftr_mem_length);
+        if (kiss_fftr_mem_length > 0) {
+            ei_dsp_free(cfg, kiss_fftr_mem_length);
+        }
         ei_dsp_free(fft_output, n_fft_out_features * sizeof(kiss_fft_cpx));
 
         return EIDSP_OK;
@@ -2215,20 +2482,25 @@ private:
 
     static int software_rfft(float *fft_input, fft_complex_t *output, size_t n_fft, size_t n_fft_out_features)
     {
-        // create fftr context
-        size_t kiss_fftr_mem_length;
+        size_t kiss_fftr_mem_length = 0;
 
-        kiss_fftr_cfg cfg = kiss_fftr_alloc(n_fft, 0, NULL, NULL, &kiss_fftr_mem_length);
+        // use the cached fftr context, or create one if the cache is full
+        kiss_fftr_cfg cfg = get_kiss_fftr_plan(n_fft);
         if (!cfg) {
-            EIDSP_ERR(EIDSP_OUT_OF_MEM);
-        }
+            cfg = kiss_fftr_alloc(n_fft, 0, NULL, NULL, &kiss_fftr_mem_length);
+            if (!cfg) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
 
-        ei_dsp_register_alloc(kiss_fftr_mem_length, cfg);
+            ei_dsp_register_alloc(kiss_fftr_mem_length, cfg);
+        }
 
         // execute the rfft operation
         kiss_fftr(cfg, fft_input, (kiss_fft_cpx*)output);
 
-        ei_dsp_free(cfg, kiss_fftr_mem_length);
+        if (kiss_fftr_mem_length > 0) {
+            ei_dsp_free(cfg, kiss_fftr_mem_length);
+        }
 
         return EIDSP_OK;
     }
@@ -2592,6 +2864,8 @@ private:
         }
     }
 
+public:
+
 #if EIDSP_USE_CMSIS_DSP
     /**
      * Initialize a CMSIS-DSP fast rfft structure
@@ -2726,6 +3000,202 @@ private:
 #endif
     }
 #endif // #if EIDSP_USE_CMSIS_DSP
+
+    /**
+     * Forward kissfft real FFT config for this length. It's allocated on first use
+     * and shared by every caller until `clear_fft_plans`.
+     * The config holds scratch memory, so don't use it from two threads at once.
+     * @param n_fft FFT length
+     * @returns the config, or NULL if the cache is full or out of memory
+     *          (the caller then needs to allocate its own)
+     */
+    static kiss_fftr_cfg get_kiss_fftr_plan(size_t n_fft)
+    {
+        fft_plan_t *plan = get_fft_plan_entry(fft_plan_kiss_f32, n_fft);
+        if (!plan) {
+            return NULL;
+        }
+
+        if (plan->type == fft_plan_none) {
+            size_t kiss_fftr_mem_length;
+            kiss_fftr_cfg cfg = kiss_fftr_alloc(n_fft, 0, NULL, NULL, &kiss_fftr_mem_length);
+            if (!cfg) {
+                return NULL;
+            }
+            ei_dsp_register_alloc(kiss_fftr_mem_length, cfg);
+
+            plan->kiss_cfg = cfg;
+            plan->kiss_cfg_size = kiss_fftr_mem_length;
+            plan->type = fft_plan_kiss_f32;
+        }
+
+        return plan->kiss_cfg;
+    }
+
+#if EIDSP_USE_CMSIS_DSP
+    /**
+     * Same as `cmsis_rfft_init_f32`, but the instance is only set up once per length
+     * and copied from the plan cache afterwards.
+     */
+    static int rfft_plan_f32(arm_rfft_fast_instance_f32 *rfft_instance, const size_t n_fft)
+    {
+        fft_plan_t *plan = get_fft_plan_entry(fft_plan_cmsis_f32, n_fft);
+        if (plan && plan->type == fft_plan_cmsis_f32) {
+            *rfft_instance = plan->cmsis.f32;
+            return ARM_MATH_SUCCESS;
+        }
+
+        int status = cmsis_rfft_init_f32(rfft_instance, n_fft);
+        if (status == ARM_MATH_SUCCESS && plan) {
+            plan->cmsis.f32 = *rfft_instance;
+            plan->type = fft_plan_cmsis_f32;
+        }
+        return status;
+    }
+
+    /**
+     * Same as `arm_rfft_init_q15` (forward, bit reversed output), but the instance
+     * is only set up once per length and copied from the plan cache afterwards.
+     */
+    static arm_status rfft_plan_q15(arm_rfft_instance_q15 *rfft_instance, const size_t n_fft)
+    {
+        fft_plan_t *plan = get_fft_plan_entry(fft_plan_cmsis_q15, n_fft);
+        if (plan && plan->type == fft_plan_cmsis_q15) {
+            *rfft_instance = plan->cmsis.q15;
+            return ARM_MATH_SUCCESS;
+        }
+
+        arm_status status = arm_rfft_init_q15(rfft_instance, n_fft, 0, 1);
+        if (status == ARM_MATH_SUCCESS && plan) {
+            plan->cmsis.q15 = *rfft_instance;
+            plan->type = fft_plan_cmsis_q15;
+        }
+        return status;
+    }
+
+    /**
+     * Same as `arm_rfft_init_q31` (forward, bit reversed output), but the instance
+     * is only set up once per length and copied from the plan cache afterwards.
+     */
+    static arm_status rfft_plan_q31(arm_rfft_instance_q31 *rfft_instance, const size_t n_fft)
+    {
+        fft_plan_t *plan = get_fft_plan_entry(fft_plan_cmsis_q31, n_fft);
+        if (plan && plan->type == fft_plan_cmsis_q31) {
+            *rfft_instance = plan->cmsis.q31;
+            return ARM_MATH_SUCCESS;
+        }
+
+        arm_status status = arm_rfft_init_q31(rfft_instance, n_fft, 0, 1);
+        if (status == ARM_MATH_SUCCESS && plan) {
+            plan->cmsis.q31 = *rfft_instance;
+            plan->type = fft_plan_cmsis_q31;
+        }
+        return status;
+    }
+#endif // #if EIDSP_USE_CMSIS_DSP
+
+    /**
+     * Set up the float FFT plans for all lengths the model declares (EI_CLASSIFIER_LOAD_FFT_*),
+     * so the kissfft twiddles are allocated at init time rather than in the first window.
+     * Plans for other lengths and types are still created on first use.
+     * @returns 0 if OK
+     */
+    static int preload_fft_plans()
+    {
+#if EI_CLASSIFIER_HAS_FFT_INFO == 1
+        const size_t lengths[] = {
+#if EI_CLASSIFIER_LOAD_FFT_32 == 1
+            32,
+#endif
+#if EI_CLASSIFIER_LOAD_FFT_64 == 1
+            64,
+#endif
+#if EI_CLASSIFIER_LOAD_FFT_128 == 1
+            128,
+#endif
+#if EI_CLASSIFIER_LOAD_FFT_256 == 1
+            256,
+#endif
+#if EI_CLASSIFIER_LOAD_FFT_512 == 1
+            512,
+#endif
+#if EI_CLASSIFIER_LOAD_FFT_1024 == 1
+            1024,
+#endif
+#if EI_CLASSIFIER_LOAD_FFT_2048 == 1
+            2048,
+#endif
+#if EI_CLASSIFIER_LOAD_FFT_4096 == 1
+            4096,
+#endif
+            0
+        };
+
+        for (size_t ix = 0; lengths[ix] != 0; ix++) {
+#if EIDSP_USE_CMSIS_DSP
+            arm_rfft_fast_instance_f32 rfft_instance;
+            int status = rfft_plan_f32(&rfft_instance, lengths[ix]);
+            if (status != ARM_MATH_SUCCESS) {
+                return status;
+            }
+#else
+            if (!get_kiss_fftr_plan(lengths[ix])) {
+                EIDSP_ERR(EIDSP_OUT_OF_MEM);
+            }
+#endif
+        }
+#endif // EI_CLASSIFIER_HAS_FFT_INFO == 1
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Free all cached FFT plans. Anything that still holds a kissfft config from
+     * `get_kiss_fftr_plan` needs to be released first.
+     */
+    static void clear_fft_plans()
+    {
+        fft_plan_t *plans = get_fft_plans();
+
+        for (size_t ix = 0; ix < EIDSP_FFT_PLAN_COUNT; ix++) {
+            if (plans[ix].type == fft_plan_kiss_f32) {
+                ei_dsp_free(plans[ix].kiss_cfg, plans[ix].kiss_cfg_size);
+            }
+            memset(&plans[ix], 0, sizeof(fft_plan_t));
+        }
+    }
+
+private:
+    static fft_plan_t *get_fft_plans()
+    {
+        static fft_plan_t plans[EIDSP_FFT_PLAN_COUNT];
+        return plans;
+    }
+
+    /**
+     * Find the plan slot for this FFT type and length, or claim a free one
+     * (the plan type is then still fft_plan_none).
+     * Returns NULL if all slots are taken.
+     */
+    static fft_plan_t *get_fft_plan_entry(fft_plan_type_t type, size_t n_fft)
+    {
+        fft_plan_t *plans = get_fft_plans();
+
+        for (size_t ix = 0; ix < EIDSP_FFT_PLAN_COUNT; ix++) {
+            fft_plan_t *plan = &plans[ix];
+
+            if (plan->type == fft_plan_none) {
+                plan->n_fft = n_fft;
+                return plan;
+            }
+
+            if (plan->type == type && plan->n_fft == n_fft) {
+                return plan;
+            }
+        }
+
+        return NULL;
+    }
 };
 
 } // namespace ei
@@ -27,6 +27,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stddef.h>
+#include <math.h>
 #ifdef __cplusplus
 #include <functional>
 #ifdef __MBED__
@@ -495,6 +496,24 @@ typedef enum {
     DCT_NORMALIZATION_ORTHO
 } DCT_NORMALIZATION_MODE;
 
+/**
+ * Zero-copy view of a signal that lives in memory, as frames of axes_count
+ * values. Value `ax` of frame `f` is
+ * buffer[f * frame_stride + axes[ax] * axis_stride] / scale, without the axis
+ * map axes[ax] is ax. A plain buffer is one axis with a frame_stride of 1, a
+ * buffer with one row per axis has a frame_stride of 1 and an axis_stride of
+ * frames.
+ */
+typedef struct {
+    const float *buffer;        // NULL if the signal has no view
+    size_t frame_stride;
+    size_t axis_stride;
+    const uint8_t *axes;        // NULL for axes 0..axes_count-1
+    size_t axes_count;
+    size_t frames;
+    float scale;                // already applied to the values in buffer
+} ei_signal_view_t;
+
 /**
  * Sensor signal structure
  */
@@ -517,6 +536,16 @@ typedef struct ei_signal_t {
 #endif // EIDSP_SIGNAL_C_FN_POINTER == 1
 
     size_t total_length;
+
+    /**
+     * Set when the signal is a buffer in memory (see numpy::signal_from_buffer),
+     * DSP blocks then read it directly instead of through get_data
+     */
+#ifdef __cplusplus
+    ei_signal_view_t view = { NULL, 0, 0, NULL, 0, 0, 1.0f };
+#else
+    ei_signal_view_t view;
+#endif // __cplusplus
 } signal_t;
 
 typedef struct ei_signal_i16_t {
@@ -538,8 +567,139 @@ typedef struct ei_signal_i16_t {
 #endif // EIDSP_SIGNAL_C_FN_POINTER == 1
 
     size_t total_length;
+
+    /**
+     * Physical units per LSB, for signals of raw sensor counts. DSP blocks that
+     * work on the counts directly (e.g. the fixed-point spectral analysis) fold
+     * it into their output scaling.
+     */
+#ifdef __cplusplus
+    float scale = 1.0f;
+#else
+    float scale;
+#endif // __cplusplus
 } signal_i16_t;
 
+/**
+ * Where DSP blocks write their features. Either float into `buffer`, or
+ * quantized (value / scale + zero_point, saturated) into `buffer_i8`, e.g. the
+ * int8 input tensor of the model. The features `capture_ix` selects are then
+ * also kept as float in `capture`, so the few that anomaly detection needs
+ * do not have to be dequantized again.
+ */
+typedef struct ei_feature_sink {
+    float *buffer;
+    int8_t *buffer_i8;
+    float scale;
+    int32_t zero_point;
+    size_t size;                    // features in this sink
+    size_t offset;                  // index of the first one in the whole feature vector
+    const uint16_t *capture_ix;     // indices in the whole feature vector
+    size_t capture_count;
+    float *capture;                 // capture_count values
+
+#ifdef __cplusplus
+    /**
+     * Write float features
+     * @param a_buffer Buffer of a_size values
+     * @param a_size Number of features
+     */
+    ei_feature_sink(float *a_buffer, size_t a_size)
+        : buffer(a_buffer), buffer_i8(NULL), scale(1.0f), zero_point(0),
+          size(a_size), offset(0), capture_ix(NULL), capture_count(0), capture(NULL)
+    {
+    }
+
+    /**
+     * Write int8 features
+     * @param a_buffer Buffer of a_size values
+     * @param a_size Number of features
+     * @param a_scale Quantization scale
+     * @param a_zero_point Quantization zero point
+     */
+    ei_feature_sink(int8_t *a_buffer, size_t a_size, float a_scale, int32_t a_zero_point)
+        : buffer(NULL), buffer_i8(a_buffer), scale(a_scale), zero_point(a_zero_point),
+          size(a_size), offset(0), capture_ix(NULL), capture_count(0), capture(NULL)
+    {
+    }
+
+    /**
+     * Also keep these features as float
+     * @param ix Indices in the feature vector
+     * @param count Number of indices
+     * @param out Buffer of count values
+     */
+    void set_capture(const uint16_t *ix, size_t count, float *out) {
+        capture_ix = ix;
+        capture_count = count;
+        capture = out;
+    }
+
+    /**
+     * Part of this sink, e.g. for one DSP block. Shares the capture.
+     * @param a_offset First feature of the part
+     * @param a_size Number of features
+     */
+    ei_feature_sink slice(size_t a_offset, size_t a_size) const {
+        ei_feature_sink part = *this;
+        if (part.buffer) {
+            part.buffer += a_offset;
+        }
+        if (part.buffer_i8) {
+            part.buffer_i8 += a_offset;
+        }
+        part.offset += a_offset;
+        part.size = a_size;
+        return part;
+    }
+
+    /**
+     * Write features
+     * @param ix Index of the first one in this sink
+     * @param values Features
+     * @param count Number of features
+     * @returns false if they do not fit
+     */
+    bool write(size_t ix, const float *values, size_t count) {
+        if (ix + count > size) {
+            return false;
+        }
+
+        if (buffer) {
+            if (buffer + ix != values) {
+                memcpy(buffer + ix, values, count * sizeof(float));
+            }
+        }
+        else {
+            for (size_t vx = 0; vx < count; vx++) {
+                int32_t q = (int32_t)roundf(values[vx] / scale) + zero_point;
+                buffer_i8[ix + vx] = (int8_t)(q > 127 ? 127 : (q < -128 ? -128 : q));
+            }
+        }
+
+        for (size_t cx = 0; cx < capture_count; cx++) {
+            size_t fx = capture_ix[cx];
+            if (fx >= offset + ix && fx < offset + ix + count) {
+                capture[cx] = values[fx - offset - ix];
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * A feature as written, dequantized for int8 sinks
+     * @param ix Index in this sink
+     */
+    float get(size_t ix) const {
+        if (buffer) {
+            return buffer[ix];
+        }
+        return (float)(buffer_i8[ix] - zero_point) * scale;
+    }
+#endif // __cplusplus
+} feature_sink_t;
+
 #ifdef __cplusplus
 } // namespace ei {
 #endif // __cplusplus
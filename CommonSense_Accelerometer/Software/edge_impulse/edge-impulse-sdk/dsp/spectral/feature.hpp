@@ -117,8 +117,31 @@ public:
             EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
         }
 
-        // find peaks in FFT
-        EI_DSP_MATRIX(peaks_matrix, axes, fft_peaks * 2);
+        const uint16_t n_fft_bins = fft_length / 2 + 1;
+        const uint16_t nperseg = fft_length > input_matrix->cols ?
+            static_cast<uint16_t>(input_matrix->cols) : fft_length;
+
+        // spectrum of the segment window, used to detrend the periodogram without a second FFT
+        EI_DSP_MATRIX(window_matrix, 1, nperseg);
+        for (uint16_t ix = 0; ix < nperseg; ix++) {
+            window_matrix.buffer[ix] = 1.0f;
+        }
+        EI_DSP_MATRIX(window_fft_matrix, 1, n_fft_bins * 2);
+        fft_complex_t *window_fft = (fft_complex_t*)window_fft_matrix.buffer;
+        ret = numpy::rfft(window_matrix.buffer, window_matrix.cols, window_fft, n_fft_bins, fft_length);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // one complex spectrum per axis, shared by the peaks and the periodogram
+        EI_DSP_MATRIX(axis_fft_matrix, 1, n_fft_bins * 2);
+        fft_complex_t *axis_fft = (fft_complex_t*)axis_fft_matrix.buffer;
+
+        EI_DSP_MATRIX(fft_matrix, 1, n_fft_bins);
+        EI_DSP_MATRIX(peaks_matrix, fft_peaks, 2);
+        EI_DSP_MATRIX(period_fft_matrix, 1, n_fft_bins);
+        EI_DSP_MATRIX(period_freq_matrix, 1, n_fft_bins);
+        EI_DSP_MATRIX(edges_matrix_out, edges_matrix_in->rows - 1, 1);
 
         for (size_t row = 0; row < input_matrix->rows; row++) {
             // per axis code
@@ -126,18 +149,28 @@ public:
             // get a slice of the current axis
             EI_DSP_MATRIX_B(axis_matrix, 1, input_matrix->cols, input_matrix->buffer + (row * input_matrix->cols));
 
+            // mean of the periodogram segment (before the FFT, which may work in place)
+            EI_DSP_MATRIX_B(segment_matrix, 1, nperseg, axis_matrix.buffer);
+            float segment_mean;
+            EI_DSP_MATRIX_B(segment_mean_matrix, 1, 1, &segment_mean);
+            ret = numpy::mean(&segment_matrix, &segment_mean_matrix);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+
             // calculate FFT
-            EI_DSP_MATRIX(fft_matrix, 1, fft_length / 2 + 1);
-            ret = numpy::rfft(axis_matrix.buffer, axis_matrix.cols, fft_matrix.buffer, fft_matrix.cols, fft_length);
+            ret = numpy::rfft(axis_matrix.buffer, axis_matrix.cols, axis_fft, n_fft_bins, fft_length);
             if (ret != EIDSP_OK) {
                 EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
             }
 
-            // multiply by 2/N
+            // magnitude, multiplied by 2/N
+            for (uint16_t ix = 0; ix < n_fft_bins; ix++) {
+                fft_matrix.buffer[ix] = sqrt(pow(axis_fft[ix].r, 2) + pow(axis_fft[ix].i, 2));
+            }
             numpy::scale(&fft_matrix, (2.0f / static_cast<float>(fft_length)));
 
             // we're now using the FFT matrix to calculate peaks etc.
-            EI_DSP_MATRIX(peaks_matrix, fft_peaks, 2);
             ret = spectral::processing::find_fft_peaks(&fft_matrix, &peaks_matrix,
                 sampling_freq, fft_peaks_threshold, fft_length);
             if (ret != EIDSP_OK) {
@@ -145,15 +178,12 @@ public:
             }
 
             // calculate periodogram for spectral power buckets
-            EI_DSP_MATRIX(period_fft_matrix, 1, fft_length / 2 + 1);
-            EI_DSP_MATRIX(period_freq_matrix, 1, fft_length / 2 + 1);
-            ret = spectral::processing::periodogram(&axis_matrix,
-                &period_fft_matrix, &period_freq_matrix, sampling_freq, fft_length);
+            ret = spectral::processing::periodogram(axis_fft, window_fft, segment_mean,
+                &period_fft_matrix, &period_freq_matrix, sampling_freq, fft_length, nperseg);
             if (ret != EIDSP_OK) {
                 EIDSP_ERR(ret);
             }
 
-            EI_DSP_MATRIX(edges_matrix_out, edges_matrix_in->rows - 1, 1);
             ret = spectral::processing::spectral_power_edges(
                 &period_fft_matrix,
                 &period_freq_matrix,
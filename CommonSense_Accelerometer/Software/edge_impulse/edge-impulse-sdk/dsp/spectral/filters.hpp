@@ -33,117 +33,228 @@
 namespace ei {
 namespace spectral {
 namespace filters {
+
+#ifndef EI_DSP_BUTTERWORTH_MAX_STEPS
+#define EI_DSP_BUTTERWORTH_MAX_STEPS    8
+#endif // EI_DSP_BUTTERWORTH_MAX_STEPS
+
+    /**
+     * Coefficients for a cascade of second order Butterworth sections.
+     * Calculate once with `butterworth_lowpass_coeffs` / `butterworth_highpass_coeffs`
+     * and load into a `butterworth_filter`.
+     */
+    typedef struct {
+        int n_steps;
+        bool highpass;
+        float A[EI_DSP_BUTTERWORTH_MAX_STEPS];
+        float d1[EI_DSP_BUTTERWORTH_MAX_STEPS];
+        float d2[EI_DSP_BUTTERWORTH_MAX_STEPS];
+    } butterworth_coeffs_t;
+
     /**
-     * The Butterworth filter has maximally flat frequency response in the passband.
-     * @param filter_order Even filter order (between 2..8)
+     * Calculate the lowpass Butterworth filter parameters
+     * @param filter_order Even filter order (between 2..16)
      * @param sampling_freq Sample frequency of the signal
      * @param cutoff_freq Cut-off frequency of the signal
-     * @param src Source array
-     * @param dest Destination array
-     * @param size Size of both source and destination arrays
+     * @param coeffs Out parameter with the filter parameters
+     * @returns 0 if OK
      */
-    static void butterworth_lowpass(
+    static int butterworth_lowpass_coeffs(
         int filter_order,
         float sampling_freq,
         float cutoff_freq,
-        const float *src,
-        float *dest,
-        size_t size)
+        butterworth_coeffs_t *coeffs)
     {
         int n_steps = filter_order / 2;
+        if (n_steps < 0 || n_steps > EI_DSP_BUTTERWORTH_MAX_STEPS) {
+            EIDSP_ERR(EIDSP_UNSUPPORTED_FILTER_CONFIG);
+        }
+
         float a = tan(M_PI * cutoff_freq / sampling_freq);
         float a2 = pow(a, 2);
-        float *A = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
-        for(int ix = 0; ix < n_steps; ix++) {
-            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
-            sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = a2 / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
-        }
 
-        // Apply the filter
-        for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
+        coeffs->n_steps = n_steps;
+        coeffs->highpass = false;
 
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] + (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
-            }
+        for (int ix = 0; ix < n_steps; ix++) {
+            float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
+            sampling_freq = a2 + (2.0 * a * r) + 1.0;
+            coeffs->A[ix] = a2 / sampling_freq;
+            coeffs->d1[ix] = 2.0 * (1 - a2) / sampling_freq;
+            coeffs->d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
         }
 
-        ei_free(A);
-        ei_free(d1);
-        ei_free(d2);
-        ei_free(w0);
-        ei_free(w1);
-        ei_free(w2);
+        return EIDSP_OK;
     }
 
     /**
-     * The Butterworth filter has maximally flat frequency response in the passband.
-     * @param filter_order Even filter order (between 2..8)
+     * Calculate the highpass Butterworth filter parameters
+     * @param filter_order Even filter order (between 2..16)
      * @param sampling_freq Sample frequency of the signal
      * @param cutoff_freq Cut-off frequency of the signal
-     * @param src Source array
-     * @param dest Destination array
-     * @param size Size of both source and destination arrays
+     * @param coeffs Out parameter with the filter parameters
+     * @returns 0 if OK
      */
-    static void butterworth_highpass(
+    static int butterworth_highpass_coeffs(
         int filter_order,
         float sampling_freq,
         float cutoff_freq,
-        const float *src,
-        float *dest,
-        size_t size)
+        butterworth_coeffs_t *coeffs)
     {
         int n_steps = filter_order / 2;
+        if (n_steps < 0 || n_steps > EI_DSP_BUTTERWORTH_MAX_STEPS) {
+            EIDSP_ERR(EIDSP_UNSUPPORTED_FILTER_CONFIG);
+        }
+
         float a = tan(M_PI * cutoff_freq / sampling_freq);
         float a2 = pow(a, 2);
-        float *A = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *d2 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w0 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w1 = (float*)ei_calloc(n_steps, sizeof(float));
-        float *w2 = (float*)ei_calloc(n_steps, sizeof(float));
-
-        // Calculate the filter parameters
+
+        coeffs->n_steps = n_steps;
+        coeffs->highpass = true;
+
         for (int ix = 0; ix < n_steps; ix++) {
             float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
             sampling_freq = a2 + (2.0 * a * r) + 1.0;
-            A[ix] = 1.0f / sampling_freq;
-            d1[ix] = 2.0 * (1 - a2) / sampling_freq;
-            d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
+            coeffs->A[ix] = 1.0f / sampling_freq;
+            coeffs->d1[ix] = 2.0 * (1 - a2) / sampling_freq;
+            coeffs->d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
         }
 
-        // Apply the filter
-        for (size_t sx = 0; sx < size; sx++) {
-            dest[sx] = src[sx];
+        return EIDSP_OK;
+    }
+
+    /**
+     * Butterworth filter as a cascade of biquads (direct form II transposed).
+     * Coefficients are calculated once, and the filter state is kept between calls
+     * to `apply`, so a signal can be filtered in chunks (e.g. continuously, one
+     * window at a time). Call `reset` to start a new, independent signal.
+     * Uses `arm_biquad_cascade_df2T_f32` when CMSIS-DSP is available.
+     */
+    class butterworth_filter {
+public:
+        butterworth_filter()
+            : _n_stages(0)
+        {
+            memset(_state, 0, sizeof(_state));
+        }
 
-            for (int i = 0; i < n_steps; i++) {
-                w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
-                dest[sx] = A[i] * (w0[i] - (2.0 * w1[i]) + w2[i]);
-                w2[i] = w1[i];
-                w1[i] = w0[i];
+        /**
+         * Load precalculated filter parameters, this also resets the filter state
+         * @param coeffs Parameters from `butterworth_lowpass_coeffs` / `butterworth_highpass_coeffs`
+         * @returns 0 if OK
+         */
+        int init(const butterworth_coeffs_t *coeffs) {
+            if (coeffs->n_steps < 0 || coeffs->n_steps > EI_DSP_BUTTERWORTH_MAX_STEPS) {
+                EIDSP_ERR(EIDSP_UNSUPPORTED_FILTER_CONFIG);
             }
+
+            _n_stages = coeffs->n_steps;
+
+            // every section is A * (1 +/- 2z^-1 + z^-2) / (1 - d1 z^-1 - d2 z^-2)
+            for (int ix = 0; ix < _n_stages; ix++) {
+                float *c = _coeffs + (ix * 5);
+                c[0] = coeffs->A[ix];
+                c[1] = coeffs->highpass ? -2.0f * coeffs->A[ix] : 2.0f * coeffs->A[ix];
+                c[2] = coeffs->A[ix];
+                c[3] = coeffs->d1[ix];
+                c[4] = coeffs->d2[ix];
+            }
+
+#if EIDSP_USE_CMSIS_DSP
+            arm_biquad_cascade_df2T_init_f32(&_instance, static_cast<uint8_t>(_n_stages), _coeffs, _state);
+#endif
+            reset();
+
+            return EIDSP_OK;
         }
 
-        ei_free(A);
-        ei_free(d1);
-        ei_free(d2);
-        ei_free(w0);
-        ei_free(w1);
-        ei_free(w2);
-    }
+        /**
+         * Create a lowpass filter
+         * @param filter_order Even filter order (between 2..16)
+         * @param sampling_freq Sample frequency of the signal
+         * @param cutoff_freq Cut-off frequency of the signal
+         * @returns 0 if OK
+         */
+        int init_lowpass(int filter_order, float sampling_freq, float cutoff_freq) {
+            butterworth_coeffs_t coeffs;
+            int ret = butterworth_lowpass_coeffs(filter_order, sampling_freq, cutoff_freq, &coeffs);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+            return init(&coeffs);
+        }
+
+        /**
+         * Create a highpass filter
+         * @param filter_order Even filter order (between 2..16)
+         * @param sampling_freq Sample frequency of the signal
+         * @param cutoff_freq Cut-off frequency of the signal
+         * @returns 0 if OK
+         */
+        int init_highpass(int filter_order, float sampling_freq, float cutoff_freq) {
+            butterworth_coeffs_t coeffs;
+            int ret = butterworth_highpass_coeffs(filter_order, sampling_freq, cutoff_freq, &coeffs);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+            return init(&coeffs);
+        }
+
+        /**
+         * Clear the filter state
+         */
+        void reset() {
+            memset(_state, 0, sizeof(_state));
+        }
+
+        /**
+         * Filter a chunk of the signal, continuing from the state of the previous call
+         * @param src Source array
+         * @param dest Destination array (can be the same as src)
+         * @param size Size of both source and destination arrays
+         */
+        void apply(const float *src, float *dest, size_t size) {
+            if (_n_stages == 0) {
+                if (dest != src) {
+                    memcpy(dest, src, size * sizeof(float));
+                }
+                return;
+            }
+
+#if EIDSP_USE_CMSIS_DSP
+            arm_biquad_cascade_df2T_f32(&_instance, src, dest, size);
+#else
+            for (int stage = 0; stage < _n_stages; stage++) {
+                const float *c = _coeffs + (stage * 5);
+                const float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+                float s1 = _state[stage * 2];
+                float s2 = _state[stage * 2 + 1];
+
+                // first stage reads from src, the rest work in place on dest
+                const float *in = stage == 0 ? src : dest;
+
+                for (size_t sx = 0; sx < size; sx++) {
+                    float x = in[sx];
+                    float y = b0 * x + s1;
+                    s1 = b1 * x + a1 * y + s2;
+                    s2 = b2 * x + a2 * y;
+                    dest[sx] = y;
+                }
+
+                _state[stage * 2] = s1;
+                _state[stage * 2 + 1] = s2;
+            }
+#endif
+        }
+
+private:
+        int _n_stages;
+        float _coeffs[EI_DSP_BUTTERWORTH_MAX_STEPS * 5];
+        float _state[EI_DSP_BUTTERWORTH_MAX_STEPS * 2];
+#if EIDSP_USE_CMSIS_DSP
+        arm_biquad_cascade_df2T_instance_f32 _instance;
+#endif
+    };
 
 } // namespace filters
 } // namespace spectral
@@ -0,0 +1,627 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _EIDSP_SPECTRAL_PLAN_H_
+#define _EIDSP_SPECTRAL_PLAN_H_
+
+#include <algorithm>
+#include <stdint.h>
+#include "../numpy.hpp"
+#include "../ei_profiler.h"
+#include "filters.hpp"
+#include "processing.hpp"
+#include "feature.hpp"
+
+#ifndef EI_DSP_SPECTRAL_MAX_EDGES
+#define EI_DSP_SPECTRAL_MAX_EDGES       64
+#endif // EI_DSP_SPECTRAL_MAX_EDGES
+
+namespace ei {
+namespace spectral {
+
+/**
+ * Precompiled spectral analysis for a fixed configuration.
+ * Everything that only depends on the configuration (filter coefficients, FFT
+ * instance, frequency bins, spectral edges and all scratch buffers) is set up
+ * once in the constructor, so `run` only does the per-window math and never
+ * allocates. Output matches `feature::spectral_analysis`.
+ */
+class spectral_analysis_plan {
+public:
+    /**
+     * Create a new plan
+     * @param axes Number of axes in the signal
+     * @param samples_per_axis Number of samples per axis in a window
+     * @param sampling_freq Sampling frequency of the signal
+     * @param scale_axes Scale to apply to the raw signal
+     * @param filter_type Filter type
+     * @param filter_cutoff Filter cutoff frequency
+     * @param filter_order Filter order
+     * @param fft_length Length of the FFT signal
+     * @param fft_peaks Number of FFT peaks to find
+     * @param fft_peaks_threshold Minimum threshold
+     * @param spectral_power_edges Spectral power edges (e.g. "0.1, 0.5, 1.0, 2.0, 5.0")
+     */
+    spectral_analysis_plan(
+        size_t axes,
+        size_t samples_per_axis,
+        float sampling_freq,
+        float scale_axes,
+        filter_t filter_type,
+        float filter_cutoff,
+        uint8_t filter_order,
+        uint16_t fft_length,
+        uint8_t fft_peaks,
+        float fft_peaks_threshold,
+        const char *spectral_power_edges)
+        : _axes(axes), _samples(samples_per_axis), _sampling_freq(sampling_freq),
+          _scale_axes(scale_axes), _filter_type(filter_type), _n_fft(fft_length),
+          _fft_peaks(fft_peaks), _fft_peaks_threshold(fft_peaks_threshold),
+          _edge_count(0), _arena(NULL), _arena_size(0)
+#if EIDSP_USE_CMSIS_DSP
+          , _use_cmsis(false)
+#endif
+          , _kiss_cfg(NULL), _kiss_cfg_size(0)
+    {
+        _status = init(filter_cutoff, filter_order, spectral_power_edges);
+    }
+
+    ~spectral_analysis_plan() {
+        // a config from the FFT plan cache has no size, it's not ours to free
+        if (_kiss_cfg && _kiss_cfg_size > 0) {
+            ei_dsp_free(_kiss_cfg, _kiss_cfg_size);
+        }
+        if (_arena) {
+            ei_dsp_free(_arena, _arena_size);
+        }
+    }
+
+    /**
+     * Whether the plan was created succesfully
+     * @returns 0 if OK
+     */
+    int status() {
+        return _status;
+    }
+
+    /**
+     * Number of features per axis that `run` writes
+     */
+    size_t get_features_per_axis() {
+        return feature::calculate_spectral_buffer_size(true, _fft_peaks, _edge_count);
+    }
+
+    /**
+     * Calculate the spectral features over a window
+     * @param signal Interleaved signal, needs `axes * samples_per_axis` values
+     * @param out_features Output buffer of `axes * get_features_per_axis()` values
+     * @returns 0 if OK
+     */
+    int run(ei_signal_t *signal, float *out_features) {
+        feature_sink_t sink(out_features, _axes * get_features_per_axis());
+        return run(signal, &sink);
+    }
+
+    /**
+     * Calculate the spectral features over a window, every axis is written
+     * to the sink as soon as it is done
+     * @param signal Interleaved signal, needs `axes * samples_per_axis` values
+     * @param sink Output, room for `axes * get_features_per_axis()` values
+     * @returns 0 if OK
+     */
+    int run(ei_signal_t *signal, feature_sink_t *sink) {
+        if (_status != EIDSP_OK) {
+            EIDSP_ERR(_status);
+        }
+
+        if (signal->total_length != _axes * _samples) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        int ret;
+        ei_signal_view_t view;
+        if (numpy::signal_view_as_frames(&signal->view, _axes, &view) && view.frames == _samples) {
+            // in memory: scale and deinterleave straight from the view, one row per axis
+            EI_PROFILER_STAGE_BEGIN(transpose_mark);
+            for (size_t ax = 0; ax < _axes; ax++) {
+                ret = numpy::signal_view_get_axis(&view, ax, _scale_axes, _data + (ax * _samples));
+                if (ret != EIDSP_OK) {
+                    EIDSP_ERR(ret);
+                }
+            }
+            EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_SCALE_TRANSPOSE, transpose_mark);
+        }
+        else {
+            EI_PROFILER_STAGE_BEGIN(copy_mark);
+            ret = signal->get_data(0, signal->total_length, _raw);
+            if (ret != 0) {
+                EIDSP_ERR(ret);
+            }
+            EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_COPY, copy_mark);
+
+            // scale and transpose in one go, so we have one row per axis
+            EI_PROFILER_STAGE_BEGIN(transpose_mark);
+            for (size_t ix = 0; ix < _samples; ix++) {
+                const float *sample = _raw + (ix * _axes);
+                for (size_t ax = 0; ax < _axes; ax++) {
+                    float v = sample[ax];
+                    if (_scale_axes != 1.0f) {
+                        v *= _scale_axes;
+                    }
+                    _data[ax * _samples + ix] = v;
+                }
+            }
+            EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_SCALE_TRANSPOSE, transpose_mark);
+        }
+
+        matrix_t data_matrix(_axes, _samples, _data);
+        matrix_t axes_matrix(_axes, 1, _axes_scratch);
+
+        EI_PROFILER_STAGE_BEGIN(mean_mark);
+        ret = numpy::mean(&data_matrix, &axes_matrix);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        ret = numpy::subtract(&data_matrix, &axes_matrix);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+        EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_MEAN, mean_mark);
+
+        if (_filter_type != filter_none) {
+            EI_PROFILER_STAGE_BEGIN(filter_mark);
+            for (size_t ax = 0; ax < _axes; ax++) {
+                float *axis = _data + (ax * _samples);
+                // every window is filtered independently, like during training
+                _filter.reset();
+                _filter.apply(axis, axis, _samples);
+            }
+            EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_FILTER, filter_mark);
+        }
+
+        EI_PROFILER_STAGE_BEGIN(rms_mark);
+        ret = numpy::rms(&data_matrix, &axes_matrix);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+        EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_MEAN, rms_mark);
+
+        const size_t features_per_axis = get_features_per_axis();
+
+        for (size_t ax = 0; ax < _axes; ax++) {
+            float *axis = _data + (ax * _samples);
+            float *features_row = _row;
+            size_t fx = 0;
+
+            features_row[fx++] = _axes_scratch[ax];
+
+            // mean of the periodogram segment, the periodogram is detrended from the same spectrum
+            float segment_mean;
+            matrix_t segment_matrix(1, _nperseg, axis);
+            matrix_t segment_mean_matrix(1, 1, &segment_mean);
+            ret = numpy::mean(&segment_matrix, &segment_mean_matrix);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+
+            // one FFT per axis, shared by the peaks and the periodogram
+            EI_PROFILER_STAGE_BEGIN(fft_mark);
+            rfft(axis, _samples);
+            EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_FFT, fft_mark);
+
+            EI_PROFILER_STAGE_BEGIN(peaks_mark);
+            ret = fft_peaks(features_row + fx);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+            EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_PEAKS, peaks_mark);
+            fx += _fft_peaks * 2;
+
+            EI_PROFILER_STAGE_BEGIN(edges_mark);
+            ret = power_edges(segment_mean, features_row + fx);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+            EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_POWER_EDGES, edges_mark);
+
+            if (!sink->write(ax * features_per_axis, features_row, features_per_axis)) {
+                EIDSP_ERR(EIDSP_OUT_OF_BOUNDS);
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+private:
+    spectral_analysis_plan(const spectral_analysis_plan&);
+    spectral_analysis_plan& operator=(const spectral_analysis_plan&);
+
+    int init(float filter_cutoff, uint8_t filter_order, const char *spectral_power_edges) {
+        int ret = EIDSP_OK;
+
+        if (_axes == 0 || _samples == 0 || _n_fft < 2) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        ret = parse_edges(spectral_power_edges);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        if (_filter_type == filter_lowpass) {
+            ret = _filter.init_lowpass(filter_order, _sampling_freq, filter_cutoff);
+        }
+        else if (_filter_type == filter_highpass) {
+            ret = _filter.init_highpass(filter_order, _sampling_freq, filter_cutoff);
+        }
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        const size_t bins = _n_fft / 2 + 1;
+        const size_t peak_candidates = _fft_peaks * 10;
+
+        _arena_size = (
+            (_axes * _samples * 2) +    // raw + axis major data
+            _axes +                     // mean / rms per axis
+            _n_fft +                    // fft input
+            (bins * 2) +                // fft output (complex)
+            (bins * 2) +                // segment window spectrum (complex)
+            (bins * 4) +                // magnitude, peak freq space, power, power freq
+            (peak_candidates * 2) +     // peaks (freq, amplitude)
+            get_features_per_axis()     // features of one axis
+        ) * sizeof(float);
+#if EIDSP_USE_CMSIS_DSP
+        _arena_size += _n_fft * sizeof(float);  // packed fft output
+#endif
+
+        _arena = (float*)ei_dsp_calloc(_arena_size, 1);
+        if (!_arena) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        float *ptr = _arena;
+        _raw = ptr;             ptr += _axes * _samples;
+        _data = ptr;            ptr += _axes * _samples;
+        _axes_scratch = ptr;    ptr += _axes;
+        _fft_in = ptr;          ptr += _n_fft;
+        _fft_out = (fft_complex_t*)ptr; ptr += bins * 2;
+        _window_fft = (fft_complex_t*)ptr; ptr += bins * 2;
+        _magnitude = ptr;       ptr += bins;
+        _peak_freq = ptr;       ptr += bins;
+        _power = ptr;           ptr += bins;
+        _power_freq = ptr;      ptr += bins;
+        _peaks = (processing::freq_peak_t*)ptr; ptr += peak_candidates * 2;
+        _row = ptr;             ptr += get_features_per_axis();
+#if EIDSP_USE_CMSIS_DSP
+        _fft_packed = ptr;      ptr += _n_fft;
+#endif
+
+        // frequency bins for the peaks
+        float T = 1.0f / _sampling_freq;
+        int N = static_cast<int>(_n_fft);
+        ret = numpy::linspace(0.0f, 1.0f / (2.0f * T), floor(N / 2), _peak_freq);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        _nperseg = _n_fft > _samples ? _samples : _n_fft;
+
+        ret = init_fft();
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // spectrum of the segment window (nperseg ones), use the data buffer as scratch
+        for (uint16_t ix = 0; ix < _nperseg; ix++) {
+            _data[ix] = 1.0f;
+        }
+        rfft(_data, _nperseg);
+        complex();
+        memcpy(_window_fft, _fft_out, bins * sizeof(fft_complex_t));
+
+        return EIDSP_OK;
+    }
+
+    int init_fft() {
+#if EIDSP_USE_CMSIS_DSP
+        if (_n_fft == 32 || _n_fft == 64 || _n_fft == 128 || _n_fft == 256 ||
+            _n_fft == 512 || _n_fft == 1024 || _n_fft == 2048 || _n_fft == 4096) {
+            int status = numpy::rfft_plan_f32(&_rfft_instance, _n_fft);
+            if (status != ARM_MATH_SUCCESS) {
+                return status;
+            }
+            _use_cmsis = true;
+            return EIDSP_OK;
+        }
+#endif
+
+        _kiss_cfg = numpy::get_kiss_fftr_plan(_n_fft);
+        if (_kiss_cfg) {
+            return EIDSP_OK;
+        }
+
+        // the FFT plan cache is full, so this plan gets its own config
+        _kiss_cfg = kiss_fftr_alloc(_n_fft, 0, NULL, NULL, &_kiss_cfg_size);
+        if (!_kiss_cfg) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        ei_dsp_register_alloc(_kiss_cfg_size, _kiss_cfg);
+
+        return EIDSP_OK;
+    }
+
+    int parse_edges(const char *spectral_power_edges) {
+        const char *spectral_ptr = spectral_power_edges;
+
+        while (spectral_ptr != NULL) {
+            while ((*spectral_ptr) == ' ') {
+                spectral_ptr++;
+            }
+
+            if (_edge_count == EI_DSP_SPECTRAL_MAX_EDGES) {
+                EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+            }
+            _edges[_edge_count++] = atof(spectral_ptr);
+
+            // find next (spectral) delimiter (or '\0' character)
+            while ((*spectral_ptr != ',')) {
+                spectral_ptr++;
+                if (*spectral_ptr == '\0') break;
+            }
+
+            if (*spectral_ptr == '\0') {
+                spectral_ptr = NULL;
+            }
+            else {
+                spectral_ptr++;
+            }
+        }
+
+        if (_edge_count < 2) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Copy (and zero pad) the source into the FFT input and run the real FFT
+     */
+    void rfft(const float *src, size_t src_size) {
+        if (src_size > _n_fft) {
+            src_size = _n_fft;
+        }
+
+        memcpy(_fft_in, src, src_size * sizeof(float));
+        memset(_fft_in + src_size, 0, (_n_fft - src_size) * sizeof(float));
+
+#if EIDSP_USE_CMSIS_DSP
+        if (_use_cmsis) {
+            arm_rfft_fast_f32(&_rfft_instance, _fft_in, _fft_packed, 0);
+            return;
+        }
+#endif
+        kiss_fftr(_kiss_cfg, _fft_in, (kiss_fft_cpx*)_fft_out);
+    }
+
+    /**
+     * FFT magnitude of the last `rfft` call, scaled by 2/N
+     */
+    void magnitude() {
+        const size_t bins = _n_fft / 2 + 1;
+
+#if EIDSP_USE_CMSIS_DSP
+        if (_use_cmsis) {
+            _magnitude[0] = _fft_packed[0];
+            _magnitude[bins - 1] = _fft_packed[1];
+
+            for (size_t ix = 1; ix < bins - 1; ix++) {
+                float rms_result;
+                arm_rms_f32(_fft_packed + (ix * 2), 2, &rms_result);
+                _magnitude[ix] = rms_result * sqrt(2);
+            }
+        }
+        else
+#endif
+        {
+            for (size_t ix = 0; ix < bins; ix++) {
+                _magnitude[ix] = sqrt(pow(_fft_out[ix].r, 2) + pow(_fft_out[ix].i, 2));
+            }
+        }
+
+        matrix_t magnitude_matrix(1, bins, _magnitude);
+        numpy::scale(&magnitude_matrix, (2.0f / static_cast<float>(_n_fft)));
+    }
+
+    /**
+     * Complex output of the last `rfft` call, in `_fft_out`
+     */
+    void complex() {
+#if EIDSP_USE_CMSIS_DSP
+        if (_use_cmsis) {
+            const size_t bins = _n_fft / 2 + 1;
+
+            _fft_out[0].r = _fft_packed[0];
+            _fft_out[0].i = 0.0f;
+            _fft_out[bins - 1].r = _fft_packed[1];
+            _fft_out[bins - 1].i = 0.0f;
+
+            for (size_t ix = 1; ix < bins - 1; ix++) {
+                _fft_out[ix].r = _fft_packed[ix * 2];
+                _fft_out[ix].i = _fft_packed[(ix * 2) + 1];
+            }
+        }
+#endif
+    }
+
+    /**
+     * Find the highest peaks in the spectrum of the last `rfft` call
+     * @param out Output buffer of (freq, amplitude) pairs, one per peak
+     */
+    int fft_peaks(float *out) {
+        if (_fft_peaks == 0) {
+            return EIDSP_OK;
+        }
+
+        magnitude();
+
+        const size_t in_size = _n_fft / 2 + 1;
+        const size_t max_peaks = _fft_peaks * 10;
+        size_t peak_count = 0;
+
+        float prev = _magnitude[0];
+
+        for (size_t ix = 1; ix < in_size - 1; ix++) {
+            float v = _magnitude[ix];
+            // first make sure it's actually a peak...
+            if (v > prev && v > _magnitude[ix + 1]) {
+                float height = (v - prev) + (v - _magnitude[ix + 1]);
+                if (height > 0.0f) {
+                    processing::freq_peak_t *d = &_peaks[peak_count++];
+                    d->freq = _peak_freq[ix];
+                    d->amplitude = v;
+                    if (d->amplitude < _fft_peaks_threshold) {
+                        d->freq = 0.0f;
+                        d->amplitude = 0.0f;
+                    }
+                    if (peak_count == max_peaks) break;
+                }
+            }
+
+            prev = v;
+        }
+
+        std::sort(_peaks, _peaks + peak_count,
+            [](const processing::freq_peak_t & a, const processing::freq_peak_t & b) -> bool
+        {
+            return a.amplitude > b.amplitude;
+        });
+
+        for (size_t row = 0; row < _fft_peaks; row++) {
+            if (row < peak_count) {
+                out[row * 2 + 0] = _peaks[row].freq;
+                out[row * 2 + 1] = _peaks[row].amplitude;
+            }
+            else {
+                out[row * 2 + 0] = 0.0f;
+                out[row * 2 + 1] = 0.0f;
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Periodogram of the spectrum of the last `rfft` call, bucketed into the
+     * spectral power edges.
+     * @param segment_mean Mean of the first `nperseg` samples of the axis
+     * @param out Output buffer, one value per edge bucket
+     */
+    int power_edges(float segment_mean, float *out) {
+        const size_t bins = _n_fft / 2 + 1;
+
+        complex();
+
+        matrix_t power_matrix(1, bins, _power);
+        matrix_t power_freq_matrix(1, bins, _power_freq);
+        int ret = processing::periodogram(_fft_out, _window_fft, segment_mean,
+            &power_matrix, &power_freq_matrix, _sampling_freq, _n_fft, _nperseg);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        float buckets[EI_DSP_SPECTRAL_MAX_EDGES] = { 0 };
+        float bucket_count[EI_DSP_SPECTRAL_MAX_EDGES] = { 0 };
+
+        for (uint16_t ix = 0; ix < bins; ix++) {
+            float t = _power_freq[ix];
+            float v = _power[ix];
+
+            // does this fit between any edges?
+            for (uint16_t ex = 0; ex < _edge_count - 1; ex++) {
+                if (t >= _edges[ex] && t < _edges[ex + 1]) {
+                    buckets[ex] += v;
+                    bucket_count[ex]++;
+                    break;
+                }
+            }
+        }
+
+        for (uint16_t ex = 0; ex < _edge_count - 1; ex++) {
+            if (bucket_count[ex] == 0.0f) {
+                out[ex] = 0.0f;
+            }
+            else {
+                out[ex] = (buckets[ex] / bucket_count[ex]) / 10.0f;
+            }
+        }
+
+        return EIDSP_OK;
+    }
+
+    int _status;
+
+    size_t _axes;
+    size_t _samples;
+    float _sampling_freq;
+    float _scale_axes;
+    filter_t _filter_type;
+    uint16_t _n_fft;
+    uint8_t _fft_peaks;
+    float _fft_peaks_threshold;
+    uint16_t _nperseg;
+
+    filters::butterworth_filter _filter;
+
+    float _edges[EI_DSP_SPECTRAL_MAX_EDGES];
+    size_t _edge_count;
+
+    float *_arena;
+    size_t _arena_size;
+    float *_raw;
+    float *_data;
+    float *_axes_scratch;
+    float *_fft_in;
+    fft_complex_t *_fft_out;
+    fft_complex_t *_window_fft;
+    float *_magnitude;
+    float *_peak_freq;
+    float *_power;
+    float *_power_freq;
+    processing::freq_peak_t *_peaks;
+    float *_row;
+
+#if EIDSP_USE_CMSIS_DSP
+    bool _use_cmsis;
+    arm_rfft_fast_instance_f32 _rfft_instance;
+    float *_fft_packed;
+#endif
+    kiss_fftr_cfg _kiss_cfg;
+    size_t _kiss_cfg_size;
+};
+
+} // namespace spectral
+} // namespace ei
+
+#endif // _EIDSP_SPECTRAL_PLAN_H_
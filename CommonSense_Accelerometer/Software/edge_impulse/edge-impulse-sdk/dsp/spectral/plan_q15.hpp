@@ -0,0 +1,701 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _EIDSP_SPECTRAL_PLAN_Q15_H_
+#define _EIDSP_SPECTRAL_PLAN_Q15_H_
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include "../numpy.hpp"
+#include "../ei_profiler.h"
+#include "filters.hpp"
+#include "processing.hpp"
+#include "feature.hpp"
+#include "plan.hpp"
+
+// fraction bits the counts get while filtering, leaves 4 bits of headroom for 16 bit counts
+#ifndef EI_DSP_Q15_GUARD_BITS
+#define EI_DSP_Q15_GUARD_BITS           11
+#endif // EI_DSP_Q15_GUARD_BITS
+
+// fraction bits of the filter coefficients, Butterworth sections need |a1| < 2
+#define EI_DSP_Q15_FILTER_COEFF_BITS    29
+
+namespace ei {
+namespace spectral {
+
+/**
+ * Fixed-point counterpart of `spectral_analysis_plan`, for signals of raw int16
+ * sensor counts. Nothing per window is floating point: mean and filter run in
+ * 32 bit (biquads with q29 coefficients and a 64 bit accumulator), the FFT is a
+ * block floating point q15 real FFT (`arm_rfft_q15`, or a radix-2 fallback with
+ * the same 1/N scaling), and the spectral power edges accumulate in 64 bit.
+ * Features come out as q15 in 32 bit (value * 32768, like `run_inference_i16`
+ * expects). The signal scale (units per count) and the block's scale_axes are
+ * folded into a few integer multipliers, recalculated only when the scale
+ * changes. Output matches `spectral_analysis_plan` to within the fixed-point
+ * precision.
+ */
+class spectral_analysis_plan_q15 {
+public:
+    /**
+     * Create a new plan
+     * @param axes Number of axes in the signal
+     * @param samples_per_axis Number of samples per axis in a window
+     * @param sampling_freq Sampling frequency of the signal
+     * @param scale_axes Scale to apply to the raw signal
+     * @param filter_type Filter type
+     * @param filter_cutoff Filter cutoff frequency
+     * @param filter_order Filter order
+     * @param fft_length Length of the FFT signal, a power of 2
+     * @param fft_peaks Number of FFT peaks to find
+     * @param fft_peaks_threshold Minimum threshold
+     * @param spectral_power_edges Spectral power edges (e.g. "0.1, 0.5, 1.0, 2.0, 5.0")
+     */
+    spectral_analysis_plan_q15(
+        size_t axes,
+        size_t samples_per_axis,
+        float sampling_freq,
+        float scale_axes,
+        filter_t filter_type,
+        float filter_cutoff,
+        uint8_t filter_order,
+        uint16_t fft_length,
+        uint8_t fft_peaks,
+        float fft_peaks_threshold,
+        const char *spectral_power_edges)
+        : _axes(axes), _samples(samples_per_axis), _sampling_freq(sampling_freq),
+          _scale_axes(scale_axes), _filter_type(filter_type), _n_fft(fft_length),
+          _fft_peaks(fft_peaks), _n_stages(0), _edge_count(0), _signal_scale(0.0f),
+          _arena(NULL), _arena_size(0)
+#if EIDSP_USE_CMSIS_DSP
+          , _use_cmsis(false)
+#endif
+    {
+        _threshold = numpy::saturate((int64_t)round(fft_peaks_threshold * 32768.0f), 32);
+        _status = init(filter_cutoff, filter_order, spectral_power_edges);
+    }
+
+    ~spectral_analysis_plan_q15() {
+        if (_arena) {
+            ei_dsp_free(_arena, _arena_size);
+        }
+    }
+
+    /**
+     * Whether the plan was created succesfully
+     * @returns 0 if OK
+     */
+    int status() {
+        return _status;
+    }
+
+    /**
+     * Number of features per axis that `run` writes
+     */
+    size_t get_features_per_axis() {
+        return feature::calculate_spectral_buffer_size(true, _fft_peaks, _edge_count);
+    }
+
+    /**
+     * Calculate the spectral features over a window
+     * @param signal Interleaved signal of raw counts, needs `axes * samples_per_axis` values
+     * @param out_features Output buffer of `axes * get_features_per_axis()` q15 values
+     * @returns 0 if OK
+     */
+    int run(ei_signal_i16_t *signal, EIDSP_i32 *out_features) {
+        if (_status != EIDSP_OK) {
+            EIDSP_ERR(_status);
+        }
+
+        if (signal->total_length != _axes * _samples) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        int ret;
+        if (signal->scale != _signal_scale) {
+            ret = init_multipliers(signal->scale);
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+        }
+
+        EI_PROFILER_STAGE_BEGIN(copy_mark);
+        ret = signal->get_data(0, signal->total_length, _raw);
+        if (ret != 0) {
+            EIDSP_ERR(ret);
+        }
+        EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_COPY, copy_mark);
+
+        // one row per axis, with the guard bits
+        EI_PROFILER_STAGE_BEGIN(transpose_mark);
+        for (size_t ix = 0; ix < _samples; ix++) {
+            const EIDSP_i16 *sample = _raw + (ix * _axes);
+            for (size_t ax = 0; ax < _axes; ax++) {
+                _data[ax * _samples + ix] = (int32_t)sample[ax] * (1 << EI_DSP_Q15_GUARD_BITS);
+            }
+        }
+        EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_SCALE_TRANSPOSE, transpose_mark);
+
+        EI_PROFILER_STAGE_BEGIN(mean_mark);
+        for (size_t ax = 0; ax < _axes; ax++) {
+            int32_t *axis = _data + (ax * _samples);
+            int64_t sum = 0;
+            for (size_t ix = 0; ix < _samples; ix++) {
+                sum += axis[ix];
+            }
+            int32_t mean = (int32_t)div_round(sum, _samples);
+            for (size_t ix = 0; ix < _samples; ix++) {
+                axis[ix] -= mean;
+            }
+        }
+        EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_MEAN, mean_mark);
+
+        if (_filter_type != filter_none) {
+            EI_PROFILER_STAGE_BEGIN(filter_mark);
+            for (size_t ax = 0; ax < _axes; ax++) {
+                // every window is filtered independently, like during training
+                filter(_data + (ax * _samples));
+            }
+            EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_FILTER, filter_mark);
+        }
+
+        const size_t features_per_axis = get_features_per_axis();
+
+        for (size_t ax = 0; ax < _axes; ax++) {
+            EIDSP_i32 *features_row = out_features + (ax * features_per_axis);
+            size_t fx = 0;
+
+            // block floating point: the axis as q15, q = y * 2^-exponent
+            EI_PROFILER_STAGE_BEGIN(rms_mark);
+            int exponent = to_q15(_data + (ax * _samples));
+
+            uint64_t sum_squares = 0;
+            int64_t segment_sum = 0;
+            for (size_t ix = 0; ix < _samples; ix++) {
+                sum_squares += (uint64_t)((int32_t)_q[ix] * _q[ix]);
+                if (ix < _nperseg) {
+                    segment_sum += _q[ix];
+                }
+            }
+            // rms and segment mean with 8 fraction bits
+            uint32_t rms = numpy::sqrt_u64((sum_squares << 16) / _samples);
+            features_row[fx++] = numpy::multiply_by_quantized_multiplier(rms,
+                _rms_mantissa, _rms_shift - exponent);
+            int32_t segment_mean = (int32_t)div_round(segment_sum * 256, _nperseg);
+            EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_MEAN, rms_mark);
+
+            // one FFT per axis, shared by the peaks and the periodogram
+            EI_PROFILER_STAGE_BEGIN(fft_mark);
+            rfft();
+            EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_FFT, fft_mark);
+
+            EI_PROFILER_STAGE_BEGIN(peaks_mark);
+            fft_peaks(exponent, features_row + fx);
+            EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_PEAKS, peaks_mark);
+            fx += _fft_peaks * 2;
+
+            EI_PROFILER_STAGE_BEGIN(edges_mark);
+            power_edges(exponent, segment_mean, features_row + fx);
+            EI_PROFILER_STAGE_ADD(EI_PROFILER_STAGE_POWER_EDGES, edges_mark);
+        }
+
+        return EIDSP_OK;
+    }
+
+private:
+    spectral_analysis_plan_q15(const spectral_analysis_plan_q15&);
+    spectral_analysis_plan_q15& operator=(const spectral_analysis_plan_q15&);
+
+    int init(float filter_cutoff, uint8_t filter_order, const char *spectral_power_edges) {
+        int ret = EIDSP_OK;
+
+        if (_axes == 0 || _samples == 0 || _n_fft < 4 || (_n_fft & (_n_fft - 1)) != 0) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        ret = parse_edges(spectral_power_edges);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        if (_filter_type != filter_none) {
+            filters::butterworth_coeffs_t coeffs;
+            if (_filter_type == filter_lowpass) {
+                ret = filters::butterworth_lowpass_coeffs(filter_order, _sampling_freq, filter_cutoff, &coeffs);
+            }
+            else {
+                ret = filters::butterworth_highpass_coeffs(filter_order, _sampling_freq, filter_cutoff, &coeffs);
+            }
+            if (ret != EIDSP_OK) {
+                EIDSP_ERR(ret);
+            }
+
+            // every section is A * (1 +/- 2z^-1 + z^-2) / (1 - d1 z^-1 - d2 z^-2)
+            _n_stages = coeffs.n_steps;
+            for (int ix = 0; ix < _n_stages; ix++) {
+                int32_t *c = _coeffs + (ix * 5);
+                c[0] = to_coeff(coeffs.A[ix]);
+                c[1] = to_coeff(coeffs.highpass ? -2.0f * coeffs.A[ix] : 2.0f * coeffs.A[ix]);
+                c[2] = to_coeff(coeffs.A[ix]);
+                c[3] = to_coeff(coeffs.d1[ix]);
+                c[4] = to_coeff(coeffs.d2[ix]);
+            }
+        }
+
+        const size_t bins = _n_fft / 2 + 1;
+        const size_t peak_candidates = _fft_peaks * 10;
+
+        _arena_size =
+            (_axes * _samples * sizeof(int32_t)) +                  // axis major data
+            (bins * 2 * sizeof(int32_t)) +                          // segment window spectrum (complex)
+            (bins * 2 * sizeof(int32_t)) +                          // magnitude, peak freq space
+            (peak_candidates * sizeof(processing::freq_peak_i32_t)) + // peaks (freq, amplitude)
+            (_axes * _samples * sizeof(EIDSP_i16)) +                // raw counts
+            (_samples * sizeof(EIDSP_i16)) +                        // one axis as q15
+            (_n_fft * sizeof(EIDSP_i16)) +                          // fft input
+            (_n_fft * 2 * sizeof(EIDSP_i16)) +                      // fft output (complex)
+            (_n_fft * sizeof(EIDSP_i16)) +                          // twiddles (software fft)
+            (bins * sizeof(int8_t));                                // power edge of every bin
+
+        _arena = (uint8_t*)ei_dsp_calloc(_arena_size, 1);
+        if (!_arena) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+
+        // 32 bit buffers first, so everything stays aligned
+        uint8_t *ptr = _arena;
+        _data = (int32_t*)ptr;          ptr += _axes * _samples * sizeof(int32_t);
+        _window_fft = (int32_t*)ptr;    ptr += bins * 2 * sizeof(int32_t);
+        _magnitude = (int32_t*)ptr;     ptr += bins * sizeof(int32_t);
+        _peak_freq = (int32_t*)ptr;     ptr += bins * sizeof(int32_t);
+        _peaks = (processing::freq_peak_i32_t*)ptr; ptr += peak_candidates * sizeof(processing::freq_peak_i32_t);
+        _raw = (EIDSP_i16*)ptr;         ptr += _axes * _samples * sizeof(EIDSP_i16);
+        _q = (EIDSP_i16*)ptr;           ptr += _samples * sizeof(EIDSP_i16);
+        _fft_in = (EIDSP_i16*)ptr;      ptr += _n_fft * sizeof(EIDSP_i16);
+        _fft_out = (EIDSP_i16*)ptr;     ptr += _n_fft * 2 * sizeof(EIDSP_i16);
+        _twiddle = (EIDSP_i16*)ptr;     ptr += _n_fft * sizeof(EIDSP_i16);
+        _bin_edge = (int8_t*)ptr;       ptr += bins * sizeof(int8_t);
+
+        // frequency bins for the peaks, same as numpy::linspace in the float plan
+        float step = (_sampling_freq / 2.0f) / (float)((_n_fft / 2) - 1);
+        for (size_t ix = 0; ix < _n_fft / 2; ix++) {
+            float freq = ix == (_n_fft / 2) - 1 ? _sampling_freq / 2.0f : ix * step;
+            _peak_freq[ix] = numpy::saturate((int64_t)round(freq * 32768.0f), 32);
+        }
+
+        // which power edge every periodogram bin adds to
+        for (size_t ix = 0; ix < bins; ix++) {
+            float t = static_cast<float>(ix) * (1.0f / (_n_fft * (1.0f / _sampling_freq)));
+            _bin_edge[ix] = -1;
+            for (size_t ex = 0; ex < _edge_count - 1; ex++) {
+                if (t >= _edges[ex] && t < _edges[ex + 1]) {
+                    _bin_edge[ix] = (int8_t)ex;
+                    break;
+                }
+            }
+        }
+
+        _nperseg = _n_fft > _samples ? _samples : _n_fft;
+
+        // spectrum of the segment window (nperseg ones), scaled by 1/N like the q15 FFT, as q15
+        for (size_t ix = 0; ix < bins; ix++) {
+            double re = 0.0, im = 0.0;
+            for (size_t n = 0; n < _nperseg; n++) {
+                double phase = -2.0 * M_PI * (double)((ix * n) % _n_fft) / (double)_n_fft;
+                re += cos(phase);
+                im += sin(phase);
+            }
+            _window_fft[ix * 2] = (int32_t)round(re / _n_fft * 32768.0);
+            _window_fft[ix * 2 + 1] = (int32_t)round(im / _n_fft * 32768.0);
+        }
+
+        return init_fft();
+    }
+
+    int init_fft() {
+#if EIDSP_USE_CMSIS_DSP
+        if (_n_fft >= 32 && _n_fft <= 8192) {
+            arm_status status = numpy::rfft_plan_q15(&_rfft_instance, _n_fft);
+            if (status != ARM_MATH_SUCCESS) {
+                return status;
+            }
+            _use_cmsis = true;
+            return EIDSP_OK;
+        }
+#endif
+
+        for (size_t ix = 0; ix < _n_fft / 2; ix++) {
+            double phase = 2.0 * M_PI * (double)ix / (double)_n_fft;
+            _twiddle[ix * 2] = (EIDSP_i16)numpy::saturate((int64_t)round(cos(phase) * 32768.0), 16);
+            _twiddle[ix * 2 + 1] = (EIDSP_i16)numpy::saturate((int64_t)round(sin(phase) * 32768.0), 16);
+        }
+
+        return EIDSP_OK;
+    }
+
+    /**
+     * Work out the integer multipliers for the features, for this signal scale
+     */
+    int init_multipliers(float signal_scale) {
+        const float k = signal_scale * _scale_axes;
+        int ret;
+
+        // rms (8 fraction bits) to q15
+        ret = numpy::quantize_multiplier(ldexpf(k, 7 - EI_DSP_Q15_GUARD_BITS), &_rms_mantissa, &_rms_shift);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // |FFT / N| (8 fraction bits) to 2/N scaled magnitude in q15
+        ret = numpy::quantize_multiplier(ldexpf(k, 8 - EI_DSP_Q15_GUARD_BITS), &_magnitude_mantissa, &_magnitude_shift);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        // |FFT / N|^2 (16 fraction bits) to power density / 10 in q15
+        double power = (double)_n_fft * _n_fft * k * k /
+            (10.0 * _sampling_freq * _nperseg) * ldexp(1.0, -1 - (2 * EI_DSP_Q15_GUARD_BITS));
+        ret = numpy::quantize_multiplier((float)power, &_power_mantissa, &_power_shift);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
+        _signal_scale = signal_scale;
+        return EIDSP_OK;
+    }
+
+    int parse_edges(const char *spectral_power_edges) {
+        const char *spectral_ptr = spectral_power_edges;
+
+        while (spectral_ptr != NULL) {
+            while ((*spectral_ptr) == ' ') {
+                spectral_ptr++;
+            }
+
+            if (_edge_count == EI_DSP_SPECTRAL_MAX_EDGES) {
+                EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+            }
+            _edges[_edge_count++] = atof(spectral_ptr);
+
+            // find next (spectral) delimiter (or '\0' character)
+            while ((*spectral_ptr != ',')) {
+                spectral_ptr++;
+                if (*spectral_ptr == '\0') break;
+            }
+
+            if (*spectral_ptr == '\0') {
+                spectral_ptr = NULL;
+            }
+            else {
+                spectral_ptr++;
+            }
+        }
+
+        if (_edge_count < 2) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        return EIDSP_OK;
+    }
+
+    static int32_t to_coeff(float coeff) {
+        return numpy::saturate((int64_t)round(ldexp((double)coeff, EI_DSP_Q15_FILTER_COEFF_BITS)), 32);
+    }
+
+    static int64_t div_round(int64_t numerator, int64_t denominator) {
+        return numerator >= 0
+            ? (numerator + (denominator / 2)) / denominator
+            : -((-numerator + (denominator / 2)) / denominator);
+    }
+
+    /**
+     * Butterworth filter over one axis in place, as direct form I biquads
+     * (same transfer function as the float plan's direct form II transposed)
+     */
+    void filter(int32_t *axis) {
+        const int64_t round = (int64_t)1 << (EI_DSP_Q15_FILTER_COEFF_BITS - 1);
+
+        for (int stage = 0; stage < _n_stages; stage++) {
+            const int32_t *c = _coeffs + (stage * 5);
+            int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+            for (size_t sx = 0; sx < _samples; sx++) {
+                int32_t x = axis[sx];
+                int64_t acc = (int64_t)c[0] * x + (int64_t)c[1] * x1 + (int64_t)c[2] * x2 +
+                    (int64_t)c[3] * y1 + (int64_t)c[4] * y2;
+                int32_t y = numpy::saturate((acc + round) >> EI_DSP_Q15_FILTER_COEFF_BITS, 32);
+
+                x2 = x1;
+                x1 = x;
+                y2 = y1;
+                y1 = y;
+                axis[sx] = y;
+            }
+        }
+    }
+
+    /**
+     * Convert one axis to q15 in `_q`, using the full 16 bits for the largest value,
+     * and fill the (zero padded) FFT input
+     * @returns Exponent, q = axis * 2^-exponent
+     */
+    int to_q15(const int32_t *axis) {
+        uint32_t max = 0;
+        for (size_t ix = 0; ix < _samples; ix++) {
+            uint32_t v = axis[ix] < 0 ? -(uint32_t)axis[ix] : (uint32_t)axis[ix];
+            if (v > max) {
+                max = v;
+            }
+        }
+
+        int bits = 0;
+        while (bits < 32 && (max >> bits) != 0) {
+            bits++;
+        }
+        int exponent = max == 0 ? 0 : bits - 15;
+
+        if (exponent > 0) {
+            const int32_t round = 1 << (exponent - 1);
+            for (size_t ix = 0; ix < _samples; ix++) {
+                _q[ix] = (EIDSP_i16)numpy::saturate(((int64_t)axis[ix] + round) >> exponent, 16);
+            }
+        }
+        else {
+            for (size_t ix = 0; ix < _samples; ix++) {
+                _q[ix] = (EIDSP_i16)(axis[ix] * (1 << -exponent));
+            }
+        }
+
+        size_t copy = _samples > _n_fft ? _n_fft : _samples;
+        memcpy(_fft_in, _q, copy * sizeof(EIDSP_i16));
+        memset(_fft_in + copy, 0, (_n_fft - copy) * sizeof(EIDSP_i16));
+
+        return exponent;
+    }
+
+    /**
+     * Real FFT of `_fft_in`, scaled by 1/N. `_fft_out` gets (real, imaginary) for bins 0..N/2
+     */
+    void rfft() {
+#if EIDSP_USE_CMSIS_DSP
+        if (_use_cmsis) {
+            arm_rfft_q15(&_rfft_instance, _fft_in, _fft_out);
+            return;
+        }
+#endif
+
+        // radix-2 decimation in time, every stage halves like the CMSIS q15 FFT
+        size_t bits = 0;
+        while (((size_t)1 << bits) < _n_fft) {
+            bits++;
+        }
+        for (size_t ix = 0; ix < _n_fft; ix++) {
+            size_t rev = 0;
+            for (size_t b = 0; b < bits; b++) {
+                rev |= ((ix >> b) & 1) << (bits - 1 - b);
+            }
+            _fft_out[rev * 2] = _fft_in[ix];
+            _fft_out[rev * 2 + 1] = 0;
+        }
+
+        for (size_t len = 2; len <= _n_fft; len <<= 1) {
+            const size_t half = len / 2;
+            const size_t twiddle_step = _n_fft / len;
+
+            for (size_t start = 0; start < _n_fft; start += len) {
+                for (size_t j = 0; j < half; j++) {
+                    const int32_t wr = _twiddle[j * twiddle_step * 2];
+                    const int32_t wi = _twiddle[j * twiddle_step * 2 + 1];
+                    EIDSP_i16 *a = _fft_out + ((start + j) * 2);
+                    EIDSP_i16 *b = _fft_out + ((start + j + half) * 2);
+
+                    // b * e^(-i * phase)
+                    int32_t tr = (int32_t)(((int64_t)b[0] * wr + (int64_t)b[1] * wi + (1 << 14)) >> 15);
+                    int32_t ti = (int32_t)(((int64_t)b[1] * wr - (int64_t)b[0] * wi + (1 << 14)) >> 15);
+
+                    int32_t ar = a[0], ai = a[1];
+                    a[0] = (EIDSP_i16)numpy::saturate((ar + tr) >> 1, 16);
+                    a[1] = (EIDSP_i16)numpy::saturate((ai + ti) >> 1, 16);
+                    b[0] = (EIDSP_i16)numpy::saturate((ar - tr) >> 1, 16);
+                    b[1] = (EIDSP_i16)numpy::saturate((ai - ti) >> 1, 16);
+                }
+            }
+        }
+    }
+
+    /**
+     * Find the highest peaks in the spectrum of the last `rfft` call
+     * @param exponent Block exponent of the axis
+     * @param out Output buffer of (freq, amplitude) pairs in q15, one per peak
+     */
+    void fft_peaks(int exponent, EIDSP_i32 *out) {
+        if (_fft_peaks == 0) {
+            return;
+        }
+
+        const size_t in_size = _n_fft / 2 + 1;
+        const size_t max_peaks = _fft_peaks * 10;
+        size_t peak_count = 0;
+
+        for (size_t ix = 0; ix < in_size; ix++) {
+            int32_t re = _fft_out[ix * 2];
+            int32_t im = _fft_out[ix * 2 + 1];
+            uint64_t power = (uint64_t)((uint32_t)(re * re) + (uint32_t)(im * im));
+            _magnitude[ix] = numpy::multiply_by_quantized_multiplier(numpy::sqrt_u64(power << 16),
+                _magnitude_mantissa, _magnitude_shift - exponent);
+        }
+
+        int32_t prev = _magnitude[0];
+
+        for (size_t ix = 1; ix < in_size - 1; ix++) {
+            int32_t v = _magnitude[ix];
+            // first make sure it's actually a peak...
+            if (v > prev && v > _magnitude[ix + 1]) {
+                processing::freq_peak_i32_t *d = &_peaks[peak_count++];
+                d->freq = _peak_freq[ix];
+                d->amplitude = v;
+                if (d->amplitude < _threshold) {
+                    d->freq = 0;
+                    d->amplitude = 0;
+                }
+                if (peak_count == max_peaks) break;
+            }
+
+            prev = v;
+        }
+
+        std::sort(_peaks, _peaks + peak_count,
+            [](const processing::freq_peak_i32_t & a, const processing::freq_peak_i32_t & b) -> bool
+        {
+            return a.amplitude > b.amplitude;
+        });
+
+        for (size_t row = 0; row < _fft_peaks; row++) {
+            if (row < peak_count) {
+                out[row * 2 + 0] = _peaks[row].freq;
+                out[row * 2 + 1] = _peaks[row].amplitude;
+            }
+            else {
+                out[row * 2 + 0] = 0;
+                out[row * 2 + 1] = 0;
+            }
+        }
+    }
+
+    /**
+     * Periodogram of the spectrum of the last `rfft` call, bucketed into the
+     * spectral power edges. The constant detrend is done in the frequency domain,
+     * like the float plan.
+     * @param exponent Block exponent of the axis
+     * @param segment_mean Mean of the first `nperseg` q15 samples, 8 fraction bits
+     * @param out Output buffer, one q15 value per edge bucket
+     */
+    void power_edges(int exponent, int32_t segment_mean, EIDSP_i32 *out) {
+        const size_t bins = _n_fft / 2 + 1;
+
+        int64_t buckets[EI_DSP_SPECTRAL_MAX_EDGES] = { 0 };
+        uint16_t bucket_count[EI_DSP_SPECTRAL_MAX_EDGES] = { 0 };
+
+        for (size_t ix = 0; ix < bins; ix++) {
+            int ex = _bin_edge[ix];
+            if (ex < 0) {
+                continue;
+            }
+
+            // 8 fraction bits
+            int64_t re = ((int64_t)_fft_out[ix * 2] * 256) -
+                (((int64_t)segment_mean * _window_fft[ix * 2] + (1 << 14)) >> 15);
+            int64_t im = ((int64_t)_fft_out[ix * 2 + 1] * 256) -
+                (((int64_t)segment_mean * _window_fft[ix * 2 + 1] + (1 << 14)) >> 15);
+
+            int64_t power = (re * re) + (im * im);
+            if (ix != _n_fft / 2) {
+                power *= 2;
+            }
+
+            buckets[ex] += power;
+            bucket_count[ex]++;
+        }
+
+        for (size_t ex = 0; ex < _edge_count - 1; ex++) {
+            if (bucket_count[ex] == 0) {
+                out[ex] = 0;
+            }
+            else {
+                out[ex] = numpy::multiply_by_quantized_multiplier(buckets[ex] / bucket_count[ex],
+                    _power_mantissa, _power_shift - (2 * exponent));
+            }
+        }
+    }
+
+    int _status;
+
+    size_t _axes;
+    size_t _samples;
+    float _sampling_freq;
+    float _scale_axes;
+    filter_t _filter_type;
+    uint16_t _n_fft;
+    uint8_t _fft_peaks;
+    int32_t _threshold;
+    uint16_t _nperseg;
+
+    int _n_stages;
+    int32_t _coeffs[EI_DSP_BUTTERWORTH_MAX_STEPS * 5];
+
+    float _edges[EI_DSP_SPECTRAL_MAX_EDGES];
+    size_t _edge_count;
+
+    float _signal_scale;
+    int32_t _rms_mantissa;
+    int _rms_shift;
+    int32_t _magnitude_mantissa;
+    int _magnitude_shift;
+    int32_t _power_mantissa;
+    int _power_shift;
+
+    uint8_t *_arena;
+    size_t _arena_size;
+    int32_t *_data;
+    int32_t *_window_fft;
+    int32_t *_magnitude;
+    int32_t *_peak_freq;
+    processing::freq_peak_i32_t *_peaks;
+    EIDSP_i16 *_raw;
+    EIDSP_i16 *_q;
+    EIDSP_i16 *_fft_in;
+    EIDSP_i16 *_fft_out;
+    EIDSP_i16 *_twiddle;
+    int8_t *_bin_edge;
+
+#if EIDSP_USE_CMSIS_DSP
+    bool _use_cmsis;
+    arm_rfft_instance_q15 _rfft_instance;
+#endif
+};
+
+} // namespace spectral
+} // namespace ei
+
+#endif // _EIDSP_SPECTRAL_PLAN_Q15_H_
@@ -118,11 +118,15 @@ namespace processing {
         float filter_cutoff,
         uint8_t filter_order)
     {
+        filters::butterworth_filter filter;
+        int ret = filter.init_lowpass(filter_order, sampling_frequency, filter_cutoff);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
         for (size_t row = 0; row < matrix->rows; row++) {
-            filters::butterworth_lowpass(
-                filter_order,
-                sampling_frequency,
-                filter_cutoff,
+            filter.reset();
+            filter.apply(
                 matrix->buffer + (row * matrix->cols),
                 matrix->buffer + (row * matrix->cols),
                 matrix->cols);
@@ -147,11 +151,15 @@ namespace processing {
         float filter_cutoff,
         uint8_t filter_order)
     {
+        filters::butterworth_filter filter;
+        int ret = filter.init_highpass(filter_order, sampling_frequency, filter_cutoff);
+        if (ret != EIDSP_OK) {
+            EIDSP_ERR(ret);
+        }
+
         for (size_t row = 0; row < matrix->rows; row++) {
-            filters::butterworth_highpass(
-                filter_order,
-                sampling_frequency,
-                filter_cutoff,
+            filter.reset();
+            filter.apply(
                 matrix->buffer + (row * matrix->cols),
                 matrix->buffer + (row * matrix->cols),
                 matrix->cols);
@@ -824,6 +832,64 @@ namespace processing {
         return EIDSP_OK;
     }
 
+    /**
+     * Estimate power spectral density from an already calculated spectrum, so the
+     * FFT used for peak finding can be shared. The constant detrend is done in the
+     * frequency domain: FFT(x - mean) = FFT(x) - mean * FFT(window), where window
+     * is `nperseg` ones, zero padded to n_fft.
+     * @param fft Spectrum of the (not detrended) signal, n_fft/2+1 bins
+     * @param window_fft Spectrum of the segment window, n_fft/2+1 bins
+     * @param mean Mean over the first `nperseg` samples of the signal
+     * @param out_fft_matrix Output matrix of size 1x(n_fft/2+1) with power data
+     * @param out_freq_matrix Output matrix of size 1x(n_fft/2+1) with frequency data
+     * @param sampling_freq The sampling frequency
+     * @param n_fft Number of FFT buckets
+     * @param nperseg Number of samples in the segment (min(signal length, n_fft))
+     * @returns 0 if OK
+     */
+    int periodogram(
+        const fft_complex_t *fft,
+        const fft_complex_t *window_fft,
+        float mean,
+        matrix_t *out_fft_matrix,
+        matrix_t *out_freq_matrix,
+        float sampling_freq,
+        uint16_t n_fft,
+        uint16_t nperseg)
+    {
+        if (out_fft_matrix->rows != 1 || out_fft_matrix->cols != static_cast<uint32_t>(n_fft / 2 + 1)) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        if (out_freq_matrix->rows != 1 || out_freq_matrix->cols != static_cast<uint32_t>(n_fft / 2 + 1)) {
+            EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+        }
+
+        float scale = 1.0f / (sampling_freq * nperseg);
+
+        for (uint16_t ix = 0; ix < n_fft / 2 + 1; ix++) {
+            out_freq_matrix->buffer[ix] = static_cast<float>(ix) * (1.0f / (n_fft * (1.0f / sampling_freq)));
+        }
+
+        for (uint16_t ix = 0; ix < n_fft / 2 + 1; ix++) {
+            fft_complex_t x;
+            x.r = fft[ix].r - (mean * window_fft[ix].r);
+            x.i = fft[ix].i - (mean * window_fft[ix].i);
+
+            // conjugate and then multiply with itself and scale
+            x.r = (x.r * x.r) + (abs(x.i * x.i));
+            x.r *= scale;
+
+            if (ix != n_fft / 2) {
+                x.r *= 2;
+            }
+
+            out_fft_matrix->buffer[ix] = x.r;
+        }
+
+        return EIDSP_OK;
+    }
+
     int periodogram(matrix_i16_t *input_matrix, matrix_i16_t *out_fft_matrix, matrix_i16_t *out_freq_matrix, float sampling_freq, uint16_t n_fft)
     {
         if (input_matrix->rows != 1) {
@@ -26,5 +26,7 @@
 #include "../config.hpp"
 #include "processing.hpp"
 #include "feature.hpp"
+#include "plan.hpp"
+#include "plan_q15.hpp"
 
 #endif // _EIDSP_SPECTRAL_SPECTRAL_H_
@@ -38,7 +38,7 @@ static const char *base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                                   "abcdefghijklmnopqrstuvwxyz"
                                   "0123456789+/";
 
-static void base64_encode(const char *input, size_t input_size, void (*putc_f)(char))
+__attribute__((unused)) static void base64_encode(const char *input, size_t input_size, void (*putc_f)(char))
 {
     int i = 0;
     int j = 0;
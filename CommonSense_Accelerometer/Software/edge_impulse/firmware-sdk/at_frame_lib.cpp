@@ -0,0 +1,252 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <string.h>
+#include "firmware-sdk/at_frame_lib.h"
+#include "firmware-sdk/ei_device_interface.h"
+
+#define EI_FRAME_SIZE   (EI_FRAME_HEADER_SIZE + EI_FRAME_MAX_PAYLOAD + EI_FRAME_CRC_SIZE)
+
+static_assert(EI_FRAME_WINDOW > 0 && EI_FRAME_WINDOW <= 128 && (EI_FRAME_WINDOW & (EI_FRAME_WINDOW - 1)) == 0,
+    "EI_FRAME_WINDOW must be a power of two, at most 128");
+static_assert(EI_FRAME_MAX_PAYLOAD >= 5 && EI_FRAME_MAX_PAYLOAD <= 0xFFFF, "EI_FRAME_MAX_PAYLOAD out of range");
+
+/* Private variables ------------------------------------------------------- */
+/** Frames in flight, slot is seq % EI_FRAME_WINDOW */
+static uint8_t frame_buffer[EI_FRAME_WINDOW][EI_FRAME_SIZE];
+static uint16_t frame_size[EI_FRAME_WINDOW];
+
+static uint8_t base_seq;        /* oldest frame not acknowledged */
+static uint8_t next_seq;        /* frame that is being filled */
+static uint8_t in_flight;       /* frames sent, not acknowledged */
+static size_t fill;             /* payload bytes in the frame being filled */
+static uint32_t total_bytes;
+static uint64_t last_activity_ms;
+static int retries;
+static bool aborted;
+
+static uint8_t rx_msg[3];
+static int rx_pos;
+
+/* Private functions ------------------------------------------------------- */
+
+static void frame_write(uint8_t seq)
+{
+    int slot = seq & (EI_FRAME_WINDOW - 1);
+    ei_write_string((char *)frame_buffer[slot], frame_size[slot]);
+}
+
+static void resend_outstanding(void)
+{
+    for (uint8_t i = 0; i < in_flight; i++) {
+        frame_write((uint8_t)(base_seq + i));
+    }
+    last_activity_ms = ei_read_timer_ms();
+}
+
+/**
+ * @brief      Mark all frames up to and including seq as received
+ */
+static void frame_acknowledge(uint8_t seq)
+{
+    uint8_t offset = (uint8_t)(seq - base_seq);
+
+    if (offset < in_flight) {
+        base_seq = (uint8_t)(seq + 1);
+        in_flight -= offset + 1;
+        retries = 0;
+        last_activity_ms = ei_read_timer_ms();
+    }
+}
+
+static void frame_handle_message(uint8_t code, uint8_t seq)
+{
+    switch (code) {
+    case EI_FRAME_ACK:
+        frame_acknowledge(seq);
+        break;
+    case EI_FRAME_NAK:
+        if ((uint8_t)(seq - base_seq) < in_flight) {
+            /* everything before the bad frame did arrive */
+            if (seq != base_seq) {
+                frame_acknowledge((uint8_t)(seq - 1));
+            }
+            resend_outstanding();
+        }
+        break;
+    case EI_FRAME_CAN:
+        aborted = true;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief      Handle host messages and the retransmit timeout
+ */
+static void frame_poll(void)
+{
+    int c;
+
+    while ((c = ei_get_serial_byte()) >= 0) {
+        if (rx_pos == 0 && c != EI_FRAME_ACK && c != EI_FRAME_NAK && c != EI_FRAME_CAN) {
+            continue;
+        }
+        rx_msg[rx_pos++] = (uint8_t)c;
+        if (rx_pos == 3) {
+            rx_pos = 0;
+            if ((uint8_t)(rx_msg[1] ^ 0xFF) == rx_msg[2]) {
+                frame_handle_message(rx_msg[0], rx_msg[1]);
+            }
+        }
+    }
+
+    if (in_flight && (ei_read_timer_ms() - last_activity_ms) > EI_FRAME_TIMEOUT_MS) {
+        if (++retries > EI_FRAME_MAX_RETRIES) {
+            aborted = true;
+        }
+        else {
+            resend_outstanding();
+        }
+    }
+}
+
+static void frame_wait_for_slot(void)
+{
+    while (!aborted && in_flight >= EI_FRAME_WINDOW) {
+        frame_poll();
+    }
+}
+
+/**
+ * @brief      Add header and CRC to the frame in slot next_seq and send it
+ */
+static void frame_send(uint8_t type, size_t length)
+{
+    int slot = next_seq & (EI_FRAME_WINDOW - 1);
+
+    frame_size[slot] = (uint16_t)ei_frame_encode(frame_buffer[slot], type, next_seq, length);
+
+    frame_write(next_seq);
+    next_seq++;
+    in_flight++;
+    fill = 0;
+    last_activity_ms = ei_read_timer_ms();
+}
+
+/* Public functions -------------------------------------------------------- */
+
+uint16_t ei_frame_crc16(uint16_t crc, const uint8_t *data, size_t size)
+{
+    while (size--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t ei_frame_encode(uint8_t *frame, uint8_t type, uint8_t seq, size_t length)
+{
+    frame[0] = EI_FRAME_SOF;
+    frame[1] = type;
+    frame[2] = seq;
+    frame[3] = (uint8_t)(length & 0xFF);
+    frame[4] = (uint8_t)(length >> 8);
+
+    uint16_t crc = ei_frame_crc16(0xFFFF, &frame[1], EI_FRAME_HEADER_SIZE - 1 + length);
+    frame[EI_FRAME_HEADER_SIZE + length] = (uint8_t)(crc & 0xFF);
+    frame[EI_FRAME_HEADER_SIZE + length + 1] = (uint8_t)(crc >> 8);
+
+    return EI_FRAME_HEADER_SIZE + length + EI_FRAME_CRC_SIZE;
+}
+
+void ei_frame_begin(void)
+{
+    base_seq = 0;
+    next_seq = 0;
+    in_flight = 0;
+    fill = 0;
+    total_bytes = 0;
+    retries = 0;
+    aborted = false;
+    rx_pos = 0;
+
+    /* drop whatever followed the AT command */
+    while (ei_get_serial_byte() >= 0);
+
+    ei_printf("FRAME %d,%d,%d\r\n", EI_FRAME_VERSION, EI_FRAME_MAX_PAYLOAD, EI_FRAME_WINDOW);
+}
+
+void ei_frame_data(uint8_t *buffer, size_t size)
+{
+    while (size > 0 && !aborted) {
+        if (fill == 0) {
+            frame_wait_for_slot();
+            if (aborted) {
+                break;
+            }
+        }
+
+        size_t n = EI_FRAME_MAX_PAYLOAD - fill;
+        if (n > size) {
+            n = size;
+        }
+        memcpy(&frame_buffer[next_seq & (EI_FRAME_WINDOW - 1)][EI_FRAME_HEADER_SIZE + fill], buffer, n);
+        fill += n;
+        buffer += n;
+        size -= n;
+        total_bytes += n;
+
+        if (fill == EI_FRAME_MAX_PAYLOAD) {
+            frame_send(EI_FRAME_TYPE_DATA, fill);
+        }
+        frame_poll();
+    }
+}
+
+bool ei_frame_end(bool success)
+{
+    if (!aborted && fill > 0) {
+        frame_send(EI_FRAME_TYPE_DATA, fill);
+    }
+
+    frame_wait_for_slot();
+    if (!aborted) {
+        uint8_t *payload = &frame_buffer[next_seq & (EI_FRAME_WINDOW - 1)][EI_FRAME_HEADER_SIZE];
+        payload[0] = (uint8_t)(total_bytes & 0xFF);
+        payload[1] = (uint8_t)((total_bytes >> 8) & 0xFF);
+        payload[2] = (uint8_t)((total_bytes >> 16) & 0xFF);
+        payload[3] = (uint8_t)((total_bytes >> 24) & 0xFF);
+        payload[4] = success ? 0 : 1;
+        frame_send(EI_FRAME_TYPE_END, 5);
+    }
+
+    while (!aborted && in_flight > 0) {
+        frame_poll();
+    }
+
+    return success && !aborted;
+}
@@ -0,0 +1,127 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __AT_FRAME_LIB__H__
+#define __AT_FRAME_LIB__H__
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Binary framed transfer, used by AT+READFILEBIN= and AT+READBUFFERBIN=.
+ *
+ * After the command the device prints one text line
+ *
+ *     FRAME <version>,<max payload>,<window>\r\n
+ *
+ * and then switches to binary frames:
+ *
+ *     0xA5 | type | seq | len (u16 LE) | payload[len] | crc16 (u16 LE)
+ *
+ * type is EI_FRAME_TYPE_DATA or EI_FRAME_TYPE_END, seq counts frames modulo
+ * 256 starting at 0. The CRC is CRC-16/CCITT-FALSE over type, seq, len and
+ * payload. The END frame carries the total number of payload bytes (u32 LE)
+ * and a status byte (0 = ok).
+ *
+ * The host answers with 3 byte messages: code | seq | seq ^ 0xFF.
+ *  - EI_FRAME_ACK: every frame up to and including seq arrived (cumulative)
+ *  - EI_FRAME_NAK: frame seq was bad, resend from seq onwards
+ *  - EI_FRAME_CAN: abort the transfer
+ *
+ * Up to EI_FRAME_WINDOW frames are in flight. When nothing gets acknowledged
+ * for EI_FRAME_TIMEOUT_MS all outstanding frames are sent again, after
+ * EI_FRAME_MAX_RETRIES timeouts in a row the transfer is abandoned.
+ *
+ * EI_FRAME_TYPE_STREAM frames use the same layout but are not acknowledged,
+ * a lost frame shows up as a gap in seq.
+ */
+
+#define EI_FRAME_VERSION            1
+
+#ifndef EI_FRAME_MAX_PAYLOAD
+#define EI_FRAME_MAX_PAYLOAD        512
+#endif
+
+#ifndef EI_FRAME_WINDOW
+#define EI_FRAME_WINDOW             8
+#endif
+
+#ifndef EI_FRAME_TIMEOUT_MS
+#define EI_FRAME_TIMEOUT_MS         1000
+#endif
+
+#ifndef EI_FRAME_MAX_RETRIES
+#define EI_FRAME_MAX_RETRIES        10
+#endif
+
+#define EI_FRAME_SOF                0xA5
+#define EI_FRAME_TYPE_DATA          0x01
+#define EI_FRAME_TYPE_END           0x02
+#define EI_FRAME_TYPE_STREAM        0x03
+
+#define EI_FRAME_ACK                0x06
+#define EI_FRAME_NAK                0x15
+#define EI_FRAME_CAN                0x18
+
+#define EI_FRAME_HEADER_SIZE        5
+#define EI_FRAME_CRC_SIZE           2
+
+/**
+ * @brief      CRC-16/CCITT-FALSE (poly 0x1021), continue from crc
+ */
+uint16_t ei_frame_crc16(uint16_t crc, const uint8_t *data, size_t size);
+
+/**
+ * @brief      Fill in header and CRC of a frame
+ *
+ * @param      frame   Frame buffer, the payload is at frame + EI_FRAME_HEADER_SIZE
+ * @param[in]  type    Frame type
+ * @param[in]  seq     Sequence number
+ * @param[in]  length  Payload size
+ *
+ * @return     Size of the complete frame
+ */
+size_t ei_frame_encode(uint8_t *frame, uint8_t type, uint8_t seq, size_t length);
+
+/**
+ * @brief      Reset the transfer state and print the FRAME line
+ */
+void ei_frame_begin(void);
+
+/**
+ * @brief      Queue data for transfer, blocks while the window is full.
+ *             Matches the data_fn callback of read_file and read_buffer.
+ */
+void ei_frame_data(uint8_t *buffer, size_t size);
+
+/**
+ * @brief      Send the last frame and the END frame, wait until everything
+ *             is acknowledged
+ *
+ * @param[in]  success  false if the data source failed halfway
+ *
+ * @return     true if the host received all data
+ */
+bool ei_frame_end(bool success);
+
+#endif  //!__AT_FRAME_LIB__H__
@@ -0,0 +1,250 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "firmware-sdk/ei_benchmark.h"
+#include "model-parameters/model_metadata.h"
+
+#if EI_PROFILER_STAGES == 1
+
+/* The window total is kept like a stage, after the real ones */
+#define BENCHMARK_WINDOW        EI_PROFILER_STAGE_COUNT
+#define BENCHMARK_SLOTS         (EI_PROFILER_STAGE_COUNT + 1)
+
+typedef struct {
+    uint32_t samples_us[EI_BENCHMARK_MAX_SAMPLES];
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t allocs;
+    uint32_t alloc_bytes;
+    uint32_t hist[EI_BENCHMARK_HIST_BUCKETS];
+    /* Per-axis stages add up here until the window ends */
+    bool pending;
+    uint32_t pending_us;
+    uint32_t pending_allocs;
+    uint32_t pending_alloc_bytes;
+} benchmark_stage_t;
+
+static const char *stage_names[BENCHMARK_SLOTS] = {
+    "acquisition",
+    "copy",
+    "scale_transpose",
+    "mean",
+    "filter",
+    "fft",
+    "peaks",
+    "power_edges",
+    "quantize",
+    "invoke",
+    "anomaly",
+    "window",
+};
+
+static benchmark_stage_t stages[BENCHMARK_SLOTS];
+static uint32_t sort_scratch[EI_BENCHMARK_MAX_SAMPLES];
+static volatile bool recording = false;
+static uint32_t alloc_count = 0;
+static uint32_t alloc_bytes = 0;
+
+static void record(benchmark_stage_t *stage, uint32_t us, uint32_t allocs, uint32_t bytes)
+{
+    stage->samples_us[stage->count % EI_BENCHMARK_MAX_SAMPLES] = us;
+    stage->count++;
+    stage->total_us += us;
+    if (us > stage->max_us) {
+        stage->max_us = us;
+    }
+    stage->allocs += allocs;
+    stage->alloc_bytes += bytes;
+
+    uint32_t bucket = 0;
+    while (us && bucket < EI_BENCHMARK_HIST_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    stage->hist[bucket]++;
+}
+
+static uint32_t mark_elapsed_us(const ei_profiler_mark_t *mark)
+{
+    return (uint32_t)(ei_read_timer_us() - mark->start_us);
+}
+
+ei_profiler_mark_t ei_profiler_stage_begin(void)
+{
+    ei_profiler_mark_t mark = { 0, 0, 0 };
+
+    if (recording) {
+        mark.allocs = alloc_count;
+        mark.alloc_bytes = alloc_bytes;
+        mark.start_us = ei_read_timer_us();
+    }
+    return mark;
+}
+
+void ei_profiler_stage_end(ei_profiler_stage_t stage, const ei_profiler_mark_t *mark)
+{
+    if (!recording || mark->start_us == 0) {
+        return;
+    }
+    uint32_t us = mark_elapsed_us(mark);
+    record(&stages[stage], us, alloc_count - mark->allocs, alloc_bytes - mark->alloc_bytes);
+}
+
+void ei_profiler_stage_add(ei_profiler_stage_t stage, const ei_profiler_mark_t *mark)
+{
+    if (!recording || mark->start_us == 0) {
+        return;
+    }
+    benchmark_stage_t *s = &stages[stage];
+    s->pending_us += mark_elapsed_us(mark);
+    s->pending_allocs += alloc_count - mark->allocs;
+    s->pending_alloc_bytes += alloc_bytes - mark->alloc_bytes;
+    s->pending = true;
+}
+
+void ei_profiler_stage_flush(void)
+{
+    for (int ix = 0; ix < EI_PROFILER_STAGE_COUNT; ix++) {
+        benchmark_stage_t *s = &stages[ix];
+        if (s->pending) {
+            record(s, s->pending_us, s->pending_allocs, s->pending_alloc_bytes);
+            s->pending = false;
+            s->pending_us = 0;
+            s->pending_allocs = 0;
+            s->pending_alloc_bytes = 0;
+        }
+    }
+}
+
+void ei_benchmark_start(void)
+{
+    recording = false;
+    memset(stages, 0, sizeof(stages));
+    alloc_count = 0;
+    alloc_bytes = 0;
+    recording = true;
+}
+
+void ei_benchmark_stop(void)
+{
+    recording = false;
+}
+
+ei_profiler_mark_t ei_benchmark_window_begin(void)
+{
+    return ei_profiler_stage_begin();
+}
+
+void ei_benchmark_window_end(const ei_profiler_mark_t *mark)
+{
+    if (!recording || mark->start_us == 0) {
+        return;
+    }
+    uint32_t us = mark_elapsed_us(mark);
+    record(&stages[BENCHMARK_WINDOW], us, alloc_count - mark->allocs, alloc_bytes - mark->alloc_bytes);
+    ei_profiler_stage_flush();
+}
+
+/**
+ * @brief      Nearest-rank percentile of the sorted samples
+ */
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t pct)
+{
+    uint32_t rank = (n * pct + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void print_stage_json(const char *name, const benchmark_stage_t *stage)
+{
+    uint32_t n = stage->count < EI_BENCHMARK_MAX_SAMPLES ? stage->count : EI_BENCHMARK_MAX_SAMPLES;
+    uint32_t p50 = 0;
+    uint32_t p99 = 0;
+    uint32_t mean = 0;
+
+    if (n > 0) {
+        /* Insertion sort, at most EI_BENCHMARK_MAX_SAMPLES and only when printing */
+        for (uint32_t ix = 0; ix < n; ix++) {
+            uint32_t v = stage->samples_us[ix];
+            uint32_t jx = ix;
+            while (jx > 0 && sort_scratch[jx - 1] > v) {
+                sort_scratch[jx] = sort_scratch[jx - 1];
+                jx--;
+            }
+            sort_scratch[jx] = v;
+        }
+        p50 = percentile(sort_scratch, n, 50);
+        p99 = percentile(sort_scratch, n, 99);
+        /* Rounded to the nearest microsecond */
+        mean = (uint32_t)((stage->total_us + stage->count / 2) / stage->count);
+    }
+
+    /* Stages on a code path this build doesn't take (e.g. copy when the
+     * signal is in memory) never get a sample, say so instead of reporting 0 us */
+    ei_printf("{\"name\":\"%s\",\"measured\":%s,\"count\":%u,\"p50_us\":%u,\"p99_us\":%u,\"max_us\":%u,\"mean_us\":%u,"
+        "\"allocs\":%u,\"alloc_bytes\":%u,\"hist\":[",
+        name, stage->count > 0 ? "true" : "false", (unsigned int)stage->count, (unsigned int)p50, (unsigned int)p99,
+        (unsigned int)stage->max_us, (unsigned int)mean,
+        (unsigned int)stage->allocs, (unsigned int)stage->alloc_bytes);
+    for (int ix = 0; ix < EI_BENCHMARK_HIST_BUCKETS; ix++) {
+        ei_printf(ix == 0 ? "%u" : ",%u", (unsigned int)stage->hist[ix]);
+    }
+    ei_printf("]}");
+}
+
+void ei_benchmark_print_json(const char *platform)
+{
+    ei_printf("{\"version\":1,\"platform\":\"%s\",", platform);
+    ei_printf("\"project\":{\"id\":%d,\"name\":\"%s\",\"deploy_version\":%d},",
+        EI_CLASSIFIER_PROJECT_ID, EI_CLASSIFIER_PROJECT_NAME, EI_CLASSIFIER_PROJECT_DEPLOY_VERSION);
+    ei_printf("\"hist_buckets\":\"log2_us\",\r\n\"window\":");
+    print_stage_json(stage_names[BENCHMARK_WINDOW], &stages[BENCHMARK_WINDOW]);
+    ei_printf(",\r\n\"stages\":[\r\n");
+    for (int ix = 0; ix < EI_PROFILER_STAGE_COUNT; ix++) {
+        print_stage_json(stage_names[ix], &stages[ix]);
+        ei_printf(ix < EI_PROFILER_STAGE_COUNT - 1 ? ",\r\n" : "\r\n");
+    }
+    ei_printf("]}\r\n");
+}
+
+/* Count the allocations made while recording, replaces the weak porting functions */
+void *ei_malloc(size_t size)
+{
+    if (recording) {
+        alloc_count++;
+        alloc_bytes += size;
+    }
+    return malloc(size);
+}
+
+void *ei_calloc(size_t nitems, size_t size)
+{
+    if (recording) {
+        alloc_count++;
+        alloc_bytes += nitems * size;
+    }
+    return calloc(nitems, size);
+}
+
+#endif // EI_PROFILER_STAGES == 1
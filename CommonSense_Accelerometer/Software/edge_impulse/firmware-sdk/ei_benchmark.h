@@ -0,0 +1,60 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __EI_BENCHMARK__H__
+#define __EI_BENCHMARK__H__
+
+#include "edge-impulse-sdk/dsp/ei_profiler.h"
+
+/* Samples kept per stage for the percentiles, later samples overwrite the oldest */
+#define EI_BENCHMARK_MAX_SAMPLES        128
+/* Histogram buckets per stage, bucket n counts durations in [2^(n-1), 2^n) us */
+#define EI_BENCHMARK_HIST_BUCKETS       20
+
+/**
+ * @brief      Clear all stage samples and start recording
+ */
+void ei_benchmark_start(void);
+
+/**
+ * @brief      Stop recording, the samples are kept for ei_benchmark_print_json
+ */
+void ei_benchmark_stop(void);
+
+/**
+ * @brief      Mark the start of one window (DSP and inference)
+ */
+ei_profiler_mark_t ei_benchmark_window_begin(void);
+
+/**
+ * @brief      Record the window total and the per-axis stages of the window
+ */
+void ei_benchmark_window_end(const ei_profiler_mark_t *mark);
+
+/**
+ * @brief      Print the per-stage statistics of the last run as one JSON object
+ *
+ * @param[in]  platform  Name of the platform the benchmark ran on
+ */
+void ei_benchmark_print_json(const char *platform);
+
+#endif  //!__EI_BENCHMARK__H__
@@ -35,6 +35,7 @@ void ei_serial_setup(void);
 void ei_write_string(char *data, int length);
 void ei_putc(char cChar);
 char ei_getchar();
+int ei_get_serial_byte(void);
 
 
 #endif  //!__EI_DEVICE_INTERFACE__H__
@@ -0,0 +1,187 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include "firmware-sdk/ei_trace.h"
+
+#if EI_PROFILER_TRACE == 1
+
+#if (EI_TRACE_RING_SIZE & (EI_TRACE_RING_SIZE - 1)) != 0
+#error "EI_TRACE_RING_SIZE should be a power of two"
+#endif
+
+#if EI_PROFILER_TRACE_DWT == 1
+#define DEMCR               (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA        (1UL << 24)
+#define DWT_CTRL            (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA  (1UL << 0)
+#define DWT_LAR             (*(volatile uint32_t *)0xE0001FB0)
+#define DWT_LAR_UNLOCK      0xC5ACCE55
+#endif
+
+typedef struct {
+    const char *name;
+    uint32_t start;
+    uint32_t ticks;
+    /* index + 1 once the entry is complete, 0 while it is being written */
+    uint32_t seq;
+} trace_entry_t;
+
+typedef struct {
+    const char *name;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} trace_summary_t;
+
+static trace_entry_t trace_ring[EI_TRACE_RING_SIZE];
+static uint32_t trace_head = 0;
+
+void ei_trace_init(void)
+{
+#if EI_PROFILER_TRACE_DWT == 1
+    DEMCR |= DEMCR_TRCENA;
+    DWT_LAR = DWT_LAR_UNLOCK; // only locked on the Cortex-M7
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+void ei_profiler_trace_record(const char *name, uint32_t start, uint32_t end)
+{
+    /* Claim a slot, writers never wait on each other or on the reader */
+    uint32_t ix = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    trace_entry_t *entry = &trace_ring[ix & (EI_TRACE_RING_SIZE - 1)];
+
+    __atomic_store_n(&entry->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    entry->name = name;
+    entry->start = start;
+    entry->ticks = end - start;
+    __atomic_store_n(&entry->seq, ix + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief      Copy an entry, false if it was not complete or got overwritten
+ */
+static bool trace_read(uint32_t ix, trace_entry_t *out)
+{
+    const trace_entry_t *entry = &trace_ring[ix & (EI_TRACE_RING_SIZE - 1)];
+
+    if (__atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) != ix + 1) {
+        return false;
+    }
+    out->name = entry->name;
+    out->start = entry->start;
+    out->ticks = entry->ticks;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&entry->seq, __ATOMIC_RELAXED) == ix + 1;
+}
+
+static void print_ticks_us(uint64_t ticks)
+{
+    uint32_t us = (uint32_t)(ticks / EI_PROFILER_TRACE_TICKS_PER_US);
+    uint32_t frac = (uint32_t)((ticks % EI_PROFILER_TRACE_TICKS_PER_US) * 100 / EI_PROFILER_TRACE_TICKS_PER_US);
+    ei_printf("%lu.%02lu", (unsigned long)us, (unsigned long)frac);
+}
+
+void ei_trace_print(void)
+{
+    static trace_summary_t names[EI_TRACE_MAX_NAMES];
+    size_t name_count = 0;
+    uint32_t skipped = 0;
+
+    uint32_t head = __atomic_load_n(&trace_head, __ATOMIC_ACQUIRE);
+    uint32_t first = head > EI_TRACE_RING_SIZE ? head - EI_TRACE_RING_SIZE : 0;
+
+    for (uint32_t ix = first; ix != head; ix++) {
+        trace_entry_t entry;
+        if (!trace_read(ix, &entry)) {
+            skipped++;
+            continue;
+        }
+
+        /* Same scope name can be a different literal in every file */
+        size_t nx;
+        for (nx = 0; nx < name_count; nx++) {
+            if (names[nx].name == entry.name || strcmp(names[nx].name, entry.name) == 0) {
+                break;
+            }
+        }
+        if (nx == name_count) {
+            if (name_count == EI_TRACE_MAX_NAMES) {
+                skipped++;
+                continue;
+            }
+            names[nx].name = entry.name;
+            names[nx].count = 0;
+            names[nx].min = 0xFFFFFFFF;
+            names[nx].max = 0;
+            names[nx].total = 0;
+            name_count++;
+        }
+
+        trace_summary_t *s = &names[nx];
+        s->count++;
+        s->total += entry.ticks;
+        if (entry.ticks < s->min) {
+            s->min = entry.ticks;
+        }
+        if (entry.ticks > s->max) {
+            s->max = entry.ticks;
+        }
+    }
+
+#if EI_PROFILER_TRACE_DWT == 1
+    ei_printf("Trace clock: DWT cycle counter, %lu ticks per us\r\n", (unsigned long)EI_PROFILER_TRACE_TICKS_PER_US);
+#else
+    ei_printf("Trace clock: clock_gettime, %lu ticks per us\r\n", (unsigned long)EI_PROFILER_TRACE_TICKS_PER_US);
+#endif
+    ei_printf("Scopes recorded: %lu, in ring: %lu, skipped: %lu\r\n",
+        (unsigned long)head, (unsigned long)(head - first), (unsigned long)skipped);
+    ei_printf("name,count,min_ticks,mean_ticks,max_ticks,min_us,mean_us,max_us\r\n");
+    for (size_t nx = 0; nx < name_count; nx++) {
+        const trace_summary_t *s = &names[nx];
+        uint64_t mean = s->total / s->count;
+        ei_printf("%s,%lu,%lu,%lu,%lu,", s->name, (unsigned long)s->count,
+            (unsigned long)s->min, (unsigned long)mean, (unsigned long)s->max);
+        print_ticks_us(s->min);
+        ei_printf(",");
+        print_ticks_us(mean);
+        ei_printf(",");
+        print_ticks_us(s->max);
+        ei_printf("\r\n");
+    }
+}
+
+#else
+
+void ei_trace_init(void)
+{
+}
+
+void ei_trace_print(void)
+{
+    ei_printf("Tracing not enabled, build with EI_PROFILER_TRACE=1\r\n");
+}
+
+#endif // EI_PROFILER_TRACE == 1
@@ -0,0 +1,47 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __EI_TRACE__H__
+#define __EI_TRACE__H__
+
+#include "edge-impulse-sdk/dsp/ei_profiler.h"
+
+/* Scopes kept in the trace ring, power of two. Older scopes are overwritten */
+#ifndef EI_TRACE_RING_SIZE
+#define EI_TRACE_RING_SIZE          256
+#endif
+
+/* Distinct scope names summarised by ei_trace_print */
+#define EI_TRACE_MAX_NAMES          16
+
+/**
+ * @brief      Start the cycle counter, call once at startup
+ */
+void ei_trace_init(void);
+
+/**
+ * @brief      Print count, min, mean and max per scope name over the scopes
+ *             in the trace ring
+ */
+void ei_trace_print(void);
+
+#endif  //!__EI_TRACE__H__
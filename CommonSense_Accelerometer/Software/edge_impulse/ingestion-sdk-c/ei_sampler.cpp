@@ -23,6 +23,7 @@
 /* Include ----------------------------------------------------------------- */
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ei_sampler.h"
 #include "ei_config_types.h"
@@ -39,36 +40,96 @@ using namespace events;
 #endif
 
 
-/** @todo Should be called by function pointer */
 extern bool ei_inertial_sample_start(sampler_callback callback, float sample_interval_ms);
 extern int ei_inertial_read_data(void);
+extern void ei_inertial_sample_stop(void);
 
 extern void ei_printf(const char *format, ...);
 extern void ei_printf_float(float value);
 extern ei_config_t *ei_config_get_config();
 extern EI_CONFIG_ERROR ei_config_set_sample_interval(float interval);
 
+/* Constant defines -------------------------------------------------------- */
+/** Sample data is collected and written to storage in blocks of this size (SD sector / flash page multiple) */
+#ifndef EI_SAMPLER_WRITE_BLOCK_SIZE
+#define EI_SAMPLER_WRITE_BLOCK_SIZE     512
+#endif
+
 /* Private variables ------------------------------------------------------- */
 static uint32_t samples_required;
 static uint32_t current_sample;
 static uint32_t sample_buffer_size;
 static uint32_t headerOffset = 0;
 
+/** The inertial sensor, unless ei_sampler_set_sensor picked another one */
+static const ei_sampler_sensor_t inertial_sensor = {
+    &ei_inertial_sample_start,
+    &ei_inertial_read_data,
+    &ei_inertial_sample_stop,
+};
+static const ei_sampler_sensor_t *sampler_sensor = &inertial_sensor;
 
-static char write_word_buf[4];
-static int write_addr = 0;
+/**
+ * Write-behind buffer. Bytes are placed at their storage address modulo the
+ * block size, so every write after the first one (which follows the header)
+ * starts on a block boundary and covers a full block.
+ */
+static uint8_t write_block_buf[EI_SAMPLER_WRITE_BLOCK_SIZE];
+static uint32_t write_addr = 0;         /**!< Bytes written after the header   */
+static uint32_t write_flushed = 0;      /**!< Bytes of write_addr on storage   */
+static uint32_t write_data_len = 0;     /**!< Sample data bytes, without padding */
+static bool write_failed = false;
 
-static size_t ei_write(const void *buffer, size_t size, size_t count, EI_SENSOR_AQ_STREAM*)
+/**
+ * @brief      Write the buffered bytes to storage
+ *
+ * @return     0 if successful
+ */
+static int ei_write_flush(void)
+{
+    uint32_t address = write_flushed + headerOffset;
+    uint32_t length = write_addr - write_flushed;
+
+    if (length == 0) {
+        return 0;
+    }
+
+    int ret = ei_sony_spresense_fs_write_samples(&write_block_buf[address % EI_SAMPLER_WRITE_BLOCK_SIZE], address, length);
+    if (ret != 0) {
+        write_failed = true;
+    }
+    write_flushed = write_addr;
+
+    return ret;
+}
+
+/**
+ * @brief      Copy bytes into the block buffer, write each block once it is full
+ */
+static void ei_write_buffered(const uint8_t *data, uint32_t length)
 {
-    for(size_t i=0; i<count; i++) {
+    while (length) {
+        uint32_t index = (write_addr + headerOffset) % EI_SAMPLER_WRITE_BLOCK_SIZE;
+        uint32_t n_bytes = EI_SAMPLER_WRITE_BLOCK_SIZE - index;
 
-        write_word_buf[write_addr&0x3] = *((char *)buffer+i);
+        if (n_bytes > length) {
+            n_bytes = length;
+        }
 
-       if((++write_addr & 0x03) == 0x00) {
-           ei_sony_spresense_fs_write_samples(write_word_buf, (write_addr - 4) + headerOffset, 4);
-       }
+        memcpy(&write_block_buf[index], data, n_bytes);
+        write_addr += n_bytes;
+        data += n_bytes;
+        length -= n_bytes;
 
+        if (((write_addr + headerOffset) % EI_SAMPLER_WRITE_BLOCK_SIZE) == 0) {
+            ei_write_flush();
+        }
     }
+}
+
+static size_t ei_write(const void *buffer, size_t size, size_t count, EI_SENSOR_AQ_STREAM*)
+{
+    ei_write_buffered((const uint8_t *)buffer, count);
 
     return count;
 }
@@ -97,25 +158,25 @@ static sensor_aq_ctx ei_mic_ctx = {
     &ei_time,
 };
 
-static void ei_write_last_data(void)
+/**
+ * @brief      Pad the data to a word with 0xFF, append the 0xFF end word and
+ *             flush what is left in the block buffer. The first 0xFF is the
+ *             CBOR break that closes the values array, the rest is storage
+ *             alignment and not part of the sample.
+ *
+ * @return     0 if all sample data was written
+ */
+static int ei_write_last_data(void)
 {
-    uint8_t fill = ((uint8_t)write_addr & 0x03);
-    uint8_t insert_end_address = 0;
+    const uint8_t fill[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    uint32_t n_fill = ((4 - (write_addr & 0x03)) & 0x03) + 4;
 
-    if(fill != 0x00) {
-        for(uint8_t i=fill; i<4; i++) {
-            write_word_buf[i] = 0xFF;
-        }
+    write_data_len = write_addr;
 
-        ei_sony_spresense_fs_write_samples(write_word_buf, (write_addr & ~0x03) + headerOffset, 4);
-        insert_end_address = 4;
-    }
+    ei_write_buffered(fill, n_fill);
+    ei_write_flush();
 
-    /* Write appending word for end character */
-    for(uint8_t i=0; i<4; i++) {
-        write_word_buf[i] = 0xFF;
-    }
-    ei_sony_spresense_fs_write_samples(write_word_buf, (write_addr & ~0x03) + headerOffset + insert_end_address, 4);
+    return write_failed ? -1 : 0;
 }
 
 EI_SENSOR_AQ_STREAM stream;
@@ -174,7 +235,7 @@ bool ei_sampler_start_sampling(void *v_ptr_payload, uint32_t sample_size)
     if(create_header(payload) == false)
         return false;
 
-    if(ei_inertial_sample_start(&sample_data_callback, ei_config_get_config()->sample_interval_ms) == false) {
+    if(sampler_sensor->sample_start(&sample_data_callback, ei_config_get_config()->sample_interval_ms) == false) {
         return false;
     }
 
@@ -182,15 +243,20 @@ bool ei_sampler_start_sampling(void *v_ptr_payload, uint32_t sample_size)
 
 	ei_printf("Sampling...\n");
     while(current_sample < samples_required) {
-        if(ei_inertial_read_data() != 0) {
+        if(sampler_sensor->read_data() != 0) {
             ei_printf("ERR: Failed to get data, is your accelerometer connected?\r\n");
             sampling_failed = true;
             break;
         }
     };
 
-    ei_write_last_data();
-    write_addr++;
+    sampler_sensor->sample_stop();
+
+    /* Samples still batched in the CBOR buffer go out before the end marker */
+    if (sensor_aq_flush(&ei_mic_ctx) != AQ_OK || ei_write_last_data() != 0) {
+        ei_printf("ERR: Failed to write sample data\r\n");
+        sampling_failed = true;
+    }
 
     ei_sony_spresense_fs_close_sample_file();
 
@@ -265,6 +331,16 @@ bool ei_sampler_start_sampling(void *v_ptr_payload, uint32_t sample_size)
 }
 
 
+/**
+ * @brief      Select the sensor ei_sampler_start_sampling reads from
+ *
+ * @param[in]  sensor  The sensor, NULL for the inertial sensor
+ */
+void ei_sampler_set_sensor(const ei_sampler_sensor_t *sensor)
+{
+    sampler_sensor = sensor ? sensor : &inertial_sensor;
+}
+
 static bool create_header(sensor_aq_payload_info *payload)
 {
     sensor_aq_init_mbedtls_hs256_context(&ei_mic_signing_ctx, &ei_mic_hs_ctx, ei_config_get_config()->sample_hmac_key);
@@ -303,6 +379,9 @@ static bool create_header(sensor_aq_payload_info *payload)
 
     headerOffset = end_of_header_ix;
     write_addr = 0;
+    write_flushed = 0;
+    write_data_len = 0;
+    write_failed = false;
 
     return true;
 }
@@ -318,7 +397,8 @@ static void finish_and_upload(char *filename, uint32_t sample_length_ms)
     ei_printf("Done sampling, total bytes collected: %u\n", samples_required);
     ei_printf("[1/1] Uploading file to Edge Impulse...\n");
 
-    ei_printf("Not uploading file, not connected to WiFi. Used buffer, from=%lu, to=%lu.\n", 0, write_addr + headerOffset);
+    /* The sample ends with the CBOR break, the padding behind it is not read back */
+    ei_printf("Not uploading file, not connected to WiFi. Used buffer, from=%lu, to=%lu.\n", 0, headerOffset + write_data_len + 1);
 
     ei_printf("[1/1] Uploading file to Edge Impulse OK (took %d ms.)\n", 200);
 
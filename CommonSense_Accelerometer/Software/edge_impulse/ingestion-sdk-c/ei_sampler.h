@@ -27,7 +27,15 @@
 /** ei sampler callback function, call with sample data */
 typedef bool (*sampler_callback)(const void *sample_buf, uint32_t byteLenght);
 
+/** Sensor the sampler reads from */
+typedef struct {
+    bool (*sample_start)(sampler_callback callback, float sample_interval_ms);
+    int (*read_data)(void);     /**!< Pass new samples to the callback, 0 if ok */
+    void (*sample_stop)(void);
+} ei_sampler_sensor_t;
+
 /* Function prototypes ----------------------------------------------------- */
 bool ei_sampler_start_sampling(void *v_ptr_payload, uint32_t sample_size);
+void ei_sampler_set_sensor(const ei_sampler_sensor_t *sensor);
 
 #endif
@@ -23,10 +23,12 @@
 
 
 #include <stdint.h>
+#include <string.h>
 #include <float.h>
 #include "qcbor.h"
 //#include "setup.h"
 #include "sensor_aq.h"
+#include "edge-impulse-sdk/dsp/ei_profiler.h"
 // detect POSIX, and use FILE* in that case
 #if !defined(EI_SENSOR_AQ_STREAM) && (defined (__unix__) || (defined (__APPLE__) && defined (__MACH__)))
 #include <stdio.h>
@@ -201,6 +203,7 @@ int sensor_aq_init(sensor_aq_ctx *ctx, sensor_aq_payload_info *payload_info, EI_
     //int ctx_err;
 
     ctx->axis_count = 0;
+    ctx->batch_len = 0;
 
     QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
     QCBOREncode_OpenMap(&ctx->encode_context);
@@ -324,13 +327,93 @@ int sensor_aq_init(sensor_aq_ctx *ctx, sensor_aq_payload_info *payload_info, EI_
     return AQ_OK;
 }
 
+/**
+ * Encode a float exactly like QCBOREncode_AddDouble does (shortest lossless
+ * form, half or single precision) without the detour through double
+ * @returns Number of bytes written to out (at most 9)
+ */
+static size_t sensor_aq_encode_float(uint8_t *out, float value) {
+    uint32_t u;
+    memcpy(&u, &value, sizeof(u));
+
+    const uint32_t exponent = (u >> 23) & 0xff;
+    const uint32_t significand = u & 0x7fffff;
+    const int32_t unbiased_exponent = (int32_t)exponent - 127;
+
+    if ((u << 1) == 0) {
+        // +/- 0.0
+        out[0] = 0xf9;
+        out[1] = (u >> 24) & 0x80;
+        out[2] = 0;
+        return 3;
+    }
+
+    if (exponent == 0 || exponent == 0xff) {
+        // Subnormal, infinity and NaN are rare, leave those to QCBOR
+        QCBOREncodeContext encode_context;
+        UsefulBuf buf = { out, 9 };
+        UsefulBufC encoded;
+        QCBOREncode_Init(&encode_context, buf);
+        QCBOREncode_AddDouble(&encode_context, value);
+        if (QCBOREncode_Finish(&encode_context, &encoded) != QCBOR_SUCCESS) {
+            return 0;
+        }
+        return encoded.len;
+    }
+
+    if (unbiased_exponent >= -14 && unbiased_exponent <= 15 && (significand & 0x1fff) == 0) {
+        // Fits in half precision without losing bits
+        uint16_t half = ((u >> 16) & 0x8000) | ((uint16_t)(unbiased_exponent + 15) << 10) | (significand >> 13);
+        out[0] = 0xf9;
+        out[1] = half >> 8;
+        out[2] = half & 0xff;
+        return 3;
+    }
+
+    out[0] = 0xfa;
+    out[1] = (u >> 24) & 0xff;
+    out[2] = (u >> 16) & 0xff;
+    out[3] = (u >> 8) & 0xff;
+    out[4] = u & 0xff;
+    return 5;
+}
+
+/**
+ * Sign and write the samples collected by sensor_aq_add_data
+ * Call this before writing anything else to the stream
+ * @param ctx The context
+ */
+int sensor_aq_flush(sensor_aq_ctx *ctx) {
+    if (ctx->batch_len == 0) {
+        return AQ_OK;
+    }
+
+    size_t len = ctx->batch_len;
+    ctx->batch_len = 0;
+
+    int ctx_err = ctx->signature_ctx->update(ctx->signature_ctx, (uint8_t*)ctx->cbor_buffer.ptr, len);
+    if (ctx_err != 0) {
+        return ctx_err;
+    }
+
+    if (ei_fwrite(ctx, ctx->cbor_buffer.ptr, 1, len) != len) {
+        return AQ_STREAM_WRITE_FAILED;
+    }
+
+    return AQ_OK;
+}
+
 /**
  * Add data to the sensor file for a single interval
+ * Samples are encoded straight into the CBOR buffer and written (and signed)
+ * once it is full, or when sensor_aq_flush / sensor_aq_finish is called
  * @param ctx The context
  * @param values Values for the current frame
  * @param values_size Size of the values
  */
 int sensor_aq_add_data(sensor_aq_ctx *ctx, float values[], size_t values_size) {
+    EI_PROFILER_TRACE_SCOPE("sensor_aq_add_data");
+
     if (values_size != ctx->axis_count) {
         return AQ_VALUES_SIZE_DOES_NOT_MATCH_AXIS_COUNT;
     }
@@ -339,28 +422,44 @@ int sensor_aq_add_data(sensor_aq_ctx *ctx, float values[], size_t values_size) {
         return AQ_STREAM_IS_NULL;
     }
 
-    // clear memory
-    memset(ctx->cbor_buffer.ptr, 0, ctx->cbor_buffer.len);
+    // array header + up to 9 bytes per value
+    const size_t max_len = 2 + (values_size * 9);
+    if (max_len > ctx->cbor_buffer.len) {
+        return AQ_OUT_OF_MEM;
+    }
 
-    // re-initialize
-    QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
+    if (ctx->batch_len + max_len > ctx->cbor_buffer.len) {
+        int fr = sensor_aq_flush(ctx);
+        if (fr != AQ_OK) {
+            return fr;
+        }
+    }
+
+    uint8_t *out = (uint8_t*)ctx->cbor_buffer.ptr + ctx->batch_len;
+    size_t len = 0;
 
     // If we only have a single axis then emit flattened array (saves space)
-    if (values_size == 1) {
-        QCBOREncode_AddDouble(&ctx->encode_context, values[0]);
+    if (values_size > 1) {
+        if (values_size < 24) {
+            out[len++] = 0x80 | values_size;
+        }
+        else {
+            out[len++] = 0x98;
+            out[len++] = values_size;
+        }
     }
-    else {
-        // otherwise create an array
-        QCBOREncode_OpenArray(&ctx->encode_context);
 
-        for (size_t ix = 0; ix < values_size; ix++) {
-            QCBOREncode_AddDouble(&ctx->encode_context, values[ix]);
+    for (size_t ix = 0; ix < values_size; ix++) {
+        size_t value_len = sensor_aq_encode_float(&out[len], values[ix]);
+        if (value_len == 0) {
+            return AQ_OUT_OF_MEM;
         }
-
-        QCBOREncode_CloseArray(&ctx->encode_context);
+        len += value_len;
     }
 
-    return sensor_aq_flush_buffer(ctx);
+    ctx->batch_len += len;
+
+    return AQ_OK;
 }
 
 /**
@@ -378,6 +477,12 @@ int sensor_aq_add_data_i16(sensor_aq_ctx *ctx, int16_t values[], size_t values_s
         return AQ_STREAM_IS_NULL;
     }
 
+    // samples added with sensor_aq_add_data go first
+    int err = sensor_aq_flush(ctx);
+    if (err != AQ_OK) {
+        return err;
+    }
+
     // clear memory
     memset(ctx->cbor_buffer.ptr, 0, ctx->cbor_buffer.len);
 
@@ -441,6 +546,12 @@ int sensor_aq_add_data_batch(sensor_aq_ctx *ctx, int16_t values[], size_t values
         return AQ_STREAM_IS_NULL;
     }
 
+    // samples added with sensor_aq_add_data go first
+    int err = sensor_aq_flush(ctx);
+    if (err != AQ_OK) {
+        return err;
+    }
+
     // clear memory
     memset(ctx->cbor_buffer.ptr, 0, ctx->cbor_buffer.len);
 
@@ -469,6 +580,12 @@ int sensor_aq_finish(sensor_aq_ctx *ctx) {
         return AQ_STREAM_IS_NULL;
     }
 
+    // samples added with sensor_aq_add_data go first
+    int err = sensor_aq_flush(ctx);
+    if (err != AQ_OK) {
+        return err;
+    }
+
     // Update the signature
     int ctx_err = ctx->signature_ctx->update(ctx->signature_ctx, final_byte, 1);
     if (ctx_err != 0) {
@@ -27,6 +27,7 @@
 /* Include ----------------------------------------------------------------- */
 #include "qcbor.h"
 #include <stdio.h>
+#include <time.h>
 #ifdef __MBED__
 #include "mbed.h"
 
@@ -151,6 +152,9 @@ typedef struct {
     // index of the signature in the file
     size_t signature_index;
 
+    // encoded samples waiting in cbor_buffer (see sensor_aq_flush)
+    size_t batch_len;
+
     // active stream
     EI_SENSOR_AQ_STREAM *stream;
 } sensor_aq_ctx;
@@ -187,6 +191,7 @@ int sensor_aq_init(sensor_aq_ctx *ctx, sensor_aq_payload_info *payload_info, EI_
 int sensor_aq_add_data(sensor_aq_ctx *ctx, float values[], size_t values_size);
 int sensor_aq_add_data_i16(sensor_aq_ctx *ctx, int16_t values[], size_t values_size);
 int sensor_aq_add_data_batch(sensor_aq_ctx *ctx, int16_t values[], size_t values_size);
+int sensor_aq_flush(sensor_aq_ctx *ctx);
 int sensor_aq_finish(sensor_aq_ctx *ctx);
 
 #endif // _EDGE_IMPULSE_SENSOR_AQ_H_
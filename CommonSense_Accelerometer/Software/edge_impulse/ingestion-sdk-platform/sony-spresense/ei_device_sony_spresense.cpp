@@ -86,7 +86,11 @@ static bool read_sample_buffer(size_t begin, size_t length, void (*data_fn)(uint
 static int get_data_output_baudrate_c(ei_device_data_output_baudrate_t *baudrate);
 
 extern char spresense_getchar(void);
+extern int spresense_getbyte(void);
 extern void spresense_putchar(char byte);
+extern uint32_t spresense_writeBuffered(const char *data, uint32_t length);
+extern void spresense_setTxDropWhenFull(bool drop);
+extern uint32_t spresense_getTxDropped(void);
 extern "C" void spresense_ledcontrol(uint32_t led, bool on_off);
 
 /* Public functions -------------------------------------------------------- */
@@ -416,12 +420,19 @@ void ei_printf(const char *format, ...)
     int length;
     va_list myargs;
     va_start(myargs, format);
-    length = vsprintf(buffer, format, myargs);
+    length = vsnprintf(buffer, sizeof(buffer), format, myargs);
     va_end(myargs);
 
-    for(int i = 0; i < length; i++) {
-        ei_putc(buffer[i]);
+    if (length < 0) {
+        return;
     }
+
+    /* Output is cut off at the buffer size */
+    if (length >= (int)sizeof(buffer)) {
+        length = sizeof(buffer) - 1;
+    }
+
+    ei_write_string(buffer, length);
 }
 
 /**
@@ -443,8 +454,8 @@ void ei_printf_float(float f)
  */
 void ei_write_string(char *data, int length)
 {
-    for (int i = 0; i < length; i++) {
-        ei_putc(*(data++));
+    if (length > 0) {
+        spresense_writeBuffered(data, (uint32_t)length);
     }
 }
 
@@ -455,11 +466,29 @@ void ei_write_string(char *data, int length)
  */
 void ei_putc(char cChar)
 {
-    spresense_putchar(cChar);
+    spresense_writeBuffered(&cChar, 1);
+}
+
+/**
+ * @brief      Select what happens when the serial transmit buffer is full
+ *
+ * @param[in]  drop  true: drop the write, false: wait until there is room
+ */
+void ei_serial_set_tx_drop(bool drop)
+{
+    spresense_setTxDropWhenFull(drop);
+}
+
+/**
+ * @brief      Number of bytes dropped because the transmit buffer was full
+ */
+uint32_t ei_serial_get_tx_dropped(void)
+{
+    return spresense_getTxDropped();
 }
 
 /* Private functions ------------------------------------------------------- */
-static void timer_callback(void *arg)
+__attribute__((unused)) static void timer_callback(void *arg)
 {
     static char toggle = 0;
 
@@ -493,6 +522,31 @@ char ei_getchar()
 
 }
 
+/**
+ * @brief      Get a raw byte from the serial input, 0 is a valid value
+ *
+ * @return     The byte, -1 if nothing was received
+ */
+int ei_get_serial_byte(void)
+{
+    return spresense_getbyte();
+}
+
+/**
+ * @brief      Storage of the on-device anomaly baseline (anomaly_baseline.h)
+ *
+ * @return     0 on success
+ */
+int ei_anomaly_baseline_load(void *state, size_t size)
+{
+    return ei_sony_spresense_fs_load_baseline((uint8_t *)state, (uint32_t)size);
+}
+
+int ei_anomaly_baseline_save(const void *state, size_t size)
+{
+    return ei_sony_spresense_fs_save_baseline((const uint8_t *)state, (uint32_t)size);
+}
+
 
 static int get_id_c(uint8_t out_buffer[32], size_t *out_size)
 {
@@ -607,4 +661,4 @@ static bool read_sample_buffer(size_t begin, size_t length, void (*data_fn)(uint
     EiDevice.set_state(eiStateFinished);
 
     return retVal;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -111,4 +111,7 @@ extern EiDeviceSonySpresense EiDevice;
 void set_max_data_output_baudrate_c();
 void set_default_data_output_baudrate_c();
 
+void ei_serial_set_tx_drop(bool drop);
+uint32_t ei_serial_get_tx_dropped(void);
+
 #endif
@@ -15,6 +15,7 @@
 
 #define FILE_NAME_CONFIG    "config.bin"
 #define FILE_NAME_SAMPLE    "sample.bin"
+#define FILE_NAME_BASELINE  "baseline.bin"
 #define FILE_MAX_SIZE       0x200000
 #define FILE_BLOCK_SIZE     1024
 #define FILE_N_BLOCKS       (FILE_MAX_SIZE / FILE_BLOCK_SIZE)
@@ -33,6 +34,7 @@ static uint32_t flash_read_data(uint32_t byteAddress, uint8_t *buffer, uint32_t
 #endif
 
 extern "C" bool spresense_openFile(const char *name, bool write);
+extern "C" bool spresense_seekFile(const char *name, uint32_t position);
 extern "C" bool spresense_closeFile(const char *name);
 extern "C" bool spresense_writeToFile(const char *name, const uint8_t *buf, uint32_t length);
 extern "C" uint32_t spresense_readFromFile(const char *name, uint8_t *buf, uint32_t length);
@@ -156,6 +158,78 @@ int ei_sony_spresense_fs_save_config(const uint32_t *config, uint32_t config_siz
 #endif
 }
 
+/**
+ * @brief      Read the anomaly baseline state
+ *
+ * @param      state       Destination pointer for the state
+ * @param[in]  state_size  Size of the state in bytes
+ *
+ * @return     ei_sony_spresense_ret_t enum
+ */
+int ei_sony_spresense_fs_load_baseline(uint8_t *state, uint32_t state_size)
+{
+    if (state == NULL) {
+        return SONY_SPRESENSE_FS_CMD_NULL_POINTER;
+    }
+
+#if (SAMPLE_MEMORY == MICRO_SD)
+
+    int retVal = SONY_SPRESENSE_FS_CMD_OK;
+
+    if(sd_card_inserted == false || spresense_openFile((const char *)FILE_NAME_BASELINE, false) == false) {
+        return SONY_SPRESENSE_FS_CMD_FILE_ERROR;
+    }
+
+    if(spresense_readFromFile(FILE_NAME_BASELINE, state, state_size) != 0) {
+        retVal = SONY_SPRESENSE_FS_CMD_READ_ERROR;
+    }
+
+    spresense_closeFile((const char *)FILE_NAME_BASELINE);
+
+    return retVal;
+#else
+    /* Only kept on the SD card */
+    return SONY_SPRESENSE_FS_CMD_NOT_INIT;
+#endif
+}
+
+/**
+ * @brief      Write the anomaly baseline state
+ *
+ * @param[in]  state       Pointer to the state
+ * @param[in]  state_size  Size of the state in bytes
+ *
+ * @return     ei_sony_spresense_ret_t enum
+ */
+int ei_sony_spresense_fs_save_baseline(const uint8_t *state, uint32_t state_size)
+{
+    if (state == NULL) {
+        return SONY_SPRESENSE_FS_CMD_NULL_POINTER;
+    }
+
+#if (SAMPLE_MEMORY == MICRO_SD)
+
+    int retVal = SONY_SPRESENSE_FS_CMD_OK;
+
+    if(sd_card_inserted == false) {
+        retVal = SONY_SPRESENSE_FS_CMD_NOT_INIT;
+    }
+    else if(spresense_openFile((const char *)FILE_NAME_BASELINE, true) == false) {
+        retVal = SONY_SPRESENSE_FS_CMD_FILE_ERROR;
+    }
+    else if(spresense_writeToFile((const char *)FILE_NAME_BASELINE, state, state_size) == false) {
+        retVal = SONY_SPRESENSE_FS_CMD_WRITE_ERROR;
+    }
+    else if(spresense_closeFile((const char *)FILE_NAME_BASELINE) == false) {
+        retVal = SONY_SPRESENSE_FS_CMD_FILE_ERROR;
+    }
+
+    return retVal;
+#else
+    return SONY_SPRESENSE_FS_CMD_NOT_INIT;
+#endif
+}
+
 /**
  * @brief      Erase blocks in sample data space
  *
@@ -212,7 +286,10 @@ int ei_sony_spresense_fs_write_samples(const void *sample_buffer, uint32_t addre
 
 #elif (SAMPLE_MEMORY == MICRO_SD)
 
-    if(spresense_writeToFile((const char *)FILE_NAME_CONFIG, (const uint8_t *)sample_buffer, n_samples) == true) {
+    /* The SD file is not erased: data is rewritten in place at its address,
+     * anything past the reported sample end is stale */
+    if(spresense_seekFile((const char *)FILE_NAME_SAMPLE, address_offset) == true
+        && spresense_writeToFile((const char *)FILE_NAME_SAMPLE, (const uint8_t *)sample_buffer, n_samples) == true) {
         return SONY_SPRESENSE_FS_CMD_OK;
     }
     else {
@@ -53,6 +53,8 @@ typedef enum
 /* Prototypes -------------------------------------------------------------- */
 int ei_sony_spresense_fs_load_config(uint32_t *config, uint32_t config_size);
 int ei_sony_spresense_fs_save_config(const uint32_t *config, uint32_t config_size);
+int ei_sony_spresense_fs_load_baseline(uint8_t *state, uint32_t state_size);
+int ei_sony_spresense_fs_save_baseline(const uint8_t *state, uint32_t state_size);
 
 int ei_sony_spresense_fs_erase_sampledata(uint32_t start_block, uint32_t end_address);
 int ei_sony_spresense_fs_write_samples(const void *sample_buffer, uint32_t address_offset, uint32_t n_samples);
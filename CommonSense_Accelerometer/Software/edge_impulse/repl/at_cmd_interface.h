@@ -25,9 +25,9 @@
 
 #include "string.h"
 
-// maximum number of commands
+// maximum number of commands, the firmware registers about 40
 #ifndef EI_AT_MAX_CMDS
-#define EI_AT_MAX_CMDS      36
+#define EI_AT_MAX_CMDS      64
 #endif // EI_AT_MAX_CMDS
 
 typedef struct {
@@ -42,6 +42,17 @@ static ei_at_cmd_t ei_at_cmds[EI_AT_MAX_CMDS];
 // next index where we'll insert data
 static size_t ei_at_cmds_ix = 0;
 
+/**
+ * Check there is room for one more command, print the command that doesn't fit
+ * @param cmd The command without AT+ in front of it
+ */
+static bool ei_at_cmd_has_room(const char *cmd) {
+    if (ei_at_cmds_ix < EI_AT_MAX_CMDS) return true;
+
+    ei_printf("Failed to register AT+%s, increase EI_AT_MAX_CMDS (%d)\r\n", cmd, EI_AT_MAX_CMDS);
+    return false;
+}
+
 
 /**
  * Add an AT command with zero arguments
@@ -50,7 +61,7 @@ static size_t ei_at_cmds_ix = 0;
  * @param fn Function to be called when this AT command gets invoked
  */
 bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)()) {
-    if (ei_at_cmds_ix + 1 == EI_AT_MAX_CMDS) return false;
+    if (!ei_at_cmd_has_room(cmd)) return false;
     if (fn == NULL) return false;
 
     memset(&ei_at_cmds[ei_at_cmds_ix], 0, sizeof(ei_at_cmd_t));
@@ -71,7 +82,7 @@ bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)())
  * @param fn Function to be called when this AT command gets invoked
  */
 bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(char*)) {
-    if (ei_at_cmds_ix + 1 == EI_AT_MAX_CMDS) return false;
+    if (!ei_at_cmd_has_room(cmd)) return false;
     if (fn == NULL) return false;
 
     memset(&ei_at_cmds[ei_at_cmds_ix], 0, sizeof(ei_at_cmd_t));
@@ -92,7 +103,7 @@ bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(cha
  * @param fn Function to be called when this AT command gets invoked
  */
 bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(char*, char*)) {
-    if (ei_at_cmds_ix + 1 == EI_AT_MAX_CMDS) return false;
+    if (!ei_at_cmd_has_room(cmd)) return false;
     if (fn == NULL) return false;
 
     memset(&ei_at_cmds[ei_at_cmds_ix], 0, sizeof(ei_at_cmd_t));
@@ -113,7 +124,7 @@ bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(cha
  * @param fn Function to be called when this AT command gets invoked
  */
 bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(char*, char*, char*)) {
-    if (ei_at_cmds_ix + 1 == EI_AT_MAX_CMDS) return false;
+    if (!ei_at_cmd_has_room(cmd)) return false;
     if (fn == NULL) return false;
 
     memset(&ei_at_cmds[ei_at_cmds_ix], 0, sizeof(ei_at_cmd_t));
@@ -134,7 +145,7 @@ bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(cha
  * @param fn Function to be called when this AT command gets invoked
  */
 bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(char*, char*, char*, char*)) {
-    if (ei_at_cmds_ix + 1 == EI_AT_MAX_CMDS) return false;
+    if (!ei_at_cmd_has_room(cmd)) return false;
     if (fn == NULL) return false;
 
     memset(&ei_at_cmds[ei_at_cmds_ix], 0, sizeof(ei_at_cmd_t));
@@ -155,7 +166,7 @@ bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(cha
  * @param fn Function to be called when this AT command gets invoked
  */
 bool ei_at_cmd_register(const char *cmd, const char *description, void (*fn)(char*, char*, char*, char*, char*)) {
-    if (ei_at_cmds_ix + 1 == EI_AT_MAX_CMDS) return false;
+    if (!ei_at_cmd_has_room(cmd)) return false;
     if (fn == NULL) return false;
 
     memset(&ei_at_cmds[ei_at_cmds_ix], 0, sizeof(ei_at_cmd_t));
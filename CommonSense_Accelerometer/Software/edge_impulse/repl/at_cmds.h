@@ -25,6 +25,8 @@
 
 #include "at_cmd_interface.h"
 #include "firmware-sdk/at_base64_lib.h"
+#include "firmware-sdk/at_frame_lib.h"
+#include "firmware-sdk/ei_trace.h"
 #include "ei_config.h"
 
 #define EDGE_IMPULSE_AT_COMMAND_VERSION        "1.6.0"
@@ -445,6 +447,86 @@ static void at_read_buffer(char *start_s, char *length_s, char *baudrate_s) {
     }
 }
 
+static void at_read_file_bin(char *filename, char *baudrate_s) {
+
+    if (!ei_config_get_context()->read_file) {
+        at_error_not_implemented();
+        return;
+    }
+
+    bool use_max_baudrate = false;
+    if (baudrate_s[0] == 'y') {
+       use_max_baudrate = true;
+    }
+
+    if (use_max_baudrate) {
+        ei_printf("OK\r\n");
+        EiDevice.delay_ms(100);
+        EiDevice.set_max_data_output_baudrate();
+        EiDevice.delay_ms(100);
+    }
+
+    ei_frame_begin();
+    bool exists = ei_config_get_context()->read_file(filename, ei_frame_data);
+    bool success = ei_frame_end(exists);
+
+    if (use_max_baudrate) {
+        EiDevice.delay_ms(100);
+        EiDevice.set_default_data_output_baudrate();
+        EiDevice.delay_ms(100);
+    }
+
+    if (!exists) {
+        ei_printf("File '%s' does not exist\n", filename);
+    }
+    else if (!success) {
+        ei_printf("Transfer failed\n");
+    }
+    else {
+        ei_printf("OK\n");
+    }
+}
+
+static void at_read_buffer_bin(char *start_s, char *length_s, char *baudrate_s) {
+
+    if (!ei_config_get_context()->read_buffer) {
+        at_error_not_implemented();
+        return;
+    }
+
+    size_t start = (size_t)atoi(start_s);
+    size_t length = (size_t)atoi(length_s);
+
+    bool use_max_baudrate = false;
+    if (baudrate_s[0] == 'y') {
+       use_max_baudrate = true;
+    }
+
+    if (use_max_baudrate) {
+        ei_printf("OK\r\n");
+        EiDevice.delay_ms(100);
+        EiDevice.set_max_data_output_baudrate();
+        EiDevice.delay_ms(100);
+    }
+
+    ei_frame_begin();
+    bool success = ei_config_get_context()->read_buffer(start, length, ei_frame_data);
+    success = ei_frame_end(success);
+
+    if (use_max_baudrate) {
+        EiDevice.delay_ms(100);
+        EiDevice.set_default_data_output_baudrate();
+        EiDevice.delay_ms(100);
+    }
+
+    if (!success) {
+        ei_printf("Failed to read from buffer\n");
+    }
+    else {
+        ei_printf("OK\n");
+    }
+}
+
 static void at_read_raw(char *start_s, char *length_s) {
     size_t start = (size_t)atoi(start_s);
     size_t length = (size_t)atoi(length_s);
@@ -594,6 +676,10 @@ static void at_reset() {
 //    NVIC_SystemReset();
 }
 
+static void at_trace() {
+    ei_trace_print();
+}
+
 static void at_boot_mode()
 {
     #define _BOOTLOADER_MAGIC_ADDR 0x10000000 + 0x20000
@@ -630,10 +716,13 @@ void ei_at_register_generic_cmds() {
     ei_at_cmd_register("LISTFILES", "Lists all files on the device", &at_list_files);
     ei_at_cmd_register("READFILE=", "Read a specific file (as base64) (FILENAME,USEMAXRATE?(y/n))", &at_read_file);
     ei_at_cmd_register("READBUFFER=", "Read from the temporary buffer (as base64) (START,LENGTH,USEMAXRATE?(y/n))", &at_read_buffer);
+    ei_at_cmd_register("READFILEBIN=", "Read a specific file (as binary frames) (FILENAME,USEMAXRATE?(y/n))", &at_read_file_bin);
+    ei_at_cmd_register("READBUFFERBIN=", "Read from the temporary buffer (as binary frames) (START,LENGTH,USEMAXRATE?(y/n))", &at_read_buffer_bin);
     ei_at_cmd_register("UNLINKFILE=", "Unlink a specific file", &at_unlink_file);
     ei_at_cmd_register("SAMPLESTART=", "Start sampling", &at_sample_start);
     ei_at_cmd_register("READRAW=", "Read raw from flash (START,LENGTH)", &at_read_raw);
     ei_at_cmd_register("BOOTMODE", "Jump to bootloader", &at_boot_mode);
+    ei_at_cmd_register("TRACE?", "Lists time spent per traced scope (count, min, mean, max)", &at_trace);
 }
 
 #endif // _EDGE_IMPULSE_AT_COMMANDS_CONFIG_H_
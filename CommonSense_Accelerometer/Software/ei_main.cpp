@@ -31,6 +31,8 @@
 #include "numpy.hpp"
 #include "firmware-sdk/ei_image_lib.h"
 #include "at_cmds.h"
+#include "ei_inertial_stream.h"
+#include "firmware-sdk/ei_trace.h"
 
 /**
  * @brief Init sensors, load config and run command handler
@@ -64,11 +66,20 @@ int ei_main() {
         ei_printf("Loaded configuration\n");
     }
 
+    ei_trace_init();
+    run_nn_init();
+
     /* Setup the command line commands */
     ei_at_register_generic_cmds();
     ei_at_cmd_register("RUNIMPULSE", "Run the impulse", run_nn_normal);
     ei_at_cmd_register("RUNIMPULSECONT", "Run the impulse", run_nn_continuous_normal);
     ei_at_cmd_register("RUNIMPULSEDEBUG", "Run the impulse with extra debug output", run_nn_debug);
+    ei_at_cmd_register("BASELINE?", "Lists the state of the on-device anomaly baseline", run_nn_baseline_status);
+    ei_at_cmd_register("BASELINERESET", "Forget the anomaly baseline and learn it again", run_nn_baseline_reset);
+    ei_at_cmd_register("BENCH=", "Benchmark every stage of the impulse on one window, prints JSON (ITERATIONS)",
+        run_nn_benchmark_at);
+    ei_at_cmd_register("STREAM=", "Stream accelerometer data as binary frames, 'b' stops (INTERVAL_MS,USEMAXRATE?(y/n))",
+        ei_inertial_stream_at);
     ei_printf("Type AT+HELP to see a list of commands.\r\n> ");
 
     EiDevice.set_state(eiStateFinished);
@@ -76,4 +87,4 @@ int ei_main() {
     while (1) {
         ei_command_line_handle();
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
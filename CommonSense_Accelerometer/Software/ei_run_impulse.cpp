@@ -26,6 +26,7 @@
 #include "edge-impulse-sdk/dsp/numpy.hpp"
 #include "ei_microphone.h"
 #include "ei_inertialsensor.h"
+#include "firmware-sdk/ei_benchmark.h"
 // #include "ei_camera.h"
 
 /* Extern defined spresense library function */
@@ -33,9 +34,26 @@ extern void spresense_pauseAudio(bool pause);
 
 #if defined(EI_CLASSIFIER_SENSOR) && EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_ACCELEROMETER
 
+/* Fixed-point DSP runs on the sensor counts, the float DSP on m/s2 */
+#if EI_CLASSIFIER_QUANTIZED_DSP == 1
+#if EI_INERTIAL_RAW_COUNTS != 1
+#error "EI_CLASSIFIER_QUANTIZED_DSP needs EI_INERTIAL_RAW_COUNTS"
+#endif
+typedef signal_i16_t acc_signal_t;
+#define acc_run_classifier  run_classifier_i16
+#else
+typedef signal_t acc_signal_t;
+#define acc_run_classifier  run_classifier
+#endif
+
 /* Private variables ------------------------------------------------------- */
 static float acc_buf[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
 static int acc_sample_count = 0;
+#if EI_CLASSIFIER_QUANTIZED_DSP == 1
+static int16_t acc_counts[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
+#else
+static ei_inertial_window_t acc_window;
+#endif
 
 extern int base64_encode(const char *input, size_t input_size, char *output, size_t output_size);
 
@@ -50,13 +68,120 @@ extern int base64_encode(const char *input, size_t input_size, char *output, siz
 static bool acc_data_callback(const void *sample_buf, uint32_t byteLength)
 {
     float *buffer = (float *)sample_buf;
-    for(uint32_t i = 0; i < (byteLength / sizeof(float)); i++) {
+    uint32_t n_values = byteLength / sizeof(float);
+
+    /* The sensor may deliver more axes (e.g. gyroscope) than the model uses */
+    if (n_values > EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME) {
+        n_values = EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
+    }
+
+    for(uint32_t i = 0; i < n_values; i++) {
         acc_buf[acc_sample_count + i] = buffer[i];
     }
 
     return true;
 }
 
+#if EI_CLASSIFIER_QUANTIZED_DSP == 1
+/**
+ * @brief      Sample one window of counts into acc_counts, interleaved. The
+ *             spectral analysis block applies the axis scale.
+ *
+ * @param      signal  Set to the sampled window, scale in m/s2 per count
+ *
+ * @return     false if sampling failed
+ */
+static bool acc_sample_window(acc_signal_t *signal)
+{
+    if (ei_inertial_sample_start(&acc_data_callback, EI_CLASSIFIER_INTERVAL_MS) == false) {
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < EI_CLASSIFIER_RAW_SAMPLE_COUNT; i++) {
+        if (ei_inertial_read_counts(&acc_counts[i * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME],
+                EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME)) {
+            ei_printf("Err: failed to get sensor data\r\n");
+            ok = false;
+            break;
+        }
+    }
+
+    /* No samples needed during inferencing */
+    ei_inertial_sample_stop();
+
+    if (ok) {
+        int err = numpy::signal_from_buffer_i16(acc_counts, EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, signal);
+        if (err != 0) {
+            ei_printf("ERR: signal_from_buffer_i16 failed (%d)\n", err);
+            ok = false;
+        }
+        signal->scale = ei_inertial_count_scale();
+    }
+
+    return ok;
+}
+#else
+/**
+ * @brief      Axis scale of the first spectral analysis block, applied while
+ *             sampling so the block does not have to
+ */
+static float acc_window_scale(void)
+{
+    int (*spectral_fn)(signal_t *, matrix_t *, void *, const float) = &extract_spectral_analysis_features;
+
+    for (size_t ix = 0; ix < ei_dsp_blocks_size; ix++) {
+        if (ei_dsp_blocks[ix].extract_fn == spectral_fn) {
+            return ((ei_dsp_config_spectral_analysis_t *)ei_dsp_blocks[ix].config)->scale_axes;
+        }
+    }
+    return 1.0f;
+}
+
+/**
+ * @brief      Sample one window into acc_buf, one row per axis
+ *
+ * @param      signal  Set to the sampled window
+ *
+ * @return     false if sampling failed
+ */
+static bool acc_sample_window(acc_signal_t *signal)
+{
+    if (ei_inertial_window_init(&acc_window, acc_buf, EI_CLASSIFIER_RAW_SAMPLE_COUNT,
+            EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME, acc_window_scale()) == false) {
+        ei_printf("ERR: Sensor has fewer axes than the model\r\n");
+        return false;
+    }
+
+    if (ei_inertial_sample_start(&acc_data_callback, EI_CLASSIFIER_INTERVAL_MS) == false) {
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < EI_CLASSIFIER_RAW_SAMPLE_COUNT; i++) {
+        if (ei_inertial_read_window(&acc_window)) {
+            ei_printf("Err: failed to get sensor data\r\n");
+            ok = false;
+            break;
+        }
+    }
+
+    /* No samples needed during inferencing */
+    ei_inertial_sample_stop();
+
+    if (ok) {
+        int err = numpy::signal_from_axes_buffer(acc_buf, EI_CLASSIFIER_RAW_SAMPLE_COUNT,
+            EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME, acc_window.scale, signal);
+        if (err != 0) {
+            ei_printf("ERR: signal_from_axes_buffer failed (%d)\n", err);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+#endif
+
 /**
  * @brief      Sample data and run inferencing. Prints results to terminal
  *
@@ -76,33 +201,19 @@ void run_nn(bool debug) {
 
     ei_printf("Starting inferencing, press 'b' to break\n");
 
-    ei_inertial_sample_start(&acc_data_callback, EI_CLASSIFIER_INTERVAL_MS);
-
     while (stop_inferencing == false) {
 
         ei_printf("Sampling...\n");
 
-        /* Run sampler */
-        acc_sample_count = 0;
-        for(int i = 0; i < EI_CLASSIFIER_RAW_SAMPLE_COUNT; i++) {
-            if(ei_inertial_read_data()) {
-                ei_printf("Err: failed to get sensor data\r\n");
-                stop_inferencing = true;
-                break;
-            }
-            acc_sample_count += EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
-        }
-
-        // Create a data structure to represent this window of data
-        signal_t signal;
-        int err = numpy::signal_from_buffer(acc_buf, EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, &signal);
-        if (err != 0) {
-            ei_printf("ERR: signal_from_buffer failed (%d)\n", err);
+        /* Run sampler, no samples needed during inferencing and the 2 second pause */
+        acc_signal_t signal;
+        if (acc_sample_window(&signal) == false) {
+            break;
         }
 
         // run the impulse: DSP, neural network and the Anomaly algorithm
         ei_impulse_result_t result = { 0 };
-        EI_IMPULSE_ERROR ei_error = run_classifier(&signal, &result, debug);
+        EI_IMPULSE_ERROR ei_error = acc_run_classifier(&signal, &result, debug);
         if (ei_error != EI_IMPULSE_OK) {
             ei_printf("Failed to run impulse (%d)\n", ei_error);
             break;
@@ -116,6 +227,11 @@ void run_nn(bool debug) {
         }
 #if EI_CLASSIFIER_HAS_ANOMALY == 1
         ei_printf("    anomaly score: %f\r\n", result.anomaly);
+#endif
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+        if (run_anomaly_baseline_save_pending() != 0) {
+            ei_printf("WARN: failed to save the anomaly baseline\r\n");
+        }
 #endif
         ei_printf("Starting inferencing in 2 seconds...\n");
 
@@ -132,6 +248,156 @@ void run_nn(bool debug) {
     }
 }
 
+/**
+ * @brief      Sample data slice by slice and classify the last window after every slice,
+ *             so a new result comes in every EI_CLASSIFIER_SLICE_SIZE samples. The
+ *             printed classifications go through the moving average filter of
+ *             run_classifier_continuous, the anomaly score does not.
+ *
+ * @param[in]  debug  The debug
+ */
+void run_nn_continuous(bool debug)
+{
+    bool stop_inferencing = false;
+
+    // summary of inferencing settings (from model_metadata.h)
+    ei_printf("Inferencing settings:\n");
+    ei_printf("\tInterval: %.4f ms\n", (float)EI_CLASSIFIER_INTERVAL_MS);
+    ei_printf("\tFrame size: %d\n", EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE);
+    ei_printf("\tSample length: %.4f ms.\n", 1000.0f * static_cast<float>(EI_CLASSIFIER_RAW_SAMPLE_COUNT) /
+                  (1000.0f / static_cast<float>(EI_CLASSIFIER_INTERVAL_MS)));
+    ei_printf("\tSlice size: %d\n", EI_CLASSIFIER_SLICE_SIZE);
+    ei_printf("\tNo. of classes: %d\n", sizeof(ei_classifier_inferencing_categories) / sizeof(ei_classifier_inferencing_categories[0]));
+
+    ei_printf("Starting inferencing, press 'b' to break\n");
+
+    run_classifier_init();
+    if (ei_inertial_sample_start(&acc_data_callback, EI_CLASSIFIER_INTERVAL_MS) == false) {
+        return;
+    }
+
+    /* Never hold up sampling for the serial port, drop output instead */
+    uint32_t tx_dropped = ei_serial_get_tx_dropped();
+    ei_serial_set_tx_drop(true);
+
+    while (stop_inferencing == false) {
+
+        /* Sample one slice */
+        acc_sample_count = 0;
+        for(int i = 0; i < EI_CLASSIFIER_SLICE_SIZE; i++) {
+            if(ei_inertial_read_data()) {
+                ei_printf("Err: failed to get sensor data\r\n");
+                stop_inferencing = true;
+                break;
+            }
+            acc_sample_count += EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME;
+        }
+
+        if (stop_inferencing) {
+            break;
+        }
+
+        signal_t signal;
+        int err = numpy::signal_from_buffer(acc_buf, EI_CLASSIFIER_SLICE_SIZE * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME, &signal);
+        if (err != 0) {
+            ei_printf("ERR: signal_from_buffer failed (%d)\n", err);
+            break;
+        }
+
+        ei_impulse_result_t result = { 0 };
+        EI_IMPULSE_ERROR ei_error = run_classifier_continuous(&signal, &result, debug);
+        if (ei_error != EI_IMPULSE_OK) {
+            ei_printf("Failed to run impulse (%d)\n", ei_error);
+            break;
+        }
+
+        // the first results only arrive once a full window has been sampled
+        if (result.classification[0].label != NULL) {
+            ei_printf("Predictions (DSP: %d ms., Classification: %d ms., Anomaly: %d ms.): \n",
+                      result.timing.dsp, result.timing.classification, result.timing.anomaly);
+            for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+                ei_printf("    %s: \t%f\r\n", result.classification[ix].label, result.classification[ix].value);
+            }
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+            ei_printf("    anomaly score: %f\r\n", result.anomaly);
+#endif
+        }
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+        if (run_anomaly_baseline_save_pending() != 0) {
+            ei_printf("WARN: failed to save the anomaly baseline\r\n");
+        }
+#endif
+
+        if(ei_user_invoke_stop_lib()) {
+            ei_printf("Inferencing stopped by user\r\n");
+            EiDevice.set_state(eiStateIdle);
+            break;
+        }
+    }
+
+    ei_inertial_sample_stop();
+    ei_serial_set_tx_drop(false);
+
+    if (ei_inertial_get_dropped_samples() > 0) {
+        ei_printf("WARN: %lu samples dropped, inferencing is slower than sampling\r\n",
+                  (unsigned long)ei_inertial_get_dropped_samples());
+    }
+    if (ei_serial_get_tx_dropped() != tx_dropped) {
+        ei_printf("WARN: %lu bytes of serial output dropped\r\n",
+                  (unsigned long)(ei_serial_get_tx_dropped() - tx_dropped));
+    }
+}
+
+#if EI_PROFILER_STAGES == 1
+/**
+ * @brief      Sample one window, then run the impulse on it a number of times
+ *             and print the per-stage latencies as JSON
+ *
+ * @param[in]  iterations  Number of times the window is classified
+ */
+static void run_nn_benchmark(uint32_t iterations)
+{
+    ei_benchmark_start();
+
+    ei_printf("Sampling...\r\n");
+    acc_signal_t signal;
+    if (acc_sample_window(&signal) == false) {
+        ei_benchmark_stop();
+        return;
+    }
+
+    /* The same window over and over must not end up in the baseline */
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+    run_anomaly_baseline_hold(true);
+#endif
+
+    ei_printf("Running %lu iterations, press 'b' to break\r\n", (unsigned long)iterations);
+    for (uint32_t ix = 0; ix < iterations; ix++) {
+        ei_impulse_result_t result = { 0 };
+
+        ei_profiler_mark_t mark = ei_benchmark_window_begin();
+        EI_IMPULSE_ERROR ei_error = acc_run_classifier(&signal, &result, false);
+        ei_benchmark_window_end(&mark);
+
+        if (ei_error != EI_IMPULSE_OK) {
+            ei_printf("Failed to run impulse (%d)\n", ei_error);
+            break;
+        }
+        if (ei_user_invoke_stop_lib()) {
+            ei_printf("Benchmark stopped by user\r\n");
+            break;
+        }
+    }
+
+    ei_benchmark_stop();
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+    run_anomaly_baseline_hold(false);
+#endif
+
+    ei_benchmark_print_json(EiDevice.get_type_pointer());
+}
+#endif // EI_PROFILER_STAGES == 1
+
 #elif defined(EI_CLASSIFIER_SENSOR) && EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_MICROPHONE
 void run_nn(bool debug) {
     if (EI_CLASSIFIER_FREQUENCY != 16000) {
@@ -324,6 +590,11 @@ void run_nn(bool debug) {}
 
 #endif // EI_CLASSIFIER_SENSOR
 
+void run_nn_init(void) {
+    // prepares the model once when EI_CLASSIFIER_PERSISTENT_INTERPRETER is set
+    run_classifier_init();
+}
+
 void run_nn_normal(void) {
     run_nn(false);
 }
@@ -333,9 +604,50 @@ void run_nn_debug(void) {
 }
 
 void run_nn_continuous_normal(void) {
-#if defined(EI_CLASSIFIER_SENSOR) && EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_MICROPHONE
+#if defined(EI_CLASSIFIER_SENSOR) && (EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_MICROPHONE || \
+    EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_ACCELEROMETER)
     run_nn_continuous(false);
 #else
     ei_printf("Error no continuous classification available for current model\r\n");
 #endif
 }
+
+void run_nn_baseline_status(void) {
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+    const ei_anomaly_baseline_t *baseline = run_anomaly_baseline_state();
+
+    ei_printf("Windows learned: %lu/%d\r\n", (unsigned long)baseline->windows, EI_ANOMALY_BASELINE_WINDOWS);
+    if (!ei_anomaly_baseline_trained(baseline)) {
+        ei_printf("Learning, anomaly scores come from the model\r\n");
+        return;
+    }
+    for (size_t ix = 0; ix < EI_ANOMALY_BASELINE_CLUSTERS; ix++) {
+        ei_printf("Cluster %d: %lu windows, max error ", (int)ix, (unsigned long)baseline->members[ix]);
+        ei_printf_float(baseline->clusters[ix].max_error);
+        ei_printf("\r\n");
+    }
+#else
+    ei_printf("Error no anomaly baseline for current model\r\n");
+#endif
+}
+
+void run_nn_baseline_reset(void) {
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+    run_anomaly_baseline_reset();
+    ei_printf("OK\r\n");
+#else
+    ei_printf("Error no anomaly baseline for current model\r\n");
+#endif
+}
+
+void run_nn_benchmark_at(char *iterations_s) {
+#if EI_PROFILER_STAGES == 1 && defined(EI_CLASSIFIER_SENSOR) && EI_CLASSIFIER_SENSOR == EI_CLASSIFIER_SENSOR_ACCELEROMETER
+    int iterations = atoi(iterations_s);
+    if (iterations <= 0) {
+        iterations = 100;
+    }
+    run_nn_benchmark((uint32_t)iterations);
+#else
+    ei_printf("Error no benchmark available, build with EI_PROFILER_STAGES=1\r\n");
+#endif
+}
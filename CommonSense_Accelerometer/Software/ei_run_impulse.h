@@ -24,8 +24,12 @@
 #define EI_RUN_IMPULSE_H
 
 /* Prototypes -------------------------------------------------------------- */
+void run_nn_init(void);
 void run_nn_normal(void);
 void run_nn_debug(void);
 void run_nn_continuous_normal(void);
+void run_nn_baseline_status(void);
+void run_nn_baseline_reset(void);
+void run_nn_benchmark_at(char *iterations_s);
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
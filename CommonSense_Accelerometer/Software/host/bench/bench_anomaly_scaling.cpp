@@ -0,0 +1,117 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Anomaly score time per input against the number of clusters and axes: the
+ * pruned structure-of-arrays scorer (ei_anomaly_soa_min_distance) against
+ * the brute force scorer it replaced, which computes the distance to every
+ * cluster. Half of the inputs lie close to a cluster, half further out.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "edge-impulse-sdk/anomaly/anomaly.h"
+#include "ei_anomaly_reference.h"
+#include "ei_host_bench.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define BENCH_MAX_CLUSTERS  1024
+#define BENCH_MAX_AXES      256
+#define BENCH_INPUTS        1000
+#define BENCH_ROUNDS        3
+
+/* Private variables ------------------------------------------------------- */
+static float clusters[BENCH_MAX_CLUSTERS * (BENCH_MAX_AXES + 1)];
+static float soa_buffer[EI_ANOMALY_SOA_BUFFER_SIZE(BENCH_MAX_CLUSTERS, BENCH_MAX_AXES)];
+static float inputs[BENCH_INPUTS * BENCH_MAX_AXES];
+static float scores_ref[BENCH_INPUTS];
+static float scores_soa[BENCH_INPUTS];
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief Best time per input over BENCH_ROUNDS rounds, in ns
+ */
+static double bench(bool soa_scorer, const ei_anomaly_soa_t *soa, size_t cluster_count, size_t axis_size)
+{
+    // roughly the same amount of work for every size
+    int repeat = (int)(2e7 / ((double)cluster_count * axis_size * BENCH_INPUTS)) + 1;
+
+    double best_us = ei_bench_best_us(BENCH_ROUNDS, [&]() {
+        for (int rx = 0; rx < repeat; rx++) {
+            for (int ix = 0; ix < BENCH_INPUTS; ix++) {
+                if (soa_scorer) {
+                    scores_soa[ix] = ei_anomaly_soa_min_distance(soa, &inputs[ix * axis_size]);
+                }
+                else {
+                    scores_ref[ix] = ei_anomaly_brute_force_min_distance(&inputs[ix * axis_size], axis_size, clusters, cluster_count);
+                }
+            }
+        }
+        return true;
+    });
+
+    return best_us * 1e3 / ((double)repeat * BENCH_INPUTS);
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    const size_t cluster_counts[] = { 32, 256, BENCH_MAX_CLUSTERS };
+    const size_t axis_sizes[] = { 3, 16, 64, BENCH_MAX_AXES };
+
+    printf("anomaly score per input, %d inputs\n", BENCH_INPUTS);
+    printf("  clusters  axes  brute force ns     soa ns  speedup  differing scores\n");
+
+    for (size_t cx = 0; cx < sizeof(cluster_counts) / sizeof(cluster_counts[0]); cx++) {
+        for (size_t ax = 0; ax < sizeof(axis_sizes) / sizeof(axis_sizes[0]); ax++) {
+            size_t cluster_count = cluster_counts[cx];
+            size_t axis_size = axis_sizes[ax];
+
+            ei_anomaly_random_clusters(clusters, cluster_count, axis_size);
+            for (int ix = 0; ix < BENCH_INPUTS; ix++) {
+                ei_anomaly_random_input(&inputs[ix * axis_size], clusters, cluster_count, axis_size, ix & 1);
+            }
+
+            ei_anomaly_soa_t soa;
+            ei_anomaly_soa_init(&soa, &clusters[0], &clusters[axis_size], axis_size + 1,
+                cluster_count, axis_size, soa_buffer);
+
+            double ref_ns = bench(false, &soa, cluster_count, axis_size);
+            double soa_ns = bench(true, &soa, cluster_count, axis_size);
+
+            int differing = 0;
+            for (int ix = 0; ix < BENCH_INPUTS; ix++) {
+                differing += memcmp(&scores_ref[ix], &scores_soa[ix], sizeof(float)) != 0;
+            }
+
+            printf("  %8d  %4d  %14.1f  %9.1f  %6.1fx  %d\n", (int)cluster_count, (int)axis_size,
+                ref_ns, soa_ns, ref_ns / soa_ns, differing);
+        }
+    }
+
+    return 0;
+}
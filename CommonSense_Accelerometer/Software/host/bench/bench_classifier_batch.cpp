@@ -0,0 +1,161 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Windows classified per second when a backlog of windows is classified one
+ * run_classifier call at a time, against run_classifier_batch, which sets the
+ * model up and tears it down once per batch. Checks both give the same
+ * results.
+ *
+ * The host build keeps the model prepared between inferences
+ * (EI_CLASSIFIER_PERSISTENT_INTERPRETER), which leaves a batch nothing to
+ * share. This benchmark is built with the SDK default instead, where every
+ * run_classifier call initializes and resets the model.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <math.h>
+
+#undef EI_CLASSIFIER_PERSISTENT_INTERPRETER
+#define EI_CLASSIFIER_PERSISTENT_INTERPRETER    0
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "ei_host_bench.h"
+
+using namespace ei;
+
+/* Constant defines -------------------------------------------------------- */
+#define BENCH_WINDOWS       64
+#define BENCH_AXES          EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME
+#define BENCH_HOP           (EI_CLASSIFIER_RAW_SAMPLE_COUNT / 4)
+#define BENCH_SAMPLES       (EI_CLASSIFIER_RAW_SAMPLE_COUNT + (BENCH_WINDOWS - 1) * BENCH_HOP)
+#define BENCH_REPEAT        20
+#define BENCH_ROUNDS        5
+
+/* Private variables ------------------------------------------------------- */
+static float stream[BENCH_SAMPLES * BENCH_AXES];
+static signal_t signals[BENCH_WINDOWS];
+static ei_impulse_result_t results_single[BENCH_WINDOWS];
+static ei_impulse_result_t results_batch[BENCH_WINDOWS];
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief Best time per window over BENCH_ROUNDS rounds, in us
+ *
+ * @param batch_size  Windows per run_classifier_batch call, 0 to call
+ *                    run_classifier for every window
+ */
+static double bench(size_t batch_size)
+{
+    double best_us = ei_bench_best_us(BENCH_ROUNDS, [&]() {
+        for (int rx = 0; rx < BENCH_REPEAT; rx++) {
+            for (size_t ix = 0; ix < BENCH_WINDOWS; ix += (batch_size ? batch_size : 1)) {
+                EI_IMPULSE_ERROR res;
+                if (batch_size == 0) {
+                    res = run_classifier(&signals[ix], &results_single[ix], false);
+                }
+                else {
+                    res = run_classifier_batch(&signals[ix], batch_size, &results_batch[ix], false);
+                }
+                if (res != EI_IMPULSE_OK) {
+                    printf("ERR: classifier failed (%d)\n", res);
+                    return false;
+                }
+            }
+        }
+        return true;
+    });
+
+    return best_us / ((double)BENCH_REPEAT * BENCH_WINDOWS);
+}
+
+/**
+ * @brief Number of windows where the batch results differ from run_classifier
+ */
+static int count_mismatches(void)
+{
+    int mismatches = 0;
+
+    for (size_t ix = 0; ix < BENCH_WINDOWS; ix++) {
+        bool same = true;
+        for (size_t lx = 0; lx < EI_CLASSIFIER_LABEL_COUNT; lx++) {
+            same &= results_batch[ix].classification[lx].value == results_single[ix].classification[lx].value;
+        }
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+        same &= results_batch[ix].anomaly == results_single[ix].anomaly;
+#endif
+        if (!same) {
+            mismatches++;
+        }
+    }
+
+    return mismatches;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+#if EI_CLASSIFIER_HAS_ANOMALY == 1 && EI_CLASSIFIER_ANOMALY_BASELINE == 1
+    // learning the baseline would make every pass score differently
+    run_anomaly_baseline_hold(true);
+#endif
+
+    for (int ix = 0; ix < BENCH_SAMPLES; ix++) {
+        stream[ix * BENCH_AXES + 0] = sinf(ix * 0.3f) * 3.f + (ix > BENCH_SAMPLES / 2 ? 2.f * sinf(ix * 1.1f) : 0.f);
+        stream[ix * BENCH_AXES + 1] = cosf(ix * 0.7f);
+        stream[ix * BENCH_AXES + 2] = 9.8f + 0.1f * sinf(ix * 1.3f);
+    }
+    for (int ix = 0; ix < BENCH_WINDOWS; ix++) {
+        numpy::signal_from_buffer(&stream[ix * BENCH_HOP * BENCH_AXES], EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, &signals[ix]);
+    }
+
+    double single_us = bench(0);
+    if (single_us == 0) {
+        return 1;
+    }
+
+    printf("classify %d windows, %d features per window\n", BENCH_WINDOWS, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+    printf("  run_classifier          %8.2f us/window  %8.0f windows/s\n", single_us, 1e6 / single_us);
+
+    int mismatches = 0;
+    for (size_t batch_size = 1; batch_size <= BENCH_WINDOWS; batch_size <<= 1) {
+        double batch_us = bench(batch_size);
+        if (batch_us == 0) {
+            return 1;
+        }
+        mismatches += count_mismatches();
+
+        printf("  batch of %2d             %8.2f us/window  %8.0f windows/s  %.2fx\n",
+            (int)batch_size, batch_us, 1e6 / batch_us, single_us / batch_us);
+    }
+
+    if (mismatches) {
+        printf("ERR: %d batch results differ from run_classifier\n", mismatches);
+        return 1;
+    }
+    printf("  batch results identical\n");
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * numpy::rfft time per call with the cached kissfft plan against the per-call
+ * setup it replaced, which allocated the kissfft config and computed its
+ * twiddles on every call (software_rfft before the FFT plan cache). Also
+ * checks both give the same output, bit for bit.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "edge-impulse-sdk/dsp/numpy.hpp"
+#include "ei_host_bench.h"
+
+using namespace ei;
+
+/* Constant defines -------------------------------------------------------- */
+#define BENCH_MAX_FFT       1024
+#define BENCH_CALLS         20000
+#define BENCH_ROUNDS        5
+
+/* Private variables ------------------------------------------------------- */
+static float input[BENCH_MAX_FFT];
+static float magnitude_plan[BENCH_MAX_FFT / 2 + 1];
+static float magnitude_ref[BENCH_MAX_FFT / 2 + 1];
+static fft_complex_t complex_plan[BENCH_MAX_FFT / 2 + 1];
+static fft_complex_t complex_ref[BENCH_MAX_FFT / 2 + 1];
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief numpy::rfft from before the plan cache, magnitude or complex output
+ */
+static int rfft_reference(const float *src, size_t n_fft, float *magnitude, fft_complex_t *complex)
+{
+    size_t n_fft_out_features = (n_fft / 2) + 1;
+
+    float *fft_input = (float*)ei_dsp_malloc(n_fft * sizeof(float));
+    kiss_fft_cpx *fft_output = (kiss_fft_cpx*)ei_dsp_malloc(n_fft_out_features * sizeof(kiss_fft_cpx));
+    if (!fft_input || !fft_output) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+    memcpy(fft_input, src, n_fft * sizeof(float));
+
+    size_t kiss_fftr_mem_length;
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(n_fft, 0, NULL, NULL, &kiss_fftr_mem_length);
+    if (!cfg) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+
+    kiss_fftr(cfg, fft_input, fft_output);
+
+    for (size_t ix = 0; ix < n_fft_out_features; ix++) {
+        if (magnitude) {
+            magnitude[ix] = sqrt(pow(fft_output[ix].r, 2) + pow(fft_output[ix].i, 2));
+        }
+        else {
+            complex[ix].r = fft_output[ix].r;
+            complex[ix].i = fft_output[ix].i;
+        }
+    }
+
+    ei_dsp_free(cfg, kiss_fftr_mem_length);
+    ei_dsp_free(fft_output, n_fft_out_features * sizeof(kiss_fft_cpx));
+    ei_dsp_free(fft_input, n_fft * sizeof(float));
+
+    return EIDSP_OK;
+}
+
+/**
+ * @brief Best time per call over BENCH_ROUNDS rounds
+ */
+static double bench(bool plan, bool magnitude, size_t n_fft)
+{
+    size_t out_size = n_fft / 2 + 1;
+
+    double best_us = ei_bench_best_us(BENCH_ROUNDS, [&]() {
+        for (int ix = 0; ix < BENCH_CALLS; ix++) {
+            int ret;
+            if (plan) {
+                ret = magnitude ?
+                    numpy::rfft(input, n_fft, magnitude_plan, out_size, n_fft) :
+                    numpy::rfft(input, n_fft, complex_plan, out_size, n_fft);
+            }
+            else {
+                ret = rfft_reference(input, n_fft,
+                    magnitude ? magnitude_ref : NULL, magnitude ? NULL : complex_ref);
+            }
+            if (ret != EIDSP_OK) {
+                printf("ERR: rfft failed (%d)\n", ret);
+                return false;
+            }
+        }
+        return true;
+    });
+
+    return best_us / BENCH_CALLS;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    const size_t lengths[] = { 128, 256, 512, BENCH_MAX_FFT };
+    bool identical = true;
+
+    for (size_t ix = 0; ix < BENCH_MAX_FFT; ix++) {
+        input[ix] = sinf(ix * 0.3f) + 0.1f * (ix % 7);
+    }
+
+    printf("numpy::rfft (kissfft), us per call\n");
+    printf("  n_fft  magnitude setup   plan  speedup  complex setup   plan  speedup\n");
+
+    for (size_t lx = 0; lx < sizeof(lengths) / sizeof(lengths[0]); lx++) {
+        size_t n_fft = lengths[lx];
+        size_t out_size = n_fft / 2 + 1;
+
+        double mag_ref_us = bench(false, true, n_fft);
+        double mag_plan_us = bench(true, true, n_fft);
+        double cpx_ref_us = bench(false, false, n_fft);
+        double cpx_plan_us = bench(true, false, n_fft);
+        if (mag_ref_us == 0 || mag_plan_us == 0 || cpx_ref_us == 0 || cpx_plan_us == 0) {
+            return 1;
+        }
+
+        identical &= memcmp(magnitude_plan, magnitude_ref, out_size * sizeof(float)) == 0;
+        identical &= memcmp(complex_plan, complex_ref, out_size * sizeof(fft_complex_t)) == 0;
+
+        printf("  %5d  %15.2f  %5.2f  %6.2fx  %13.2f  %5.2f  %6.2fx\n", (int)n_fft,
+            mag_ref_us, mag_plan_us, mag_ref_us / mag_plan_us,
+            cpx_ref_us, cpx_plan_us, cpx_ref_us / cpx_plan_us);
+    }
+
+    printf("  output %s\n", identical ? "identical" : "DIFFERS");
+
+    return identical ? 0 : 1;
+}
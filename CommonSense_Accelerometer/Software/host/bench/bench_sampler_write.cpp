@@ -0,0 +1,338 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Sample capture throughput to the SD card: a 60 s, 3-axis capture at 16 ms
+ * with the real sampler (ei_sampler_start_sampling) and its write-behind
+ * block buffer, against the 4-byte word writer it replaced, which did one
+ * storage write per word. Both go through the host SD port, a file in a
+ * temporary directory. The sensor is simulated here
+ * (ei_sampler_set_sensor), so the 60 s of samples are produced as fast as the
+ * host runs. Also checks both write the same
+ * sample file.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "ei_sampler.h"
+#include "ei_config_types.h"
+#include "ei_sony_spresense_fs_commands.h"
+#include "sensor_aq.h"
+#include "sensor_aq_mbedtls_hs256.h"
+#include "ei_host_port.h"
+#include "ei_host_bench.h"
+
+/* Extern reference -------------------------------------------------------- */
+extern ei_config_t *ei_config_get_config();
+
+/* Constant defines -------------------------------------------------------- */
+#define BENCH_INTERVAL_MS   16
+#define BENCH_LENGTH_MS     60000
+#define BENCH_AXES          3
+#define BENCH_ROUNDS        5
+#define BENCH_HMAC_KEY      "0123456789abcdef0123456789abcdef"
+#define BENCH_FILE_SIZE     (256 * 1024)
+
+/* Private variables ------------------------------------------------------- */
+static char sd_dir[] = "/tmp/ei_bench_sampler_XXXXXX";
+static char sample_path[128];
+static uint8_t file_blocks[BENCH_FILE_SIZE];
+static uint8_t file_words[BENCH_FILE_SIZE];
+
+/* Simulated sensor */
+static sampler_callback sensor_callback;
+static uint32_t sensor_sample;
+
+/* The 4-byte word writer */
+static char ref_word_buf[4];
+static uint32_t ref_write_addr;
+static uint32_t ref_header_offset;
+static unsigned char ref_ctx_buffer[1024];
+static EI_SENSOR_AQ_STREAM ref_stream;
+
+/* Private functions ------------------------------------------------------- */
+
+static void sensor_values(uint32_t sample, float values[BENCH_AXES])
+{
+    float t = sample * (BENCH_INTERVAL_MS / 1000.0f);
+    values[0] = 3.0f * sinf(t * 6.0f);
+    values[1] = cosf(t * 2.5f);
+    values[2] = 9.81f + 0.1f * sinf(t * 11.0f);
+}
+
+/* The sampler's sensor, one sample per read */
+static bool sensor_start(sampler_callback callback, float sample_interval_ms)
+{
+    sensor_callback = callback;
+    sensor_sample = 0;
+    return true;
+}
+
+static int sensor_read_data(void)
+{
+    float values[BENCH_AXES];
+
+    if (sensor_callback) {
+        sensor_values(sensor_sample++, values);
+        sensor_callback(values, sizeof(values));
+    }
+    return 0;
+}
+
+static void sensor_stop(void)
+{
+    sensor_callback = NULL;
+}
+
+/**
+ * @brief ei_write from before the block buffer, one storage write per word
+ */
+static size_t ref_write(const void *buffer, size_t size, size_t count, EI_SENSOR_AQ_STREAM*)
+{
+    for (size_t i = 0; i < count; i++) {
+        ref_word_buf[ref_write_addr & 0x3] = *((char *)buffer + i);
+
+        if ((++ref_write_addr & 0x03) == 0x00) {
+            ei_sony_spresense_fs_write_samples(ref_word_buf, (ref_write_addr - 4) + ref_header_offset, 4);
+        }
+    }
+
+    return count;
+}
+
+static int ref_seek(EI_SENSOR_AQ_STREAM*, long int offset, int origin)
+{
+    return 0;
+}
+
+static time_t ref_time(time_t *t)
+{
+    time_t cur_time = 4564867;
+    if (t) {
+        *t = cur_time;
+    }
+    return cur_time;
+}
+
+/**
+ * @brief ei_write_last_data from before the block buffer
+ */
+static void ref_write_last_data(void)
+{
+    uint8_t fill = ((uint8_t)ref_write_addr & 0x03);
+    uint8_t insert_end_address = 0;
+
+    if (fill != 0x00) {
+        for (uint8_t i = fill; i < 4; i++) {
+            ref_word_buf[i] = 0xFF;
+        }
+        ei_sony_spresense_fs_write_samples(ref_word_buf, (ref_write_addr & ~0x03) + ref_header_offset, 4);
+        insert_end_address = 4;
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        ref_word_buf[i] = 0xFF;
+    }
+    ei_sony_spresense_fs_write_samples(ref_word_buf, (ref_write_addr & ~0x03) + ref_header_offset + insert_end_address, 4);
+}
+
+/**
+ * @brief The sampler's header, sample and signature writes, with the 4-byte
+ *        word writer
+ */
+static bool capture_words(sensor_aq_payload_info *payload, uint32_t samples_required)
+{
+    ei_config_t *config = ei_config_get_config();
+    sensor_aq_signing_ctx_t signing_ctx;
+    sensor_aq_mbedtls_hs256_ctx_t hs_ctx;
+    sensor_aq_ctx ctx = { { ref_ctx_buffer, sizeof(ref_ctx_buffer) }, &signing_ctx, &ref_write, &ref_seek, &ref_time };
+    uint32_t block_size = ei_sony_spresense_fs_get_block_size();
+
+    memset(ref_ctx_buffer, 0, sizeof(ref_ctx_buffer));
+    if (ei_sony_spresense_fs_erase_sampledata(0, samples_required * BENCH_AXES * sizeof(float) * 4 + block_size) != 0) {
+        return false;
+    }
+
+    sensor_aq_init_mbedtls_hs256_context(&signing_ctx, &hs_ctx, config->sample_hmac_key);
+    if (sensor_aq_init(&ctx, payload, NULL, true) != AQ_OK) {
+        return false;
+    }
+
+    size_t end_of_header_ix = 0;
+    for (size_t ix = ctx.cbor_buffer.len - 1; ix > 0; ix--) {
+        if (((uint8_t *)ctx.cbor_buffer.ptr)[ix] != 0x0) {
+            end_of_header_ix = ix;
+            break;
+        }
+    }
+    if (end_of_header_ix == 0 || ei_sony_spresense_fs_write_samples(ctx.cbor_buffer.ptr, 0, end_of_header_ix) != 0) {
+        return false;
+    }
+
+    ctx.stream = &ref_stream;
+    ref_header_offset = end_of_header_ix;
+    ref_write_addr = 0;
+
+    for (uint32_t ix = 0; ix < samples_required; ix++) {
+        float values[BENCH_AXES];
+        sensor_values(ix, values);
+        sensor_aq_add_data(&ctx, values, BENCH_AXES);
+    }
+    if (sensor_aq_flush(&ctx) != AQ_OK) {
+        return false;
+    }
+    ref_write_last_data();
+    ei_sony_spresense_fs_close_sample_file();
+
+    uint8_t final_byte[] = { 0xff };
+    if (ctx.signature_ctx->update(ctx.signature_ctx, final_byte, 1) != 0 ||
+        ctx.signature_ctx->finish(ctx.signature_ctx, ctx.hash_buffer.buffer) != 0) {
+        return false;
+    }
+
+    uint8_t *page_buffer = (uint8_t *)malloc(block_size);
+    if (!page_buffer || ei_sony_spresense_fs_read_sample_data(page_buffer, 0, block_size) != 0) {
+        free(page_buffer);
+        return false;
+    }
+    const char hex[] = "0123456789abcdef";
+    for (size_t ix = 0; ix < ctx.hash_buffer.size / 2; ix++) {
+        page_buffer[ctx.signature_index + ix * 2] = hex[ctx.hash_buffer.buffer[ix] >> 4];
+        page_buffer[ctx.signature_index + ix * 2 + 1] = hex[ctx.hash_buffer.buffer[ix] & 0xf];
+    }
+    ei_sony_spresense_fs_close_sample_file();
+
+    bool ok = ei_sony_spresense_fs_erase_sampledata(0, block_size) == 0 &&
+        ei_sony_spresense_fs_write_samples(page_buffer, 0, block_size) == 0;
+
+    free(page_buffer);
+    ei_sony_spresense_fs_close_sample_file();
+
+    return ok;
+}
+
+/**
+ * @brief Read back the sample file
+ *
+ * @return size, 0 on error
+ */
+static size_t read_sample_file(uint8_t *buffer)
+{
+    FILE *f = fopen(sample_path, "rb");
+    if (!f) {
+        return 0;
+    }
+    size_t size = fread(buffer, 1, BENCH_FILE_SIZE, f);
+    fclose(f);
+    return size;
+}
+
+/**
+ * @brief Best capture time over BENCH_ROUNDS rounds, the sampler's prints go
+ *        to /dev/null. Every round starts without a sample file.
+ */
+static double bench(bool blocks, uint32_t samples_required)
+{
+    sensor_aq_payload_info payload = {
+        "bench", "BENCH_SAMPLER", BENCH_INTERVAL_MS,
+        { { "accX", "m/s2" }, { "accY", "m/s2" }, { "accZ", "m/s2" } }
+    };
+
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved_stdout < 0 || null_fd < 0) {
+        return 0;
+    }
+    dup2(null_fd, STDOUT_FILENO);
+
+    double best_us = ei_bench_best_us(BENCH_ROUNDS, [&]() {
+        unlink(sample_path);
+        return blocks ?
+            ei_sampler_start_sampling(&payload, BENCH_AXES * sizeof(float)) :
+            capture_words(&payload, samples_required);
+    });
+
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    close(null_fd);
+
+    return best_us;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    if (!mkdtemp(sd_dir)) {
+        printf("Failed to create %s\n", sd_dir);
+        return 1;
+    }
+    ei_host_set_sd_dir(sd_dir);
+
+    const ei_sampler_sensor_t sensor = { &sensor_start, &sensor_read_data, &sensor_stop };
+    ei_sampler_set_sensor(&sensor);
+    snprintf(sample_path, sizeof(sample_path), "%s/sample.bin", sd_dir);
+
+    ei_config_t *config = ei_config_get_config();
+    config->sample_interval_ms = BENCH_INTERVAL_MS;
+    config->sample_length_ms = BENCH_LENGTH_MS;
+    strcpy(config->sample_label, "bench");
+    strcpy(config->sample_hmac_key, BENCH_HMAC_KEY);
+    uint32_t samples_required = BENCH_LENGTH_MS / BENCH_INTERVAL_MS;
+
+    double words_us = bench(false, samples_required);
+    size_t words_size = read_sample_file(file_words);
+    double blocks_us = bench(true, samples_required);
+    size_t blocks_size = read_sample_file(file_blocks);
+
+    bool identical = words_size > 0 && words_size == blocks_size &&
+        memcmp(file_words, file_blocks, words_size) == 0;
+
+    printf("sample capture to SD, %d s, %d axes at %d ms (%d samples), %d byte file\n",
+        BENCH_LENGTH_MS / 1000, BENCH_AXES, BENCH_INTERVAL_MS, (int)samples_required, (int)blocks_size);
+    if (words_us == 0 || blocks_us == 0) {
+        printf("ERR: capture failed\n");
+    }
+    else {
+        printf("  4-byte words     %8.2f ms  %8.1f MB/s\n", words_us / 1e3, words_size / words_us);
+        printf("  block buffer     %8.2f ms  %8.1f MB/s\n", blocks_us / 1e3, blocks_size / blocks_us);
+        printf("  speedup %.2fx, files %s\n", words_us / blocks_us, identical ? "identical" : "DIFFER");
+    }
+
+    const char *files[] = { "sample.bin", "config.bin" };
+    for (size_t ix = 0; ix < sizeof(files) / sizeof(files[0]); ix++) {
+        char path[160];
+        snprintf(path, sizeof(path), "%s/%s", sd_dir, files[ix]);
+        unlink(path);
+    }
+    rmdir(sd_dir);
+
+    return (identical && words_us > 0 && blocks_us > 0) ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * CBOR encoding time per 3-axis sample, HMAC-SHA256 signing included:
+ * sensor_aq_add_data, which encodes the floats by hand into a batch that is
+ * signed and written when the buffer fills up, against the per-sample QCBOR
+ * encode, sign and write it replaced. Mostly accelerometer values, with some
+ * values that fit half precision, zeros, infinities, NaN and subnormals.
+ * Also checks both streams, signature included, are the same bytes.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sensor_aq.h"
+#include "sensor_aq_mbedtls_hs256.h"
+#include "qcbor.h"
+#include "ei_host_bench.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define BENCH_SAMPLES       200000
+#define BENCH_AXES          3
+#define BENCH_ROUNDS        5
+#define BENCH_HMAC_KEY      "0123456789abcdef0123456789abcdef"
+#define BENCH_STREAM_SIZE   (BENCH_SAMPLES * BENCH_AXES * 5 + BENCH_SAMPLES + 4096)
+
+/* Private types ----------------------------------------------------------- */
+typedef struct {
+    uint8_t *data;
+    size_t pos;
+    size_t len;
+} bench_stream_t;
+
+/* Private variables ------------------------------------------------------- */
+static float samples[BENCH_SAMPLES][BENCH_AXES];
+static uint8_t stream_batched[BENCH_STREAM_SIZE];
+static uint8_t stream_reference[BENCH_STREAM_SIZE];
+static unsigned char aq_buffer[1024];
+static bench_stream_t *active_stream;
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief In-memory stream, seeks back to the start for the signature
+ */
+static size_t stream_write(const void *ptr, size_t size, size_t count, FILE *)
+{
+    memcpy(active_stream->data + active_stream->pos, ptr, size * count);
+    active_stream->pos += size * count;
+    if (active_stream->pos > active_stream->len) {
+        active_stream->len = active_stream->pos;
+    }
+    return count;
+}
+
+static int stream_seek(FILE *, long int offset, int origin)
+{
+    if (origin == SEEK_SET) {
+        active_stream->pos = offset;
+    }
+    return 0;
+}
+
+/**
+ * @brief sensor_aq_add_data from before the batched encoder
+ */
+static int add_data_reference(sensor_aq_ctx *ctx, float values[], size_t values_size)
+{
+    memset(ctx->cbor_buffer.ptr, 0, ctx->cbor_buffer.len);
+    QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
+
+    QCBOREncode_OpenArray(&ctx->encode_context);
+    for (size_t ix = 0; ix < values_size; ix++) {
+        QCBOREncode_AddDouble(&ctx->encode_context, values[ix]);
+    }
+    QCBOREncode_CloseArray(&ctx->encode_context);
+
+    UsefulBufC encoded;
+    QCBORError res = QCBOREncode_Finish(&ctx->encode_context, &encoded);
+    if (res != QCBOR_SUCCESS) {
+        return res;
+    }
+
+    int err = ctx->signature_ctx->update(ctx->signature_ctx, (const uint8_t*)encoded.ptr, encoded.len);
+    if (err != 0) {
+        return err;
+    }
+    if (ctx->fwrite(encoded.ptr, 1, encoded.len, ctx->stream) != encoded.len) {
+        return AQ_STREAM_WRITE_FAILED;
+    }
+    memset((void*)encoded.ptr, 0, encoded.len);
+
+    QCBOREncode_Init(&ctx->encode_context, ctx->cbor_buffer);
+    return AQ_OK;
+}
+
+/**
+ * @brief Encode all samples into stream, best time per sample over BENCH_ROUNDS
+ *        rounds. A round includes the header and the signature, which take
+ *        microseconds next to the samples.
+ */
+static double bench(bool batched, bench_stream_t *stream)
+{
+    sensor_aq_payload_info payload = { "bench", "bench", 16,
+        { { "accX", "m/s2" }, { "accY", "m/s2" }, { "accZ", "m/s2" } } };
+
+    active_stream = stream;
+
+    double best_us = ei_bench_best_us(BENCH_ROUNDS, [&]() {
+        sensor_aq_signing_ctx_t signing_ctx;
+        sensor_aq_mbedtls_hs256_ctx_t hs_ctx;
+        sensor_aq_ctx ctx = { { aq_buffer, sizeof(aq_buffer) }, &signing_ctx, &stream_write, &stream_seek, NULL };
+
+        stream->pos = 0;
+        stream->len = 0;
+        sensor_aq_init_mbedtls_hs256_context(&signing_ctx, &hs_ctx, BENCH_HMAC_KEY);
+        if (sensor_aq_init(&ctx, &payload, (FILE*)stream, false) != AQ_OK) {
+            printf("ERR: sensor_aq_init failed\n");
+            return false;
+        }
+
+        int ret = AQ_OK;
+        for (int ix = 0; ix < BENCH_SAMPLES && ret == AQ_OK; ix++) {
+            ret = batched ?
+                sensor_aq_add_data(&ctx, samples[ix], BENCH_AXES) :
+                add_data_reference(&ctx, samples[ix], BENCH_AXES);
+        }
+        if (ret == AQ_OK && batched) {
+            ret = sensor_aq_flush(&ctx);
+        }
+        if (ret != AQ_OK || sensor_aq_finish(&ctx) != AQ_OK) {
+            printf("ERR: encoding failed (%d)\n", ret);
+            return false;
+        }
+        return true;
+    });
+
+    return best_us / BENCH_SAMPLES;
+}
+
+/**
+ * @brief Random m/s2 values, 1 in 20 fits half precision, 1 in 20 is special
+ */
+static void make_samples(void)
+{
+    const float special[] = { 0.f, -0.f, INFINITY, -INFINITY, NAN, 1e-40f, -1e-42f,
+        65504.f, 65520.f, 6.1035156e-05f, 3e38f };
+
+    srand(1);
+    for (int ix = 0; ix < BENCH_SAMPLES; ix++) {
+        for (int ax = 0; ax < BENCH_AXES; ax++) {
+            int kind = rand() % 20;
+            if (kind == 0) {
+                samples[ix][ax] = (float)(rand() % 64) / 4.f;
+            }
+            else if (kind == 1) {
+                samples[ix][ax] = special[rand() % (sizeof(special) / sizeof(special[0]))];
+            }
+            else {
+                samples[ix][ax] = ((rand() / (float)RAND_MAX) - 0.5f) * 40.f;
+            }
+        }
+    }
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    bench_stream_t batched = { stream_batched, 0, 0 };
+    bench_stream_t reference = { stream_reference, 0, 0 };
+
+    make_samples();
+
+    double reference_us = bench(false, &reference);
+    double batched_us = bench(true, &batched);
+    if (reference_us == 0 || batched_us == 0) {
+        return 1;
+    }
+
+    bool identical = batched.len == reference.len &&
+        memcmp(stream_batched, stream_reference, batched.len) == 0;
+
+    printf("sensor_aq, %d samples x %d axes, HMAC-SHA256\n", BENCH_SAMPLES, BENCH_AXES);
+    printf("  per sample QCBOR  %8.1f ns/sample\n", reference_us * 1e3);
+    printf("  batched encoder   %8.1f ns/sample\n", batched_us * 1e3);
+    printf("  speedup %.2fx, %d bytes, streams %s\n", reference_us / batched_us,
+        (int)batched.len, identical ? "identical" : "DIFFER");
+
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Spectral analysis windows per second: the precompiled plan
+ * (extract_spectral_analysis_features) against the per-window path it
+ * replaced, which copied the config, parsed the spectral edges, allocated the
+ * buffers and set up the filter and FFT on every window
+ * (spectral::feature::spectral_analysis). Also checks both give the same
+ * features.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <math.h>
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "ei_host_bench.h"
+
+using namespace ei;
+
+/* Constant defines -------------------------------------------------------- */
+#define BENCH_WINDOWS       20000
+#define BENCH_ROUNDS        5
+
+/* Private variables ------------------------------------------------------- */
+static float window[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
+static float features_plan[EI_CLASSIFIER_NN_INPUT_FRAME_SIZE];
+static float features_ref[EI_CLASSIFIER_NN_INPUT_FRAME_SIZE];
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief The per-window spectral analysis from before the plan
+ */
+static int extract_spectral_analysis_reference(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency)
+{
+    ei_dsp_config_spectral_analysis_t config = *((ei_dsp_config_spectral_analysis_t*)config_ptr);
+
+    matrix_t input_matrix(signal->total_length / config.axes, config.axes);
+    if (!input_matrix.buffer) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+    signal->get_data(0, signal->total_length, input_matrix.buffer);
+
+    int ret = numpy::scale(&input_matrix, config.scale_axes);
+    if (ret != EIDSP_OK) {
+        EIDSP_ERR(ret);
+    }
+    ret = numpy::transpose(&input_matrix);
+    if (ret != EIDSP_OK) {
+        EIDSP_ERR(ret);
+    }
+
+    matrix_t edges_matrix_in(64, 1);
+    size_t edge_matrix_ix = 0;
+    const char *spectral_ptr = config.spectral_power_edges;
+    while (spectral_ptr != NULL) {
+        while ((*spectral_ptr) == ' ') {
+            spectral_ptr++;
+        }
+        edges_matrix_in.buffer[edge_matrix_ix++] = atof(spectral_ptr);
+        while ((*spectral_ptr != ',') && (*spectral_ptr != '\0')) {
+            spectral_ptr++;
+        }
+        spectral_ptr = (*spectral_ptr == '\0') ? NULL : spectral_ptr + 1;
+    }
+    edges_matrix_in.rows = edge_matrix_ix;
+
+    size_t output_matrix_cols = spectral::feature::calculate_spectral_buffer_size(
+        true, config.spectral_peaks_count, edges_matrix_in.rows);
+    output_matrix->cols = output_matrix_cols;
+    output_matrix->rows = config.axes;
+
+    spectral::filter_t filter_type = spectral::filter_none;
+    if (strcmp(config.filter_type, "low") == 0) {
+        filter_type = spectral::filter_lowpass;
+    }
+    else if (strcmp(config.filter_type, "high") == 0) {
+        filter_type = spectral::filter_highpass;
+    }
+
+    return spectral::feature::spectral_analysis(output_matrix, &input_matrix,
+        frequency, filter_type, config.filter_cutoff, config.filter_order,
+        config.fft_length, config.spectral_peaks_count, config.spectral_peaks_threshold, &edges_matrix_in);
+}
+
+/**
+ * @brief Best time per window over BENCH_ROUNDS rounds
+ */
+static double bench(bool plan, signal_t *signal, void *config)
+{
+    double best_us = ei_bench_best_us(BENCH_ROUNDS, [&]() {
+        for (int ix = 0; ix < BENCH_WINDOWS; ix++) {
+            int ret;
+            if (plan) {
+                matrix_t features(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE, features_plan);
+                ret = extract_spectral_analysis_features(signal, &features, config, EI_CLASSIFIER_FREQUENCY);
+            }
+            else {
+                matrix_t features(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE, features_ref);
+                ret = extract_spectral_analysis_reference(signal, &features, config, EI_CLASSIFIER_FREQUENCY);
+            }
+            if (ret != EIDSP_OK) {
+                printf("ERR: spectral analysis failed (%d)\n", ret);
+                return false;
+            }
+        }
+        return true;
+    });
+
+    return best_us / BENCH_WINDOWS;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    if (ei_dsp_blocks[0].extract_fn != static_cast<int (*)(signal_t *, matrix_t *, void *, const float)>(&extract_spectral_analysis_features)) {
+        printf("The model's first DSP block is not spectral analysis\n");
+        return 1;
+    }
+    void *config = ei_dsp_blocks[0].config;
+
+    for (size_t ix = 0; ix < EI_CLASSIFIER_RAW_SAMPLE_COUNT; ix++) {
+        window[ix * 3] = 3.0f * sinf(ix * 0.3f);
+        window[ix * 3 + 1] = cosf(ix * 0.7f);
+        window[ix * 3 + 2] = 9.8f + 0.1f * sinf(ix * 1.3f);
+    }
+
+    signal_t signal;
+    numpy::signal_from_buffer(window, EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, &signal);
+
+    double ref_us = bench(false, &signal, config);
+    double plan_us = bench(true, &signal, config);
+    if (ref_us == 0 || plan_us == 0) {
+        return 1;
+    }
+
+    float max_error = 0;
+    for (size_t ix = 0; ix < EI_CLASSIFIER_NN_INPUT_FRAME_SIZE; ix++) {
+        float error = fabsf(features_plan[ix] - features_ref[ix]);
+        if (error > max_error) {
+            max_error = error;
+        }
+    }
+
+    printf("spectral analysis, %d features per window\n", EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+    printf("  per window setup  %8.2f us/window  %8.0f windows/s\n", ref_us, 1e6 / ref_us);
+    printf("  precompiled plan  %8.2f us/window  %8.0f windows/s\n", plan_us, 1e6 / plan_us);
+    printf("  speedup %.2fx, max feature difference %g\n", ref_us / plan_us, max_error);
+
+    return 0;
+}
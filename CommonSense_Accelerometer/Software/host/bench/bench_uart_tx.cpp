@@ -0,0 +1,190 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Time the inference loop is held up by printing the prediction block, with
+ * the console transmit buffer (uart_tx.h) and with the per-character write it
+ * replaced, both against a simulated 115200 baud UART with a 32 byte FIFO.
+ * Also checks the buffered path sends every byte, in order.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "ei_host_bench.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define SIM_UART_BYTES_PER_S    11520.0     /* 115200 baud, 8N1 */
+#define SIM_UART_FIFO_SIZE      32
+#define BENCH_SLICES            10
+#define BENCH_SLICE_WAIT_NS     100000000   /* sampling the next slice */
+#define BENCH_CAPTURE_SIZE      (16 * 1024)
+
+/* Private variables ------------------------------------------------------- */
+static pthread_mutex_t sim_uart_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t critical_section_lock = PTHREAD_MUTEX_INITIALIZER;
+static double sim_uart_done_s = 0;          /* when the last queued byte has left */
+static char sim_uart_capture[BENCH_CAPTURE_SIZE];
+static size_t sim_uart_sent = 0;
+static char expected[BENCH_CAPTURE_SIZE];
+static size_t expected_len = 0;
+
+/* Private functions ------------------------------------------------------- */
+
+static double now_s(void)
+{
+    return ei_bench_now_us() / 1e6;
+}
+
+/**
+ * @brief Bytes still in the simulated FIFO (including the one being sent)
+ */
+static double sim_uart_pending(void)
+{
+    pthread_mutex_lock(&sim_uart_lock);
+    double pending = (sim_uart_done_s - now_s()) * SIM_UART_BYTES_PER_S;
+    pthread_mutex_unlock(&sim_uart_lock);
+    return pending;
+}
+
+static void sim_uart_put(char byte)
+{
+    pthread_mutex_lock(&sim_uart_lock);
+    double now = now_s();
+    sim_uart_done_s = (sim_uart_done_s > now ? sim_uart_done_s : now) + 1.0 / SIM_UART_BYTES_PER_S;
+    if (sim_uart_sent < BENCH_CAPTURE_SIZE) {
+        sim_uart_capture[sim_uart_sent] = byte;
+    }
+    sim_uart_sent++;
+    pthread_mutex_unlock(&sim_uart_lock);
+}
+
+typedef int irqstate_t;
+
+static irqstate_t enter_critical_section(void)
+{
+    pthread_mutex_lock(&critical_section_lock);
+    return 0;
+}
+
+static void leave_critical_section(irqstate_t flags)
+{
+    (void)flags;
+    pthread_mutex_unlock(&critical_section_lock);
+}
+
+#define UART_TX_FIFO_FULL()     (sim_uart_pending() > SIM_UART_FIFO_SIZE - 1)
+#define UART_TX_BUSY()          (sim_uart_pending() > 0)
+#define UART_TX_PUT(byte)       sim_uart_put(byte)
+#include "../../uart_tx.h"
+
+/**
+ * @brief The per-character write from main.cpp
+ */
+void spresense_putchar(char byte)
+{
+    while (UART_TX_FIFO_FULL());
+    UART_TX_PUT(byte);
+}
+
+static void print_line(bool buffered, const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (expected_len + length <= BENCH_CAPTURE_SIZE) {
+        memcpy(&expected[expected_len], buffer, length);
+    }
+    expected_len += length;
+
+    if (buffered) {
+        spresense_writeBuffered(buffer, length);
+    }
+    else {
+        for (int ix = 0; ix < length; ix++) {
+            spresense_putchar(buffer[ix]);
+        }
+    }
+}
+
+/**
+ * @brief Print the prediction block once per slice, wait for the next slice
+ *
+ * @return true if the UART got every byte, in order
+ */
+static bool bench(bool buffered, const char *name)
+{
+    double total_s = 0;
+    double worst_s = 0;
+    int lines = 0;
+
+    sim_uart_sent = 0;
+    expected_len = 0;
+
+    for (int slice = 0; slice < BENCH_SLICES; slice++) {
+        double start_s = now_s();
+        print_line(buffered, "Predictions (DSP: %d ms., Classification: %d ms., Anomaly: %d ms.): \n", 12, 1, 0);
+        print_line(buffered, "    %s: \t%f\r\n", "idle", 0.99609f);
+        print_line(buffered, "    %s: \t%f\r\n", "vibration", 0.00391f);
+        print_line(buffered, "    anomaly score: %f\r\n", -0.3f);
+        double slice_s = now_s() - start_s;
+
+        total_s += slice_s;
+        lines += 4;
+        if (slice_s > worst_s) {
+            worst_s = slice_s;
+        }
+
+        struct timespec wait = { 0, BENCH_SLICE_WAIT_NS };
+        nanosleep(&wait, NULL);
+    }
+
+    spresense_flushTx();
+
+    bool complete = sim_uart_sent == expected_len && memcmp(sim_uart_capture, expected, expected_len) == 0;
+    printf("  %-18s %8.1f us per line  %8.1f us worst slice  %d bytes %s\n", name,
+        total_s / lines * 1e6, worst_s * 1e6, (int)sim_uart_sent, complete ? "sent in order" : "LOST OR REORDERED");
+
+    return complete;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    printf("console output at 115200 baud, time the caller is blocked\n");
+
+    bool complete = bench(false, "per-character");
+
+    start_uart_tx();
+    complete &= bench(true, "transmit buffer");
+
+    return complete ? 0 : 1;
+}
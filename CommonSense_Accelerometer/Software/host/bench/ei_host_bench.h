@@ -0,0 +1,74 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Timing for the benchmarks in host/bench. Each benchmark is its own program,
+ * it times a round of work a few times and keeps the best round, so a round
+ * the host scheduler interrupted doesn't count.
+ */
+
+#ifndef EI_HOST_BENCH_H
+#define EI_HOST_BENCH_H
+
+/* Include ----------------------------------------------------------------- */
+#include <time.h>
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief Monotonic time in us
+ */
+static inline double ei_bench_now_us(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Time round() rounds times
+ *
+ * @param rounds  Number of rounds
+ * @param round   One round of work, returns false on an error
+ *
+ * @return Time of the best round in us, 0 if a round failed
+ */
+template<typename F>
+static inline double ei_bench_best_us(int rounds, F round)
+{
+    double best_us = 0;
+
+    for (int ix = 0; ix < rounds; ix++) {
+        double start_us = ei_bench_now_us();
+        if (!round()) {
+            return 0;
+        }
+        double elapsed_us = ei_bench_now_us() - start_us;
+        if (ix == 0 || elapsed_us < best_us) {
+            best_us = elapsed_us;
+        }
+    }
+
+    return best_us;
+}
+
+#endif
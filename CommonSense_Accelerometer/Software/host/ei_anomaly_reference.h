@@ -0,0 +1,103 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * The brute force anomaly scorer and random clusters, for
+ * host/test/test_anomaly_soa.cpp and host/bench/bench_anomaly_scaling.cpp.
+ * Clusters are cluster_count rows of axis_size centroid values followed by
+ * max_error.
+ */
+
+#ifndef EI_ANOMALY_REFERENCE_H
+#define EI_ANOMALY_REFERENCE_H
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+/* Private variables ------------------------------------------------------- */
+static uint32_t ei_anomaly_rng_state = 1;
+
+/* Public functions -------------------------------------------------------- */
+
+static inline float ei_anomaly_uniform(void)
+{
+    ei_anomaly_rng_state = ei_anomaly_rng_state * 1664525u + 1013904223u;
+    return (ei_anomaly_rng_state >> 8) / 16777216.0f;
+}
+
+static inline float ei_anomaly_normal(void)
+{
+    return sqrtf(-2.0f * logf(ei_anomaly_uniform() + 1e-7f)) * cosf(6.2831853f * ei_anomaly_uniform());
+}
+
+/**
+ * @brief The removed calculate_cluster_distance / get_min_distance_to_cluster,
+ *        the distance to every cluster
+ */
+static inline float ei_anomaly_brute_force_min_distance(const float *input, size_t axis_size,
+    const float *clusters, size_t cluster_count)
+{
+    float min = 1000.0f;
+    for (size_t cx = 0; cx < cluster_count; cx++) {
+        const float *centroid = &clusters[cx * (axis_size + 1)];
+        float dist = 0.0f;
+        for (size_t ix = 0; ix < axis_size; ix++) {
+            dist += pow(input[ix] - centroid[ix], 2);
+        }
+        dist = sqrt(dist) - centroid[axis_size];
+        if (dist < min) {
+            min = dist;
+        }
+    }
+    return min;
+}
+
+/**
+ * @brief Random centroids around 0, max_error between 0.05 and 0.8
+ */
+static inline void ei_anomaly_random_clusters(float *clusters, size_t cluster_count, size_t axis_size)
+{
+    for (size_t cx = 0; cx < cluster_count; cx++) {
+        for (size_t ax = 0; ax < axis_size; ax++) {
+            clusters[cx * (axis_size + 1) + ax] = ei_anomaly_normal() * 2.0f;
+        }
+        clusters[cx * (axis_size + 1) + axis_size] = 0.05f + 0.75f * ei_anomaly_uniform();
+    }
+}
+
+/**
+ * @brief Random input around a random cluster, near it (most clusters get
+ *        pruned) or further out
+ */
+static inline void ei_anomaly_random_input(float *input, const float *clusters, size_t cluster_count,
+    size_t axis_size, bool near)
+{
+    const float *centroid = &clusters[(ei_anomaly_rng_state % cluster_count) * (axis_size + 1)];
+    float spread = (near ? 0.3f : 3.0f) / sqrtf((float)axis_size);
+    for (size_t ax = 0; ax < axis_size; ax++) {
+        input[ax] = centroid[ax] + ei_anomaly_normal() * spread;
+    }
+}
+
+#endif
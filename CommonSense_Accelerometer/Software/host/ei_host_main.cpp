@@ -0,0 +1,137 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Host replacement for main.cpp: the console is stdin/stdout, the SD card is a
+ * directory and the sensors replay files (see ei_sim_sensors.cpp). The rest of
+ * the platform layer is in ei_host_port.cpp, so the host tests can link it
+ * without this main.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "ei_device_sony_spresense.h"
+#include "ei_host_port.h"
+#include "ei_sim_sensors.h"
+
+/* Extern reference -------------------------------------------------------- */
+extern int ei_main();
+
+/* Private variables ------------------------------------------------------- */
+static struct termios console_saved;
+static bool console_raw = false;
+
+/* Private functions ------------------------------------------------------- */
+
+static void console_restore(void)
+{
+    if (console_raw) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &console_saved);
+    }
+}
+
+/**
+ * @brief      Make the terminal behave like the UART: no line editing, no echo
+ *             (the REPL echoes), Enter sends '\r'. Reads never block.
+ */
+static void console_setup(void)
+{
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &console_saved) == 0) {
+        struct termios raw = console_saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_iflag &= ~(ICRNL);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0) {
+            console_raw = true;
+            atexit(console_restore);
+        }
+    }
+
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+}
+
+static void print_usage(const char *name)
+{
+    printf("Usage: %s [options]\n"
+        "  --kx126 FILE       Replay FILE on the KX126 accelerometer (accX,accY,accZ in m/s2)\n"
+        "  --lsm6dso32 FILE   Replay FILE on the LSM6DSO32 (acc in m/s2, gyr in dps)\n"
+        "  --sgp40 FILE       Replay FILE on the SGP40 (raw VOC ticks)\n"
+        "  --sd DIR           Directory used as SD card (default: .)\n"
+        "  --id ID            Device ID (default: host)\n"
+        "FILE is CSV, optionally with a header and a timestamp column in ms, or\n"
+        "an Edge Impulse CBOR data acquisition file.\n", name);
+}
+
+/**
+ * @brief Load the sensor files and run the application
+ */
+int main(int argc, char **argv)
+{
+    const char *device_id = "host";
+    static const struct { const char *option; ei_sim_sensor_t sensor; } sensor_options[] = {
+        { "--kx126", EI_SIM_KX126 },
+        { "--lsm6dso32", EI_SIM_LSM6DSO32 },
+        { "--sgp40", EI_SIM_SGP40 },
+    };
+
+    for (int i = 1; i < argc; i++) {
+        bool handled = false;
+
+        if (i + 1 < argc) {
+            for (size_t s = 0; s < sizeof(sensor_options) / sizeof(sensor_options[0]); s++) {
+                if (strcmp(argv[i], sensor_options[s].option) == 0) {
+                    if (!ei_sim_load(sensor_options[s].sensor, argv[i + 1])) {
+                        return 1;
+                    }
+                    handled = true;
+                }
+            }
+            if (strcmp(argv[i], "--sd") == 0) {
+                ei_host_set_sd_dir(argv[i + 1]);
+                handled = true;
+            }
+            else if (strcmp(argv[i], "--id") == 0) {
+                device_id = argv[i + 1];
+                handled = true;
+            }
+        }
+
+        if (!handled) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    console_setup();
+
+    EiDevice.set_id((char *)device_id);
+
+    return ei_main();
+}
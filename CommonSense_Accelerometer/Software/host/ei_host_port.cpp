@@ -0,0 +1,434 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Host platform layer, what main.cpp and the Spresense drivers provide on the
+ * board: console on stdin/stdout, sample timer thread, SD card directory and
+ * no camera or microphone.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "ei_device_sony_spresense.h"
+#include "firmware-sdk/ei_camera_interface.h"
+#include "ei_host_port.h"
+#include "ei_sim_sensors.h"
+
+/* Forward declarations ---------------------------------------------------- */
+void spresense_stopSampleTimer(void);
+
+/* Constant defines -------------------------------------------------------- */
+#define SD_PATH_MAX     512
+
+/* Private variables ------------------------------------------------------- */
+static const char *sd_dir = ".";
+static FILE *sd_file = NULL;
+
+static uint32_t tx_dropped = 0;
+
+#if !defined(EI_INERTIAL_SIMULATED_CLOCK) || (EI_INERTIAL_SIMULATED_CLOCK == 0)
+/* Sample timer variables */
+static pthread_t sample_timer_pid;
+static bool sample_timer_running = false;
+static sem_t sample_timer_sem;
+static uint32_t sample_timer_interval_us;
+static void (* volatile sample_timer_tick)(void) = NULL;
+#endif
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief Use dir as the SD card
+ */
+void ei_host_set_sd_dir(const char *dir)
+{
+    sd_dir = dir;
+}
+
+/**
+ * @brief Get current time
+ *
+ * @param sec
+ * @param nano
+ */
+extern "C" void spresense_time_cb(uint32_t *sec, uint32_t *nano)
+{
+    struct timespec cur_time;
+    clock_gettime(CLOCK_MONOTONIC, &cur_time);
+    *(sec) = cur_time.tv_sec;
+    *(nano)= cur_time.tv_nsec;
+}
+
+/**
+ * @brief Get a char from stdin, waits a little when there is none so an idle
+ * REPL doesn't spin
+ *
+ * @return char, 0 if none
+ */
+char spresense_getchar(void)
+{
+    static char last = 0;
+    char byte;
+
+    if (read(STDIN_FILENO, &byte, 1) != 1) {
+        usleep(1000);
+        return 0;
+    }
+
+    /* The REPL runs commands on '\r' and ignores '\n', so a line from a pipe
+     * ends on '\n' only, '\r\n' must not run it twice */
+    if (byte == '\n') {
+        byte = last == '\r' ? 0 : '\r';
+    }
+    last = byte;
+
+    return byte;
+}
+
+/**
+ * @brief Get a byte from stdin, binary safe
+ *
+ * @return int received byte, -1 if there is none
+ */
+int spresense_getbyte(void)
+{
+    uint8_t byte;
+
+    if (read(STDIN_FILENO, &byte, 1) != 1) {
+        return -1;
+    }
+
+    return byte;
+}
+
+void spresense_putchar(char byte)
+{
+    if (write(STDOUT_FILENO, &byte, 1) != 1) {
+        tx_dropped++;
+    }
+}
+
+/**
+ * @brief Write to stdout, the terminal buffers so nothing is ever dropped
+ *
+ * @return number of bytes written
+ */
+uint32_t spresense_writeBuffered(const char *data, uint32_t length)
+{
+    uint32_t written = 0;
+
+    while (written < length) {
+        ssize_t n = write(STDOUT_FILENO, &data[written], length - written);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                struct pollfd pfd = { STDOUT_FILENO, POLLOUT, 0 };
+                poll(&pfd, 1, 10);
+                continue;
+            }
+            tx_dropped += length - written;
+            break;
+        }
+        written += (uint32_t)n;
+    }
+
+    return written;
+}
+
+void spresense_flushTx(void)
+{
+    fflush(stdout);
+}
+
+void spresense_setTxDropWhenFull(bool drop)
+{
+    (void)drop;
+}
+
+uint32_t spresense_getTxDropped(void)
+{
+    return tx_dropped;
+}
+
+extern "C" void spresense_ledcontrol(tEiLeds led, bool on_off)
+{
+    (void)led;
+    (void)on_off;
+}
+
+extern "C" void cxd56_setbaud(uintptr_t uartbase, uint32_t basefreq, uint32_t baud)
+{
+    (void)uartbase;
+    (void)basefreq;
+    (void)baud;
+}
+
+void set_max_data_output_baudrate_c()
+{
+    spresense_flushTx();
+}
+
+void set_default_data_output_baudrate_c()
+{
+    spresense_flushTx();
+}
+
+#if !defined(EI_INERTIAL_SIMULATED_CLOCK) || (EI_INERTIAL_SIMULATED_CLOCK == 0)
+/**
+ * @brief Sample timer thread, ticks on an absolute schedule so the period
+ * doesn't drift with the time spent in the sensor read
+ */
+static void *sample_timer_daemon(void *arg)
+{
+    struct timespec next;
+    int sem_value;
+
+    (void)arg;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (sample_timer_tick) {
+        next.tv_nsec += (long)sample_timer_interval_us * 1000L;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+
+        void (*tick)(void) = sample_timer_tick;
+        if (tick) {
+            tick();
+        }
+
+        /* Wake the reader, but don't let the count run away while it is busy */
+        if ((sem_getvalue(&sample_timer_sem, &sem_value) == 0) && (sem_value <= 0)) {
+            sem_post(&sample_timer_sem);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start calling tick every interval_us from the sample timer thread
+ *
+ * @param interval_us sample period in microseconds
+ * @param tick called from the sample timer thread
+ * @return true success
+ */
+bool spresense_startSampleTimer(uint32_t interval_us, void (*tick)(void))
+{
+    static bool sem_ready = false;
+
+    if (!sem_ready) {
+        sem_init(&sample_timer_sem, 0, 0);
+        sem_ready = true;
+    }
+
+    spresense_stopSampleTimer();
+    while (sem_trywait(&sample_timer_sem) == 0);
+
+    sample_timer_interval_us = interval_us;
+    sample_timer_tick = tick;
+
+    if (pthread_create(&sample_timer_pid, NULL, sample_timer_daemon, NULL) != 0) {
+        sample_timer_tick = NULL;
+        return false;
+    }
+    sample_timer_running = true;
+
+    return true;
+}
+
+/**
+ * @brief Stop the sample timer and wait for its thread to finish
+ */
+void spresense_stopSampleTimer(void)
+{
+    sample_timer_tick = NULL;
+
+    if (sample_timer_running) {
+        pthread_join(sample_timer_pid, NULL);
+        sample_timer_running = false;
+    }
+}
+
+/**
+ * @brief Block until the sample timer thread has handled its next period
+ */
+void spresense_waitSampleTimer(void)
+{
+    while ((sem_wait(&sample_timer_sem) != 0) && (errno == EINTR));
+}
+#endif
+
+/** No camera on the host, snapshots fail at init */
+class EiCameraHost : public EiCamera {
+public:
+    bool ei_camera_capture_rgb888_packed_big_endian(
+        uint8_t *image,
+        uint32_t image_size_B,
+        uint16_t hsize,
+        uint16_t vsize)
+    {
+        return false;
+    }
+
+    uint16_t get_min_width()
+    {
+        return 0;
+    }
+
+    uint16_t get_min_height()
+    {
+        return 0;
+    }
+
+    bool init()
+    {
+        return false;
+    }
+};
+
+EiCamera *EiCamera::get_camera()
+{
+    static EiCameraHost camera;
+    return &camera;
+}
+
+/* No microphone on the host, recording fails and inference gets no audio */
+int spresense_setupAudio(void)
+{
+    return -1;
+}
+
+bool spresense_startStopAudio(bool start)
+{
+    return start == false;
+}
+
+void spresense_pauseAudio(bool pause)
+{
+    (void)pause;
+}
+
+bool spresense_getAudio(char *audio_buffer, unsigned int* size)
+{
+    (void)audio_buffer;
+    *size = 0;
+
+    return false;
+}
+
+/**
+ * @brief Open a file in the SD card directory
+ *
+ * @param name
+ * @param write if true the file is opened for reading and writing, created if
+ *        it doesn't exist. The contents are kept, like on the board, writes
+ *        overwrite them from the current position
+ * @return true success
+ */
+extern "C" bool spresense_openFile(const char *name, bool write)
+{
+    char path[SD_PATH_MAX];
+
+    if (sd_file) {
+        fclose(sd_file);
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", sd_dir, name);
+    /* Like the board, opening for write keeps the contents */
+    if (write == true) {
+        sd_file = fopen(path, "r+b");
+        if (sd_file == NULL) {
+            sd_file = fopen(path, "w+b");
+        }
+    }
+    else {
+        sd_file = fopen(path, "rb");
+    }
+
+    return sd_file != NULL;
+}
+
+extern "C" bool spresense_seekFile(const char *name, uint32_t position)
+{
+    if (sd_file == NULL) {
+        printf("File %s not open\r\n", name);
+        return false;
+    }
+
+    return fseek(sd_file, position, SEEK_SET) == 0;
+}
+
+extern "C" bool spresense_closeFile(const char *name)
+{
+    if (sd_file == NULL) {
+        printf("File %s not open\r\n", name);
+        return false;
+    }
+
+    fclose(sd_file);
+    sd_file = NULL;
+
+    return true;
+}
+
+extern "C" bool spresense_writeToFile(const char *name, const uint8_t *buf, uint32_t length)
+{
+    if (sd_file == NULL) {
+        printf("File %s not open\r\n", name);
+        return false;
+    }
+
+    return fwrite(buf, 1, length, sd_file) == length;
+}
+
+/**
+ * @brief Read data from an opened file
+ *
+ * @return uint32_t 0 if ok
+ */
+extern "C" uint32_t spresense_readFromFile(const char *name, uint8_t *buf, uint32_t length)
+{
+    if (sd_file == NULL) {
+        printf("File %s not open\r\n", name);
+        return -3;
+    }
+
+    if (fread(buf, 1, length, sd_file) != length) {
+        printf("File invalid length error\r\n");
+        return -1;
+    }
+
+    return 0;
+}
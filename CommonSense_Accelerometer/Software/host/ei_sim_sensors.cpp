@@ -0,0 +1,619 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "ei_sim_sensors.h"
+#include "ei_inertialsensor.h"
+#include "ei_lsm6dso32.h"
+#include "sgp40_i2c.h"
+#include "qcbor.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define CONVERT_G_TO_MS2        9.80665f
+
+/* KX126 sensitivity in the +/-2 g range the driver configures */
+#define KX126_COUNTS_PER_G      16384
+
+/* Most values per sample of any simulated sensor */
+#define SIM_MAX_AXES            6
+
+/* Longest line accepted in a CSV file */
+#define CSV_MAX_LINE            512
+
+/* Hardware buffer depth in samples. KX126: 2 kB of 16 bit x, y, z.
+ * LSM6DSO32: 3 kB of 7 byte words, one accelerometer and one gyroscope word per sample */
+#define KX126_BUFFER_SAMPLES    341
+#define LSM6DSO32_FIFO_SAMPLES  219
+
+/* Returned by the simulated SGP40 when it has no data, like a NACK on the bus */
+#define SGP40_SIM_NO_DEVICE     (-1)
+
+/** Sample buffer of a simulated sensor, filled at odr_hz while running */
+typedef struct {
+    bool running;
+    float odr_hz;
+    uint64_t start_us;
+    uint64_t read_samples;      /* samples consumed since start */
+    uint32_t depth;
+    uint32_t overruns;
+} sim_fifo_t;
+
+/* Private variables ------------------------------------------------------- */
+static ei_sim_data_t sim_data[EI_SIM_N_SENSORS];
+static sim_fifo_t kx126_buffer = { false, 0.f, 0, 0, KX126_BUFFER_SAMPLES, 0 };
+static sim_fifo_t lsm6dso32_fifo = { false, 0.f, 0, 0, LSM6DSO32_FIFO_SAMPLES, 0 };
+
+/** Output data rates of the KX126 and the LSM6DSO32 */
+static const float kx126_odr_table[] = { 12.5f, 25.f, 50.f, 100.f, 200.f, 400.f, 800.f, 1600.f, 3200.f, 6400.f };
+static const float lsm6dso32_odr_table[] = { 12.5f, 26.f, 52.f, 104.f, 208.f, 417.f, 833.f, 1667.f, 3333.f, 6667.f };
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief      Append one row to the sample data, growing the buffer as needed
+ */
+static bool append_row(ei_sim_data_t *data, const float *row, size_t *capacity)
+{
+    if (data->n_samples == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 256;
+        float *values = (float *)realloc(data->values, new_capacity * data->n_axes * sizeof(float));
+        if (values == NULL) {
+            return false;
+        }
+        data->values = values;
+        *capacity = new_capacity;
+    }
+
+    memcpy(&data->values[data->n_samples * data->n_axes], row, data->n_axes * sizeof(float));
+    data->n_samples++;
+
+    return true;
+}
+
+/**
+ * @brief      Load a CSV file. An optional header line is skipped; when it
+ *             starts with "timestamp", or rows have one column more than the
+ *             sensor has axes, the first column is a timestamp in ms.
+ */
+static bool load_csv(ei_sim_data_t *data, FILE *file)
+{
+    char line[CSV_MAX_LINE];
+    float row[SIM_MAX_AXES + 1];
+    size_t capacity = 0;
+    bool first_line = true;
+    int has_timestamp = -1;
+    double first_ts = 0., last_ts = 0.;
+
+    while (fgets(line, sizeof(line), file)) {
+        char *p = line;
+
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        if (first_line) {
+            first_line = false;
+            if (!isdigit((unsigned char)*p) && *p != '-' && *p != '+' && *p != '.') {
+                has_timestamp = strncasecmp(p, "timestamp", 9) == 0;
+                continue;
+            }
+        }
+
+        size_t columns = 0;
+        double ts = 0.;
+        while (*p && columns <= data->n_axes) {
+            char *end;
+            double value = strtod(p, &end);
+            if (end == p) {
+                ei_printf("ERR: Invalid CSV value: %s", line);
+                return false;
+            }
+            row[columns++] = (float)value;
+            if (columns == 1) {
+                ts = value;
+            }
+            p = end;
+            while (isspace((unsigned char)*p) || *p == ',' || *p == ';') {
+                p++;
+            }
+        }
+
+        if (has_timestamp < 0) {
+            has_timestamp = columns == data->n_axes + 1;
+        }
+        if (columns != data->n_axes + (has_timestamp ? 1 : 0)) {
+            ei_printf("ERR: Expected %u values per CSV row\r\n",
+                (unsigned)(data->n_axes + (has_timestamp ? 1 : 0)));
+            return false;
+        }
+
+        if (has_timestamp) {
+            if (data->n_samples == 0) {
+                first_ts = ts;
+            }
+            last_ts = ts;
+        }
+
+        if (!append_row(data, has_timestamp ? &row[1] : row, &capacity)) {
+            return false;
+        }
+    }
+
+    if (has_timestamp && data->n_samples > 1) {
+        data->interval_ms = (float)((last_ts - first_ts) / (data->n_samples - 1));
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Compare a CBOR text label with a C string
+ */
+static bool label_is(const QCBORItem *item, const char *label)
+{
+    size_t len = strlen(label);
+
+    return item->uLabelType == QCBOR_TYPE_TEXT_STRING
+        && item->label.string.len == len
+        && memcmp(item->label.string.ptr, label, len) == 0;
+}
+
+/**
+ * @brief      Load the payload of an Edge Impulse data acquisition file, as
+ *             written by this firmware when sampling (signature is not checked)
+ */
+static bool load_cbor(ei_sim_data_t *data, const uint8_t *buffer, size_t length)
+{
+    QCBORDecodeContext ctx;
+    QCBORItem item;
+    float row[SIM_MAX_AXES + 1];
+    size_t capacity = 0;
+    size_t column = 0;
+    int values_level = -1;
+
+    QCBORDecode_Init(&ctx, (UsefulBufC){ buffer, length }, QCBOR_DECODE_MODE_NORMAL);
+
+    while (QCBORDecode_GetNext(&ctx, &item) == QCBOR_SUCCESS) {
+
+        if (values_level < 0) {
+            if (label_is(&item, "interval_ms") && item.uDataType == QCBOR_TYPE_DOUBLE) {
+                data->interval_ms = (float)item.val.dfnum;
+            }
+            else if (label_is(&item, "interval_ms") && item.uDataType == QCBOR_TYPE_INT64) {
+                data->interval_ms = (float)item.val.int64;
+            }
+            else if (label_is(&item, "values") && item.uDataType == QCBOR_TYPE_ARRAY) {
+                values_level = item.uNestingLevel;
+            }
+            continue;
+        }
+
+        /* Rows are arrays one level down, single axis rows may be plain values */
+        bool is_number = item.uDataType == QCBOR_TYPE_DOUBLE || item.uDataType == QCBOR_TYPE_INT64;
+        bool row_done = false;
+
+        if (item.uNestingLevel == values_level + 1) {
+            column = 0;
+            if (is_number) {
+                row[column++] = item.uDataType == QCBOR_TYPE_DOUBLE ? (float)item.val.dfnum : (float)item.val.int64;
+                row_done = true;
+            }
+        }
+        else if (item.uNestingLevel == values_level + 2 && is_number) {
+            if (column < data->n_axes) {
+                row[column] = item.uDataType == QCBOR_TYPE_DOUBLE ? (float)item.val.dfnum : (float)item.val.int64;
+            }
+            column++;
+            row_done = item.uNextNestLevel < item.uNestingLevel;
+        }
+
+        if (row_done) {
+            if (column != data->n_axes) {
+                ei_printf("ERR: Expected %u values per sample\r\n", (unsigned)data->n_axes);
+                return false;
+            }
+            if (!append_row(data, row, &capacity)) {
+                return false;
+            }
+        }
+
+        if (item.uNextNestLevel <= values_level) {
+            return true;
+        }
+    }
+
+    if (values_level < 0) {
+        ei_printf("ERR: No payload values in CBOR file\r\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Samples the hardware buffer collected since the last read. When
+ *             the reader fell behind, the buffer overflowed and the oldest
+ *             samples are lost.
+ */
+static uint32_t sim_fifo_level(sim_fifo_t *fifo, ei_sim_data_t *data)
+{
+    uint64_t produced = ((ei_sim_now_us() - fifo->start_us) * (uint64_t)(fifo->odr_hz * 1000.f)) / 1000000000ULL;
+    uint64_t level = produced - fifo->read_samples;
+
+    if (level > fifo->depth) {
+        uint64_t lost = level - fifo->depth;
+        fifo->overruns++;
+        fifo->read_samples += lost;
+        if (data->n_samples) {
+            data->next = (size_t)((data->next + lost) % data->n_samples);
+        }
+        level = fifo->depth;
+    }
+
+    return (uint32_t)level;
+}
+
+static bool sim_fifo_start(sim_fifo_t *fifo, const float *odr_table, size_t odr_count, float odr_hz)
+{
+    for (size_t i = 0; i < odr_count; i++) {
+        float diff = odr_hz - odr_table[i];
+        if (diff < 0.f) {
+            diff = -diff;
+        }
+        if (diff <= odr_table[i] * 0.001f) {
+            fifo->odr_hz = odr_table[i];
+            fifo->start_us = ei_sim_now_us();
+            fifo->read_samples = 0;
+            fifo->running = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief      Load a CSV or CBOR file to replay, the format follows from the
+ *             first byte (a CBOR map)
+ *
+ * @param      data    Filled with the samples, free with ei_sim_free
+ * @param[in]  path    File to load
+ * @param[in]  n_axes  Values per sample
+ *
+ * @return     false if the file can't be read or doesn't match n_axes
+ */
+bool ei_sim_load_file(ei_sim_data_t *data, const char *path, size_t n_axes)
+{
+    FILE *file = fopen(path, "rb");
+    bool loaded;
+
+    memset(data, 0, sizeof(ei_sim_data_t));
+    data->n_axes = n_axes;
+
+    if (file == NULL) {
+        ei_printf("ERR: Can't open %s\r\n", path);
+        return false;
+    }
+
+    int first = fgetc(file);
+    rewind(file);
+
+    if (first >= 0xA0 && first <= 0xBF) {
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        rewind(file);
+
+        uint8_t *buffer = (uint8_t *)malloc(length);
+        loaded = buffer && fread(buffer, 1, length, file) == (size_t)length
+            && load_cbor(data, buffer, length);
+        free(buffer);
+    }
+    else {
+        loaded = load_csv(data, file);
+    }
+
+    fclose(file);
+
+    if (loaded && data->n_samples == 0) {
+        ei_printf("ERR: No samples in %s\r\n", path);
+        loaded = false;
+    }
+    if (!loaded) {
+        ei_sim_free(data);
+    }
+
+    return loaded;
+}
+
+void ei_sim_free(ei_sim_data_t *data)
+{
+    free(data->values);
+    data->values = NULL;
+    data->n_samples = 0;
+    data->next = 0;
+}
+
+/**
+ * @brief      Next sample to replay, wraps around at the end of the file
+ *
+ * @return     n_axes values, NULL if nothing is loaded
+ */
+const float *ei_sim_next_sample(ei_sim_data_t *data)
+{
+    if (data->n_samples == 0) {
+        return NULL;
+    }
+
+    const float *sample = &data->values[data->next * data->n_axes];
+    data->next = (data->next + 1) % data->n_samples;
+
+    return sample;
+}
+
+/**
+ * @brief      Load the file a simulated sensor replays
+ */
+bool ei_sim_load(ei_sim_sensor_t sensor, const char *path)
+{
+    static const size_t n_axes[EI_SIM_N_SENSORS] = { 3, 6, 1 };
+
+    if (sensor >= EI_SIM_N_SENSORS) {
+        return false;
+    }
+
+    ei_sim_free(&sim_data[sensor]);
+
+    return ei_sim_load_file(&sim_data[sensor], path, n_axes[sensor]);
+}
+
+/**
+ * @brief      Time base of the simulated sensors, follows the simulated
+ *             sample clock when the inertial sampler runs on one
+ */
+uint64_t ei_sim_now_us(void)
+{
+#if defined(EI_INERTIAL_SIMULATED_CLOCK) && (EI_INERTIAL_SIMULATED_CLOCK == 1)
+    return ei_inertial_sim_get_time_us();
+#else
+    return ei_read_timer_us();
+#endif
+}
+
+/* Simulated KX126, same interface as the Spresense main.cpp --------------- */
+
+int spresense_getAcc(float acc_val[3])
+{
+    const float *sample = ei_sim_next_sample(&sim_data[EI_SIM_KX126]);
+
+    if (sample == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        acc_val[i] = sample[i] / CONVERT_G_TO_MS2;
+    }
+
+    return 0;
+}
+
+bool spresense_startAccBuffer(float odr_hz, uint8_t watermark)
+{
+    (void)watermark;
+
+    if (sim_data[EI_SIM_KX126].n_samples == 0) {
+        return false;
+    }
+
+    return sim_fifo_start(&kx126_buffer, kx126_odr_table,
+        sizeof(kx126_odr_table) / sizeof(kx126_odr_table[0]), odr_hz);
+}
+
+int spresense_getAccBuffer(float *acc_val, uint16_t max_samples)
+{
+    uint32_t count = sim_fifo_level(&kx126_buffer, &sim_data[EI_SIM_KX126]);
+
+    if (count > max_samples) {
+        count = max_samples;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (spresense_getAcc(&acc_val[i * 3])) {
+            return -1;
+        }
+    }
+    kx126_buffer.read_samples += count;
+
+    return (int)count;
+}
+
+/* Counts are rounded and clipped to the range like the sensor would */
+int spresense_getAccRaw(int16_t acc_raw[3])
+{
+    float acc_val[3];
+
+    if (spresense_getAcc(acc_val)) {
+        return -1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        long count = lroundf(acc_val[i] * KX126_COUNTS_PER_G);
+        acc_raw[i] = (int16_t)(count > INT16_MAX ? INT16_MAX : count < INT16_MIN ? INT16_MIN : count);
+    }
+
+    return 0;
+}
+
+float spresense_getAccResolution(void)
+{
+    return 1.0f / KX126_COUNTS_PER_G;
+}
+
+int spresense_getAccBufferRaw(int16_t *acc_raw, uint16_t max_samples)
+{
+    uint32_t count = sim_fifo_level(&kx126_buffer, &sim_data[EI_SIM_KX126]);
+
+    if (count > max_samples) {
+        count = max_samples;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (spresense_getAccRaw(&acc_raw[i * 3])) {
+            return -1;
+        }
+    }
+    kx126_buffer.read_samples += count;
+
+    return (int)count;
+}
+
+void spresense_stopAccBuffer(void)
+{
+    kx126_buffer.running = false;
+}
+
+/* Simulated LSM6DSO32, same interface as sensors/ei_lsm6dso32.cpp ---------- */
+
+bool ei_lsm6dso32_init(void)
+{
+    return sim_data[EI_SIM_LSM6DSO32].n_samples > 0;
+}
+
+int ei_lsm6dso32_read(float *data)
+{
+    const float *sample = ei_sim_next_sample(&sim_data[EI_SIM_LSM6DSO32]);
+
+    if (sample == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        data[i] = sample[i] / CONVERT_G_TO_MS2;
+    }
+    for (int i = 3; i < EI_LSM6DSO32_AXES; i++) {
+        data[i] = sample[i];
+    }
+
+    return 0;
+}
+
+bool ei_lsm6dso32_fifo_start(float odr_hz, uint16_t watermark)
+{
+    (void)watermark;
+
+    if (ei_lsm6dso32_init() == false) {
+        return false;
+    }
+
+    return sim_fifo_start(&lsm6dso32_fifo, lsm6dso32_odr_table,
+        sizeof(lsm6dso32_odr_table) / sizeof(lsm6dso32_odr_table[0]), odr_hz);
+}
+
+int ei_lsm6dso32_fifo_read(float *data, uint16_t max_samples)
+{
+    uint32_t count = sim_fifo_level(&lsm6dso32_fifo, &sim_data[EI_SIM_LSM6DSO32]);
+
+    if (count > max_samples) {
+        count = max_samples;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (ei_lsm6dso32_read(&data[i * EI_LSM6DSO32_AXES])) {
+            return -1;
+        }
+    }
+    lsm6dso32_fifo.read_samples += count;
+
+    return (int)count;
+}
+
+void ei_lsm6dso32_fifo_stop(void)
+{
+    lsm6dso32_fifo.running = false;
+}
+
+uint32_t ei_lsm6dso32_get_fifo_overruns(void)
+{
+    return lsm6dso32_fifo.overruns;
+}
+
+/* Simulated SGP40, same interface as libraries/Sgp4x ----------------------- */
+
+int16_t sgp40_measure_raw_signal(uint16_t relative_humidity, uint16_t temperature, uint16_t* sraw_voc)
+{
+    const float *sample = ei_sim_next_sample(&sim_data[EI_SIM_SGP40]);
+
+    (void)relative_humidity;
+    (void)temperature;
+
+    if (sample == NULL) {
+        return SGP40_SIM_NO_DEVICE;
+    }
+
+    float value = sample[0] < 0.f ? 0.f : (sample[0] > 65535.f ? 65535.f : sample[0]);
+    *sraw_voc = (uint16_t)(value + 0.5f);
+
+    return 0;
+}
+
+int16_t sgp40_execute_self_test(uint16_t* test_result)
+{
+    if (sim_data[EI_SIM_SGP40].n_samples == 0) {
+        return SGP40_SIM_NO_DEVICE;
+    }
+
+    *test_result = 0xD400;
+
+    return 0;
+}
+
+int16_t sgp40_turn_heater_off(void)
+{
+    return sim_data[EI_SIM_SGP40].n_samples ? 0 : SGP40_SIM_NO_DEVICE;
+}
+
+int16_t sgp40_get_serial_number(uint16_t* serial_number, uint8_t serial_number_size)
+{
+    static const uint16_t sim_serial[3] = { 0x0000, 0x5349, 0x4D40 };
+
+    if (sim_data[EI_SIM_SGP40].n_samples == 0) {
+        return SGP40_SIM_NO_DEVICE;
+    }
+
+    for (uint8_t i = 0; i < serial_number_size && i < 3; i++) {
+        serial_number[i] = sim_serial[i];
+    }
+
+    return 0;
+}
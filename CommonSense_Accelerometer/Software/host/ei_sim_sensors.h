@@ -0,0 +1,59 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EI_SIM_SENSORS_H
+#define EI_SIM_SENSORS_H
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/** Simulated sensors, each replays its own file */
+typedef enum {
+    EI_SIM_KX126 = 0,       /**< accX, accY, accZ in m/s2 */
+    EI_SIM_LSM6DSO32,       /**< accX, accY, accZ in m/s2, gyrX, gyrY, gyrZ in dps */
+    EI_SIM_SGP40,           /**< raw VOC signal in ticks */
+    EI_SIM_N_SENSORS
+} ei_sim_sensor_t;
+
+/**
+ * Samples replayed by one simulated sensor. Values are stored the way the
+ * application reports them (so a file sampled by this firmware replays as is),
+ * the drivers convert back to sensor units. Replay wraps around at the end.
+ */
+typedef struct {
+    float *values;          /**< n_samples rows of n_axes */
+    size_t n_axes;
+    size_t n_samples;
+    size_t next;            /**< next row to replay */
+    float interval_ms;      /**< from the file, 0 if it has no timing */
+} ei_sim_data_t;
+
+/* Function prototypes ----------------------------------------------------- */
+bool ei_sim_load(ei_sim_sensor_t sensor, const char *path);
+bool ei_sim_load_file(ei_sim_data_t *data, const char *path, size_t n_axes);
+void ei_sim_free(ei_sim_data_t *data);
+const float *ei_sim_next_sample(ei_sim_data_t *data);
+uint64_t ei_sim_now_us(void);
+
+#endif
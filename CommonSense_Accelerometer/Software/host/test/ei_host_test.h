@@ -0,0 +1,73 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Checks for the host tests in host/test. Each test is its own program, it
+ * returns ei_test_result() from main so `make host-test` stops on a failure.
+ */
+
+#ifndef EI_HOST_TEST_H
+#define EI_HOST_TEST_H
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <math.h>
+
+/* Private variables ------------------------------------------------------- */
+static int ei_test_checks = 0;
+static int ei_test_failures = 0;
+
+/* Constant defines -------------------------------------------------------- */
+#define EI_TEST_CHECK(cond) \
+    do { \
+        ei_test_checks++; \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ei_test_failures++; \
+        } \
+    } while (0)
+
+#define EI_TEST_CHECK_NEAR(a, b, tolerance) \
+    do { \
+        double _a = (a), _b = (b); \
+        ei_test_checks++; \
+        if (!(fabs(_a - _b) <= (tolerance))) { \
+            printf("%s:%d: check failed: %s = %f, %s = %f (tolerance %g)\n", \
+                __FILE__, __LINE__, #a, _a, #b, _b, (double)(tolerance)); \
+            ei_test_failures++; \
+        } \
+    } while (0)
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief Print the summary
+ *
+ * @return 0 if all checks passed, 1 otherwise
+ */
+static inline int ei_test_result(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, ei_test_checks, ei_test_failures);
+    return ei_test_failures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,128 @@
+/* Edge Impulse inferencing library
+ * Copyright (c) 2021 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Checks that the pruned structure-of-arrays anomaly scorer
+ * (ei_anomaly_soa_min_distance) returns exactly the score of the brute force
+ * scorer it replaced, which computes the distance to every cluster, for the
+ * model clusters and for random clusters of different sizes, with inputs
+ * close to a cluster (most clusters pruned) and far from all of them.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "model-parameters/model_metadata.h"
+#include "model-parameters/anomaly_clusters.h"
+#include "ei_anomaly_reference.h"
+#include "ei_host_test.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define TEST_MAX_CLUSTERS   300
+#define TEST_MAX_AXES       64
+#define TEST_INPUTS         500
+
+/* Private variables ------------------------------------------------------- */
+static float clusters[TEST_MAX_CLUSTERS * (TEST_MAX_AXES + 1)];
+static float soa_buffer[EI_ANOMALY_SOA_BUFFER_SIZE(TEST_MAX_CLUSTERS, TEST_MAX_AXES)];
+static float input[TEST_MAX_AXES];
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief Score TEST_INPUTS inputs against cluster_count random clusters
+ */
+static void check_random_clusters(size_t cluster_count, size_t axis_size)
+{
+    ei_anomaly_random_clusters(clusters, cluster_count, axis_size);
+
+    ei_anomaly_soa_t soa;
+    ei_anomaly_soa_init(&soa, &clusters[0], &clusters[axis_size], axis_size + 1,
+        cluster_count, axis_size, soa_buffer);
+
+    int mismatches = 0;
+    for (int ix = 0; ix < TEST_INPUTS; ix++) {
+        ei_anomaly_random_input(input, clusters, cluster_count, axis_size, ix & 1);
+
+        float expected = ei_anomaly_brute_force_min_distance(input, axis_size, clusters, cluster_count);
+        float score = ei_anomaly_soa_min_distance(&soa, input);
+        if (memcmp(&score, &expected, sizeof(float)) != 0) {
+            mismatches++;
+        }
+    }
+
+    if (mismatches > 0) {
+        printf("%d clusters, %d axes: %d of %d scores differ\n",
+            (int)cluster_count, (int)axis_size, mismatches, TEST_INPUTS);
+    }
+    EI_TEST_CHECK(mismatches == 0);
+}
+
+/**
+ * @brief Score a grid of inputs against the model clusters
+ */
+static void check_model_clusters(void)
+{
+    const size_t axis_size = EI_CLASSIFIER_ANOM_AXIS_SIZE;
+
+    for (size_t cx = 0; cx < EI_CLASSIFIER_ANOM_CLUSTER_COUNT; cx++) {
+        memcpy(&clusters[cx * (axis_size + 1)], ei_classifier_anom_clusters[cx].centroid, axis_size * sizeof(float));
+        clusters[cx * (axis_size + 1) + axis_size] = ei_classifier_anom_clusters[cx].max_error;
+    }
+
+    ei_anomaly_soa_t soa;
+    ei_anomaly_soa_init(&soa,
+        &ei_classifier_anom_clusters[0].centroid[0], &ei_classifier_anom_clusters[0].max_error,
+        sizeof(ei_classifier_anom_cluster_t) / sizeof(float),
+        EI_CLASSIFIER_ANOM_CLUSTER_COUNT, axis_size, soa_buffer);
+
+    for (int ix = 0; ix < TEST_INPUTS; ix++) {
+        for (size_t ax = 0; ax < axis_size; ax++) {
+            input[ax] = ei_anomaly_normal() * 2.0f;
+        }
+        float expected = ei_anomaly_brute_force_min_distance(input, axis_size, clusters, EI_CLASSIFIER_ANOM_CLUSTER_COUNT);
+        float score = ei_anomaly_soa_min_distance(&soa, input);
+        EI_TEST_CHECK(memcmp(&score, &expected, sizeof(float)) == 0);
+    }
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    // cluster counts around the block size of EI_ANOMALY_SOA_LANES, axis counts around the early exit interval
+    const size_t cluster_counts[] = { 1, 3, 4, 5, 32, TEST_MAX_CLUSTERS };
+    const size_t axis_sizes[] = { 1, 3, 4, 5, 16, TEST_MAX_AXES };
+
+    check_model_clusters();
+
+    for (size_t cx = 0; cx < sizeof(cluster_counts) / sizeof(cluster_counts[0]); cx++) {
+        for (size_t ax = 0; ax < sizeof(axis_sizes) / sizeof(axis_sizes[0]); ax++) {
+            check_random_clusters(cluster_counts[cx], axis_sizes[ax]);
+        }
+    }
+
+    return ei_test_result("test_anomaly_soa");
+}
@@ -0,0 +1,205 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Compares filters::butterworth_filter with the per-call butterworth_lowpass
+ * and butterworth_highpass it replaced (kept here verbatim, with the
+ * allocations swapped for arrays) and with a double precision reference, for
+ * even orders 2..16 over a range of sample and cut-off frequencies. The
+ * filter must be at least as accurate as the old loops, and filtering in
+ * chunks must give the same output, bit for bit, as filtering in one go.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "edge-impulse-sdk/dsp/spectral/spectral.hpp"
+#include "ei_host_test.h"
+
+using namespace ei::spectral;
+
+/* Constant defines -------------------------------------------------------- */
+#define TEST_SAMPLES        1000
+#define TEST_MAX_ORDER      16
+#define TEST_REL_TOLERANCE  2e-3
+
+/* Private variables ------------------------------------------------------- */
+static float input[TEST_SAMPLES];
+static float legacy_out[TEST_SAMPLES];
+static float filter_out[TEST_SAMPLES];
+static float chunked_out[TEST_SAMPLES];
+static double reference_out[TEST_SAMPLES];
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief The removed butterworth_lowpass / butterworth_highpass
+ */
+static void legacy(bool highpass, int filter_order, float sampling_freq, float cutoff_freq,
+    const float *src, float *dest, size_t size)
+{
+    int n_steps = filter_order / 2;
+    float a = tan(M_PI * cutoff_freq / sampling_freq);
+    float a2 = pow(a, 2);
+    float A[TEST_MAX_ORDER / 2], d1[TEST_MAX_ORDER / 2], d2[TEST_MAX_ORDER / 2];
+    float w0[TEST_MAX_ORDER / 2] = { 0 }, w1[TEST_MAX_ORDER / 2] = { 0 }, w2[TEST_MAX_ORDER / 2] = { 0 };
+
+    // Calculate the filter parameters
+    for (int ix = 0; ix < n_steps; ix++) {
+        float r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
+        sampling_freq = a2 + (2.0 * a * r) + 1.0;
+        A[ix] = highpass ? 1.0f / sampling_freq : a2 / sampling_freq;
+        d1[ix] = 2.0 * (1 - a2) / sampling_freq;
+        d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / sampling_freq;
+    }
+
+    // Apply the filter
+    for (size_t sx = 0; sx < size; sx++) {
+        dest[sx] = src[sx];
+
+        for (int i = 0; i < n_steps; i++) {
+            w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + dest[sx];
+            dest[sx] = highpass ?
+                A[i] * (w0[i] - (2.0 * w1[i]) + w2[i]) :
+                A[i] * (w0[i] + (2.0 * w1[i]) + w2[i]);
+            w2[i] = w1[i];
+            w1[i] = w0[i];
+        }
+    }
+}
+
+/**
+ * @brief The same cascade in double precision
+ */
+static void reference(bool highpass, int filter_order, double sampling_freq, double cutoff_freq,
+    const float *src, double *dest, size_t size)
+{
+    int n_steps = filter_order / 2;
+    double a = tan(M_PI * cutoff_freq / sampling_freq);
+    double a2 = a * a;
+    double A[TEST_MAX_ORDER / 2], d1[TEST_MAX_ORDER / 2], d2[TEST_MAX_ORDER / 2];
+    double w0[TEST_MAX_ORDER / 2] = { 0 }, w1[TEST_MAX_ORDER / 2] = { 0 }, w2[TEST_MAX_ORDER / 2] = { 0 };
+
+    for (int ix = 0; ix < n_steps; ix++) {
+        double r = sin(M_PI * ((2.0 * ix) + 1.0) / (2.0 * filter_order));
+        double s = a2 + (2.0 * a * r) + 1.0;
+        A[ix] = highpass ? 1.0 / s : a2 / s;
+        d1[ix] = 2.0 * (1 - a2) / s;
+        d2[ix] = -(a2 - (2.0 * a * r) + 1.0) / s;
+    }
+
+    for (size_t sx = 0; sx < size; sx++) {
+        double v = src[sx];
+
+        for (int i = 0; i < n_steps; i++) {
+            w0[i] = d1[i] * w1[i] + d2[i] * w2[i] + v;
+            v = highpass ?
+                A[i] * (w0[i] - (2.0 * w1[i]) + w2[i]) :
+                A[i] * (w0[i] + (2.0 * w1[i]) + w2[i]);
+            w2[i] = w1[i];
+            w1[i] = w0[i];
+        }
+        dest[sx] = v;
+    }
+}
+
+/**
+ * @brief A slow tone with noise, from a fixed seed
+ */
+static void make_input(void)
+{
+    srand(3);
+    for (int ix = 0; ix < TEST_SAMPLES; ix++) {
+        input[ix] = sinf(ix * 0.05f) * 2.f + (rand() / (float)RAND_MAX - 0.5f);
+    }
+}
+
+static void check_filter(bool highpass, int order, float sampling_freq, float cutoff_freq)
+{
+    filters::butterworth_filter filter;
+    int ret = highpass ?
+        filter.init_highpass(order, sampling_freq, cutoff_freq) :
+        filter.init_lowpass(order, sampling_freq, cutoff_freq);
+    EI_TEST_CHECK(ret == 0);
+
+    filter.apply(input, filter_out, TEST_SAMPLES);
+
+    // uneven chunks, carrying the state across calls
+    filter.reset();
+    for (int offset = 0; offset < TEST_SAMPLES; ) {
+        int n = 1 + (offset * 7) % 97;
+        if (offset + n > TEST_SAMPLES) {
+            n = TEST_SAMPLES - offset;
+        }
+        filter.apply(&input[offset], &chunked_out[offset], n);
+        offset += n;
+    }
+
+    legacy(highpass, order, sampling_freq, cutoff_freq, input, legacy_out, TEST_SAMPLES);
+    reference(highpass, order, sampling_freq, cutoff_freq, input, reference_out, TEST_SAMPLES);
+
+    double peak = 0, legacy_err = 0, filter_err = 0;
+    for (int ix = 0; ix < TEST_SAMPLES; ix++) {
+        peak = fmax(peak, fabs(reference_out[ix]));
+        legacy_err = fmax(legacy_err, fabs(legacy_out[ix] - reference_out[ix]));
+        filter_err = fmax(filter_err, fabs(filter_out[ix] - reference_out[ix]));
+    }
+
+    EI_TEST_CHECK(filter_err / peak < TEST_REL_TOLERANCE);
+    EI_TEST_CHECK(filter_err <= legacy_err + TEST_REL_TOLERANCE * peak);
+    EI_TEST_CHECK(memcmp(filter_out, chunked_out, sizeof(filter_out)) == 0);
+
+    if (filter_err / peak >= TEST_REL_TOLERANCE) {
+        printf("%s order %d, fs %.1f Hz, cut-off %.1f Hz: relative error %g (old loops %g)\n",
+            highpass ? "high-pass" : "low-pass", order, sampling_freq, cutoff_freq,
+            filter_err / peak, legacy_err / peak);
+    }
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    const float sampling_freqs[] = { 62.5f, 100.f, 1000.f };
+    const float cutoff_freqs[] = { 0.5f, 3.f, 10.f };
+    int configs = 0;
+
+    make_input();
+
+    for (int highpass = 0; highpass < 2; highpass++) {
+        for (int order = 2; order <= TEST_MAX_ORDER; order += 2) {
+            for (size_t fx = 0; fx < sizeof(sampling_freqs) / sizeof(sampling_freqs[0]); fx++) {
+                for (size_t cx = 0; cx < sizeof(cutoff_freqs) / sizeof(cutoff_freqs[0]); cx++) {
+                    check_filter(highpass, order, sampling_freqs[fx], cutoff_freqs[cx]);
+                    configs++;
+                }
+            }
+        }
+    }
+
+    printf("%d filter configurations\n", configs);
+
+    return ei_test_result("test_butterworth_filter");
+}
@@ -0,0 +1,134 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Feeds a stream slice by slice to run_classifier_continuous and compares
+ * every result with run_classifier on the window that ends at that slice.
+ * Without the moving average filter they must be the same; with it every
+ * classification is the mean of the last EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW / 2
+ * window results.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <math.h>
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "ei_host_test.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define TEST_SAMPLES        2000
+#define TEST_AXES           EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME
+#define MAF_LENGTH          (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW >> 1)
+
+/* Private variables ------------------------------------------------------- */
+static float stream[TEST_SAMPLES * TEST_AXES];
+static float history[MAF_LENGTH][EI_CLASSIFIER_LABEL_COUNT];
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief Two tones on X (the second one starts later), one on Y, gravity on Z
+ */
+static void make_stream(void)
+{
+    for (int ix = 0; ix < TEST_SAMPLES; ix++) {
+        stream[ix * TEST_AXES + 0] = sinf(ix * 0.3f) * 3.f + (ix > 600 ? 2.f * sinf(ix * 1.1f) : 0.f);
+        stream[ix * TEST_AXES + 1] = cosf(ix * 0.7f);
+        stream[ix * TEST_AXES + 2] = 9.8f + 0.1f * sinf(ix * 1.3f);
+    }
+}
+
+/**
+ * @brief Run the stream through run_classifier_continuous
+ *
+ * @return number of results compared
+ */
+static int run_stream(bool enable_maf)
+{
+    int results = 0;
+
+    run_classifier_init();
+
+    for (int slice = 0; (slice + 1) * EI_CLASSIFIER_SLICE_SIZE <= TEST_SAMPLES; slice++) {
+        signal_t signal;
+        numpy::signal_from_buffer(&stream[slice * EI_CLASSIFIER_SLICE_SIZE * TEST_AXES],
+            EI_CLASSIFIER_SLICE_SIZE * TEST_AXES, &signal);
+
+        ei_impulse_result_t result = { 0 };
+        EI_TEST_CHECK(run_classifier_continuous(&signal, &result, false, enable_maf) == EI_IMPULSE_OK);
+
+        int end = (slice + 1) * EI_CLASSIFIER_SLICE_SIZE;
+        if (end < EI_CLASSIFIER_RAW_SAMPLE_COUNT) {
+            EI_TEST_CHECK(result.classification[0].label == NULL);
+            continue;
+        }
+
+        signal_t window;
+        numpy::signal_from_buffer(&stream[(end - EI_CLASSIFIER_RAW_SAMPLE_COUNT) * TEST_AXES],
+            EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, &window);
+
+        ei_impulse_result_t expected = { 0 };
+        EI_TEST_CHECK(run_classifier(&window, &expected, false) == EI_IMPULSE_OK);
+
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            history[results % MAF_LENGTH][ix] = expected.classification[ix].value;
+        }
+
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            if (!enable_maf) {
+                EI_TEST_CHECK(result.classification[ix].value == expected.classification[ix].value);
+            }
+            else if (results + 1 >= MAF_LENGTH) {
+                float mean = 0.f;
+                for (int h = 0; h < MAF_LENGTH; h++) {
+                    mean += history[h][ix];
+                }
+                EI_TEST_CHECK_NEAR(result.classification[ix].value, mean / MAF_LENGTH, 1e-5);
+            }
+        }
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+        EI_TEST_CHECK(result.anomaly == expected.anomaly);
+#endif
+        results++;
+    }
+
+    return results;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    make_stream();
+
+    int results = run_stream(false);
+    /* One result per slice, from the first slice that completes a window */
+    int first_result = (EI_CLASSIFIER_RAW_SAMPLE_COUNT + EI_CLASSIFIER_SLICE_SIZE - 1) / EI_CLASSIFIER_SLICE_SIZE;
+    EI_TEST_CHECK(results == TEST_SAMPLES / EI_CLASSIFIER_SLICE_SIZE - first_result + 1);
+
+    EI_TEST_CHECK(run_stream(true) == results);
+
+    printf("%d results per pass, every %d samples\n", results, EI_CLASSIFIER_SLICE_SIZE);
+
+    return ei_test_result("test_continuous_spectral");
+}
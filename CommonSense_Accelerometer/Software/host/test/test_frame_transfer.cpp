@@ -0,0 +1,331 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Sends data with the framed transfer (ei_frame_begin, ei_frame_data,
+ * ei_frame_end) to a go-back-N receiver on the other end of a socket pair,
+ * which stands in for the host. The receiver corrupts and drops frames and
+ * drops its own replies at a given rate. Everything must still arrive once,
+ * in order, with the right END frame. Also checks a cancelled transfer and
+ * a failed data source.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "firmware-sdk/at_frame_lib.h"
+#include "ei_host_test.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define TEST_DATA_SIZE      150001      /* ~300 frames, seq wraps around */
+#define TEST_MAX_CHUNK      700
+#define TEST_CANCEL_FRAME   20
+
+/* Private types ----------------------------------------------------------- */
+typedef struct {
+    int fd;
+    uint32_t error_per_mille;   /**!< Rate of corrupted / dropped frames and dropped replies */
+    int cancel_frame;           /**!< Send CAN on this frame, -1 for never */
+    uint32_t rng;
+
+    uint8_t *data;
+    size_t received;
+    bool frame_line_ok;
+    bool bad_payload_size;
+    bool got_end;
+    uint32_t end_total;
+    uint8_t end_status;
+    int faults;
+} receiver_t;
+
+/* Private variables ------------------------------------------------------- */
+static uint8_t source[TEST_DATA_SIZE];
+static uint32_t rng_state = 1;
+
+/* Private functions ------------------------------------------------------- */
+
+static uint32_t rng_next(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static bool fault(receiver_t *rx)
+{
+    if (rng_next(&rx->rng) % 1000 < rx->error_per_mille) {
+        rx->faults++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE, written out again so the wire format is checked
+ *        independently of ei_frame_crc16
+ */
+static uint16_t crc16(const uint8_t *data, size_t size)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t ix = 0; ix < size; ix++) {
+        crc ^= (uint16_t)data[ix] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool read_exact(int fd, uint8_t *buffer, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = read(fd, buffer, size);
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static void reply(receiver_t *rx, uint8_t code, uint8_t seq)
+{
+    uint8_t msg[3] = { code, seq, (uint8_t)(seq ^ 0xFF) };
+
+    if (code != EI_FRAME_CAN && fault(rx)) {
+        return;
+    }
+    if (write(rx->fd, msg, sizeof(msg)) != (ssize_t)sizeof(msg)) {
+        rx->faults++;
+    }
+}
+
+/**
+ * @brief The host side: read the FRAME line, then frames until the device
+ *        closes the connection
+ */
+static void *receiver_thread(void *arg)
+{
+    receiver_t *rx = (receiver_t *)arg;
+    char line[64] = { 0 };
+    uint8_t frame[EI_FRAME_HEADER_SIZE + EI_FRAME_MAX_PAYLOAD + EI_FRAME_CRC_SIZE];
+    uint8_t expect = 0;
+    bool naked = false;
+    int frames = 0;
+
+    for (size_t ix = 0; ix < sizeof(line) - 1; ix++) {
+        if (!read_exact(rx->fd, (uint8_t *)&line[ix], 1)) {
+            return NULL;
+        }
+        if (line[ix] == '\n') {
+            break;
+        }
+    }
+    char expected_line[64];
+    snprintf(expected_line, sizeof(expected_line), "FRAME %d,%d,%d\r\n",
+        EI_FRAME_VERSION, EI_FRAME_MAX_PAYLOAD, EI_FRAME_WINDOW);
+    rx->frame_line_ok = strcmp(line, expected_line) == 0;
+
+    while (read_exact(rx->fd, frame, 1)) {
+        if (frame[0] != EI_FRAME_SOF) {
+            continue;
+        }
+        if (!read_exact(rx->fd, &frame[1], EI_FRAME_HEADER_SIZE - 1)) {
+            break;
+        }
+        size_t length = frame[3] | (frame[4] << 8);
+        if (length > EI_FRAME_MAX_PAYLOAD) {
+            rx->bad_payload_size = true;
+            break;
+        }
+        if (!read_exact(rx->fd, &frame[EI_FRAME_HEADER_SIZE], length + EI_FRAME_CRC_SIZE)) {
+            break;
+        }
+
+        uint8_t type = frame[1];
+        uint8_t seq = frame[2];
+        uint8_t *payload = &frame[EI_FRAME_HEADER_SIZE];
+
+        /* lost on the line */
+        if (fault(rx)) {
+            continue;
+        }
+        /* bit error in the payload or CRC, header stays intact so the
+         * stream doesn't need to resync */
+        if (fault(rx)) {
+            frame[EI_FRAME_HEADER_SIZE + rng_next(&rx->rng) % (length + EI_FRAME_CRC_SIZE)] ^= 0x10;
+        }
+
+        uint16_t crc = payload[length] | (payload[length + 1] << 8);
+        if (crc != crc16(&frame[1], EI_FRAME_HEADER_SIZE - 1 + length)) {
+            if (!naked) {
+                reply(rx, EI_FRAME_NAK, expect);
+                naked = true;
+            }
+            continue;
+        }
+
+        if (seq != expect) {
+            /* ahead of expect: a frame got lost. Behind: a resend of
+             * something already received, the ACK for it got lost */
+            if ((uint8_t)(expect - seq) > EI_FRAME_WINDOW && !naked) {
+                reply(rx, EI_FRAME_NAK, expect);
+                naked = true;
+            }
+            else {
+                reply(rx, EI_FRAME_ACK, (uint8_t)(expect - 1));
+            }
+            continue;
+        }
+
+        if (frames++ == rx->cancel_frame) {
+            reply(rx, EI_FRAME_CAN, 0);
+            continue;
+        }
+
+        if (type == EI_FRAME_TYPE_DATA) {
+            memcpy(&rx->data[rx->received], payload, length);
+            rx->received += length;
+        }
+        else if (type == EI_FRAME_TYPE_END && length == 5) {
+            rx->got_end = true;
+            rx->end_total = payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+            rx->end_status = payload[4];
+        }
+        expect++;
+        naked = false;
+        reply(rx, EI_FRAME_ACK, seq);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Transfer the source with the console on a socket to the receiver
+ *
+ * @return ei_frame_end()
+ */
+static bool run_transfer(receiver_t *rx, bool success)
+{
+    int fds[2];
+    pthread_t thread;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    fflush(stdout);
+    int saved_stdin = dup(STDIN_FILENO);
+    int saved_stdout = dup(STDOUT_FILENO);
+    dup2(fds[0], STDIN_FILENO);
+    dup2(fds[0], STDOUT_FILENO);
+
+    rx->fd = fds[1];
+    rx->data = (uint8_t *)calloc(TEST_DATA_SIZE + EI_FRAME_MAX_PAYLOAD, 1);
+    pthread_create(&thread, NULL, receiver_thread, rx);
+
+    /* in chunks of any size, like the read_file and read_buffer callbacks */
+    ei_frame_begin();
+    for (size_t pos = 0; pos < TEST_DATA_SIZE;) {
+        size_t n = 1 + rng_next(&rng_state) % TEST_MAX_CHUNK;
+        if (n > TEST_DATA_SIZE - pos) {
+            n = TEST_DATA_SIZE - pos;
+        }
+        ei_frame_data(&source[pos], n);
+        pos += n;
+    }
+    bool ok = ei_frame_end(success);
+
+    dup2(saved_stdin, STDIN_FILENO);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdin);
+    close(saved_stdout);
+    close(fds[0]);
+
+    pthread_join(thread, NULL);
+    close(fds[1]);
+
+    return ok;
+}
+
+static void check_transfer(uint32_t error_per_mille)
+{
+    receiver_t rx = { };
+    rx.error_per_mille = error_per_mille;
+    rx.cancel_frame = -1;
+    rx.rng = 1234 + error_per_mille;
+
+    bool ok = run_transfer(&rx, true);
+
+    EI_TEST_CHECK(ok);
+    EI_TEST_CHECK(rx.frame_line_ok);
+    EI_TEST_CHECK(!rx.bad_payload_size);
+    EI_TEST_CHECK(rx.received == TEST_DATA_SIZE);
+    EI_TEST_CHECK(memcmp(rx.data, source, TEST_DATA_SIZE) == 0);
+    EI_TEST_CHECK(rx.got_end);
+    EI_TEST_CHECK(rx.end_total == TEST_DATA_SIZE);
+    EI_TEST_CHECK(rx.end_status == 0);
+    EI_TEST_CHECK((error_per_mille == 0) == (rx.faults == 0));
+
+    free(rx.data);
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    for (size_t ix = 0; ix < TEST_DATA_SIZE; ix++) {
+        source[ix] = (uint8_t)rng_next(&rng_state);
+    }
+
+    check_transfer(0);
+    check_transfer(10);
+    check_transfer(50);
+
+    /* the host cancels, the device stops sending */
+    receiver_t cancelled = { };
+    cancelled.cancel_frame = TEST_CANCEL_FRAME;
+    EI_TEST_CHECK(!run_transfer(&cancelled, true));
+    EI_TEST_CHECK(cancelled.received == TEST_CANCEL_FRAME * EI_FRAME_MAX_PAYLOAD);
+    EI_TEST_CHECK(!cancelled.got_end);
+    free(cancelled.data);
+
+    /* the data source failed halfway, all data still arrives with the status */
+    receiver_t failed = { };
+    failed.cancel_frame = -1;
+    EI_TEST_CHECK(!run_transfer(&failed, false));
+    EI_TEST_CHECK(failed.received == TEST_DATA_SIZE);
+    EI_TEST_CHECK(failed.got_end);
+    EI_TEST_CHECK(failed.end_status == 1);
+    free(failed.data);
+
+    return ei_test_result("test_frame_transfer");
+}
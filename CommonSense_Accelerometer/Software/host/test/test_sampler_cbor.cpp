@@ -0,0 +1,267 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Captures a sample with the real sampler (ei_sampler_start_sampling) on the
+ * simulated KX126, then reads back the range the sampler reports as used
+ * (from=, to=), like READBUFFER does. That range must be exactly one CBOR
+ * document with the replayed values, and its HMAC must match the signature.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "ei_sampler.h"
+#include "ei_config_types.h"
+#include "sensor_aq.h"
+#include "qcbor.h"
+#include "mbedtls/md.h"
+#include "ei_host_port.h"
+#include "ei_sim_sensors.h"
+#include "ei_host_test.h"
+
+/* Extern reference -------------------------------------------------------- */
+extern ei_config_t *ei_config_get_config();
+
+/* Constant defines -------------------------------------------------------- */
+#define TEST_INTERVAL_MS    16
+#define TEST_LENGTH_MS      320
+#define TEST_SAMPLES        (TEST_LENGTH_MS / TEST_INTERVAL_MS)
+#define TEST_HMAC_KEY       "0123456789abcdef0123456789abcdef"
+#define SIGNATURE_HEX_LEN   64
+
+/* Private types ----------------------------------------------------------- */
+typedef struct {
+    const uint8_t *signature;   /**!< Signature hex string inside the sample */
+    int n_values;
+    int n_mismatch;
+} sample_cbor_t;
+
+/* Private variables ------------------------------------------------------- */
+static char sd_dir[] = "/tmp/ei_test_sampler_XXXXXX";
+static float csv_values[TEST_SAMPLES * 2][3];
+
+/* Private functions ------------------------------------------------------- */
+
+static bool write_csv(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    fprintf(f, "accX,accY,accZ\n");
+    for (int ix = 0; ix < TEST_SAMPLES * 2; ix++) {
+        csv_values[ix][0] = 0.25f * ix;
+        csv_values[ix][1] = -1.5f + 0.125f * ix;
+        csv_values[ix][2] = 9.75f;
+        fprintf(f, "%f,%f,%f\n", csv_values[ix][0], csv_values[ix][1], csv_values[ix][2]);
+    }
+
+    return fclose(f) == 0;
+}
+
+/**
+ * @brief Run the sampler with stdout in a file, return the reported to= offset
+ */
+static long run_sampler(void)
+{
+    char log_path[128];
+    snprintf(log_path, sizeof(log_path), "%s/log.txt", sd_dir);
+
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int log_fd = open(log_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (saved_stdout < 0 || log_fd < 0) {
+        return -1;
+    }
+    dup2(log_fd, STDOUT_FILENO);
+
+    sensor_aq_payload_info payload = {
+        "test", "TEST_SAMPLER", TEST_INTERVAL_MS,
+        { { "accX", "m/s2" }, { "accY", "m/s2" }, { "accZ", "m/s2" } }
+    };
+    bool sampled = ei_sampler_start_sampling(&payload, 3 * sizeof(float));
+
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    char log[4096] = { 0 };
+    lseek(log_fd, 0, SEEK_SET);
+    ssize_t n = read(log_fd, log, sizeof(log) - 1);
+    close(log_fd);
+
+    EI_TEST_CHECK(sampled);
+    EI_TEST_CHECK(n > 0);
+
+    const char *used = strstr(log, "to=");
+    EI_TEST_CHECK(used != NULL);
+
+    return used ? strtol(used + 3, NULL, 10) : -1;
+}
+
+/**
+ * @brief Walk the sample document, compare the values with the CSV
+ *
+ * @return the error that ended decoding
+ */
+static QCBORError decode_sample(const uint8_t *sample, size_t length, sample_cbor_t *cbor)
+{
+    QCBORDecodeContext ctx;
+    QCBORItem item;
+    QCBORError err;
+    bool in_values = false;
+    uint8_t values_level = 0;
+
+    QCBORDecode_Init(&ctx, (UsefulBufC){ sample, length }, QCBOR_DECODE_MODE_NORMAL);
+    while ((err = QCBORDecode_GetNext(&ctx, &item)) == QCBOR_SUCCESS) {
+        bool text_label = item.uLabelType == QCBOR_TYPE_TEXT_STRING;
+
+        if (in_values && item.uNestingLevel <= values_level) {
+            in_values = false;
+        }
+
+        if (text_label && UsefulBuf_Compare(item.label.string, UsefulBuf_FROM_SZ_LITERAL("signature")) == 0) {
+            if (item.val.string.len == SIGNATURE_HEX_LEN) {
+                cbor->signature = (const uint8_t *)item.val.string.ptr;
+            }
+        }
+        else if (text_label && UsefulBuf_Compare(item.label.string, UsefulBuf_FROM_SZ_LITERAL("values")) == 0) {
+            in_values = true;
+            values_level = item.uNestingLevel;
+        }
+        else if (in_values && item.uDataType != QCBOR_TYPE_ARRAY) {
+            double value = item.uDataType == QCBOR_TYPE_DOUBLE ? item.val.dfnum : (double)item.val.int64;
+            int row = cbor->n_values / 3;
+            if (row >= TEST_SAMPLES * 2 || fabs(value - csv_values[row][cbor->n_values % 3]) > 0.01) {
+                cbor->n_mismatch++;
+            }
+            cbor->n_values++;
+        }
+    }
+
+    QCBORDecode_Finish(&ctx);
+
+    return err;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    char path[128];
+
+    if (!mkdtemp(sd_dir)) {
+        printf("Failed to create %s\n", sd_dir);
+        return 1;
+    }
+    ei_host_set_sd_dir(sd_dir);
+
+    snprintf(path, sizeof(path), "%s/acc.csv", sd_dir);
+    if (!write_csv(path) || !ei_sim_load(EI_SIM_KX126, path)) {
+        return 1;
+    }
+
+    ei_config_t *config = ei_config_get_config();
+    config->sample_interval_ms = TEST_INTERVAL_MS;
+    config->sample_length_ms = TEST_LENGTH_MS;
+    strcpy(config->sample_label, "test");
+    strcpy(config->sample_hmac_key, TEST_HMAC_KEY);
+
+    long to = run_sampler();
+    if (to <= 0) {
+        return ei_test_result("test_sampler_cbor");
+    }
+
+    /* Read back what READBUFFER 0,to would send */
+    snprintf(path, sizeof(path), "%s/sample.bin", sd_dir);
+    FILE *f = fopen(path, "rb");
+    EI_TEST_CHECK(f != NULL);
+    if (!f) {
+        return ei_test_result("test_sampler_cbor");
+    }
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    EI_TEST_CHECK(to <= file_size);
+
+    uint8_t *sample = (uint8_t *)calloc(file_size, 1);
+    EI_TEST_CHECK(fread(sample, 1, file_size, f) == (size_t)file_size);
+    fclose(f);
+
+    /* The used range ends on the CBOR break of the values array */
+    EI_TEST_CHECK(sample[to - 1] == 0xFF);
+
+    sample_cbor_t cbor = { };
+    QCBORError decoded = decode_sample(sample, to, &cbor);
+
+    /* Decoding ends on the break of the values array. This QCBOR version
+     * reports the outer maps as still open after an indefinite array, so
+     * QCBORDecode_Finish() can't tell; one more byte (the first pad byte)
+     * must be a stray break instead. */
+    EI_TEST_CHECK(decoded == QCBOR_ERR_HIT_END);
+    if (to < file_size) {
+        sample_cbor_t padded = { };
+        EI_TEST_CHECK(decode_sample(sample, to + 1, &padded) == QCBOR_ERR_BAD_BREAK);
+    }
+
+    EI_TEST_CHECK(cbor.n_values >= TEST_SAMPLES * 3);
+    EI_TEST_CHECK(cbor.n_values % 3 == 0);
+    EI_TEST_CHECK(cbor.n_mismatch == 0);
+    EI_TEST_CHECK(cbor.signature != NULL);
+
+    /* Ingestion signs the file with the signature zeroed out */
+    if (cbor.signature) {
+        char signature_hex[SIGNATURE_HEX_LEN + 1] = { 0 };
+        uint8_t hmac[32];
+        char hmac_hex[SIGNATURE_HEX_LEN + 1];
+
+        memcpy(signature_hex, cbor.signature, SIGNATURE_HEX_LEN);
+        memset(sample + (cbor.signature - sample), '0', SIGNATURE_HEX_LEN);
+
+        int ret = mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+            (const unsigned char *)TEST_HMAC_KEY, strlen(TEST_HMAC_KEY), sample, to, hmac);
+        EI_TEST_CHECK(ret == 0);
+
+        for (int ix = 0; ix < 32; ix++) {
+            snprintf(&hmac_hex[ix * 2], 3, "%02x", hmac[ix]);
+        }
+        EI_TEST_CHECK(strcmp(hmac_hex, signature_hex) == 0);
+    }
+
+    free(sample);
+
+    const char *files[] = { "acc.csv", "log.txt", "sample.bin", "config.bin" };
+    for (size_t ix = 0; ix < sizeof(files) / sizeof(files[0]); ix++) {
+        snprintf(path, sizeof(path), "%s/%s", sd_dir, files[ix]);
+        unlink(path);
+    }
+    rmdir(sd_dir);
+
+    return ei_test_result("test_sampler_cbor");
+}
@@ -0,0 +1,181 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Float and fixed-point spectral analysis side by side on the same windows of
+ * KX126 counts: the float block gets the counts in m/s2, the q15 block
+ * (dsp/spectral/plan_q15.hpp) the raw counts with the signal scale. Built with
+ * QUANTIZED_DSP=1 the whole impulse is compared too (run_classifier against
+ * run_classifier_i16).
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdio.h>
+#include <math.h>
+
+#include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "ei_host_test.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define TEST_WINDOWS            300
+#define COUNTS_PER_G            16384.f
+#define COUNT_SCALE             (9.80665f / COUNTS_PER_G)
+#define FEATURE_REL_TOLERANCE   0.01
+#define FEATURE_REL_FLOOR       0.05
+#define PREDICTION_TOLERANCE    0.01
+#define ANOMALY_TOLERANCE       0.001
+
+/* Private variables ------------------------------------------------------- */
+static int16_t counts[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
+static float values[EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE];
+static uint32_t rng_state = 23;
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief Uniform in [0, 1), a fixed sequence on every host
+ */
+static float rng_uniform(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (float)(rng_state >> 8) / 16777216.f;
+}
+
+/**
+ * @brief A few sines per axis plus noise, from 0.01 to 1 g, gravity on Z
+ */
+static void make_window(void)
+{
+    float amplitude = powf(10.f, -2.f + 2.f * rng_uniform());
+
+    for (int ax = 0; ax < EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME; ax++) {
+        int n_sines = 1 + (int)(rng_uniform() * 3);
+        float freq[3], amp[3], phase[3];
+        for (int k = 0; k < n_sines; k++) {
+            freq[k] = 0.2f + rng_uniform() * 30.f;
+            amp[k] = amplitude * rng_uniform();
+            phase[k] = rng_uniform() * 2.f * (float)M_PI;
+        }
+        float offset = (ax == 2) ? 1.0f : (rng_uniform() - 0.5f) * 0.2f;
+
+        for (int ix = 0; ix < EI_CLASSIFIER_RAW_SAMPLE_COUNT; ix++) {
+            float g = offset + amplitude * 0.02f * (rng_uniform() - 0.5f);
+            for (int k = 0; k < n_sines; k++) {
+                g += amp[k] * sinf(2.f * (float)M_PI * freq[k] * ix / EI_CLASSIFIER_FREQUENCY + phase[k]);
+            }
+            long c = lroundf(g * COUNTS_PER_G);
+            c = c > 32767 ? 32767 : c < -32768 ? -32768 : c;
+
+            counts[ix * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME + ax] = (int16_t)c;
+            values[ix * EI_CLASSIFIER_RAW_SAMPLES_PER_FRAME + ax] = (float)c * COUNT_SCALE;
+        }
+    }
+}
+
+static const ei_dsp_config_spectral_analysis_t *spectral_config(void)
+{
+    return (const ei_dsp_config_spectral_analysis_t *)ei_dsp_blocks[0].config;
+}
+
+/**
+ * @brief Per axis the block outputs RMS, then frequency and height of every
+ *        peak, then the spectral power per edge band
+ */
+static bool is_peak_frequency(size_t feature)
+{
+    size_t per_axis = EI_CLASSIFIER_NN_INPUT_FRAME_SIZE / spectral_config()->axes;
+    size_t ix = feature % per_axis;
+
+    return ix >= 1 && ix < 1 + 2 * (size_t)spectral_config()->spectral_peaks_count && (ix - 1) % 2 == 0;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+int main(void)
+{
+    double feature_rel_max = 0.0;
+    int feature_fails = 0;
+    int peak_bin_moves = 0;
+    double fft_bin_hz = EI_CLASSIFIER_FREQUENCY / (double)spectral_config()->fft_length;
+
+    for (int w = 0; w < TEST_WINDOWS; w++) {
+        make_window();
+
+        signal_t signal;
+        signal_i16_t signal_i16;
+        numpy::signal_from_buffer(values, EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, &signal);
+        numpy::signal_from_buffer_i16(counts, EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, &signal_i16);
+        signal_i16.scale = COUNT_SCALE;
+
+        matrix_t features(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+        matrix_i32_t features_q15(1, EI_CLASSIFIER_NN_INPUT_FRAME_SIZE);
+        SignalWithAxes swa(&signal, ei_dsp_blocks[0].axes, ei_dsp_blocks[0].axes_size);
+        SignalWithAxesI16 swa_i16(&signal_i16, ei_dsp_blocks_i16[0].axes, ei_dsp_blocks_i16[0].axes_size);
+
+        EI_TEST_CHECK(extract_spectral_analysis_features(swa.get_signal(), &features,
+            ei_dsp_blocks[0].config, EI_CLASSIFIER_FREQUENCY) == EIDSP_OK);
+        EI_TEST_CHECK(extract_spectral_analysis_features(swa_i16.get_signal(), &features_q15,
+            ei_dsp_blocks_i16[0].config, EI_CLASSIFIER_FREQUENCY) == EIDSP_OK);
+
+        for (size_t ix = 0; ix < EI_CLASSIFIER_NN_INPUT_FRAME_SIZE; ix++) {
+            double expected = features.buffer[ix];
+            double actual = features_q15.buffer[ix] / 32768.0;
+
+            /* Two peaks of almost the same height can swap order, the
+             * frequency then moves to the neighbouring FFT bin */
+            double bins = fabs(expected - actual) / fft_bin_hz;
+            if (is_peak_frequency(ix) && bins > 0.5 && bins < 1.5) {
+                peak_bin_moves++;
+                continue;
+            }
+
+            double err = fabs(expected - actual) / fmax(fabs(expected), FEATURE_REL_FLOOR);
+            feature_rel_max = fmax(feature_rel_max, err);
+            feature_fails += err > FEATURE_REL_TOLERANCE;
+        }
+
+#if EI_CLASSIFIER_QUANTIZED_DSP == 1
+        ei_impulse_result_t result = { 0 };
+        ei_impulse_result_t result_i16 = { 0 };
+        EI_TEST_CHECK(run_classifier(&signal, &result, false) == EI_IMPULSE_OK);
+        EI_TEST_CHECK(run_classifier_i16(&signal_i16, &result_i16, false) == EI_IMPULSE_OK);
+
+        size_t top = 0, top_i16 = 0;
+        for (size_t ix = 0; ix < EI_CLASSIFIER_LABEL_COUNT; ix++) {
+            EI_TEST_CHECK_NEAR(result.classification[ix].value, result_i16.classification[ix].value, PREDICTION_TOLERANCE);
+            top = result.classification[ix].value > result.classification[top].value ? ix : top;
+            top_i16 = result_i16.classification[ix].value > result_i16.classification[top_i16].value ? ix : top_i16;
+        }
+        EI_TEST_CHECK(top == top_i16);
+#if EI_CLASSIFIER_HAS_ANOMALY == 1
+        EI_TEST_CHECK_NEAR(result.anomaly, result_i16.anomaly, ANOMALY_TOLERANCE);
+#endif
+#endif
+    }
+
+    EI_TEST_CHECK(feature_fails == 0);
+    EI_TEST_CHECK(peak_bin_moves <= TEST_WINDOWS / 100);
+    printf("%d windows, max feature error %.4f (relative, floor %.2f), %d peaks moved one bin\n",
+        TEST_WINDOWS, feature_rel_max, FEATURE_REL_FLOOR, peak_bin_moves);
+
+    return ei_test_result("test_spectral_q15_parity");
+}
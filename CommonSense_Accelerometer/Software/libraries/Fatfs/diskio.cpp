@@ -56,12 +56,23 @@ DRESULT disk_read (
 	UINT count		/* Number of sectors to read (1..128) */
 )
 {
+    if (count == 1) {
+        return sdcard_read_single_block(sector, buff) == 0 ? RES_OK : RES_ERROR;
+    }
+
+    /* CMD18: one command for the whole run, CMD12 stops it */
+    if (sdcard_read_begin(sector) != 0) {
+        return RES_ERROR;
+    }
+
     for (UINT i = 0; i < count; i++) {
-        if (sdcard_read_single_block(sector + i, buff + (512 * i)) != 0) {
+        if (sdcard_read_data(buff + (512 * i)) != 0) {
+            sdcard_read_end();
             return RES_ERROR;
         }
     }
-    return RES_OK;
+
+    return sdcard_read_end() == 0 ? RES_OK : RES_ERROR;
 }
 
 
@@ -78,12 +89,26 @@ DRESULT disk_write (
 	UINT count			/* Number of sectors to write (1..128) */
 )
 {
+    if (count == 1) {
+        return sdcard_write_single_block(sector, buff) == 0 ? RES_OK : RES_ERROR;
+    }
+
+    /* ACMD23 lets the card pre-erase the run, CMD25 writes it with one command.
+       The erase count is only a hint, carry on without it */
+    sdcard_write_erase_count(count);
+
+    if (sdcard_write_begin(sector) != 0) {
+        return RES_ERROR;
+    }
+
     for (UINT i = 0; i < count; i++) {
-        if (sdcard_write_single_block(sector + i, (BYTE*) (buff + (512 * i))) != 0) {
+        if (sdcard_write_data(buff + (512 * i)) != 0) {
+            sdcard_write_end();
             return RES_ERROR;
         }
     }
-    return RES_OK;
+
+    return sdcard_write_end() == 0 ? RES_OK : RES_ERROR;
 }
 #endif
 
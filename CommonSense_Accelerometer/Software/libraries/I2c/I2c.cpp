@@ -191,6 +191,34 @@ uint8_t i2c_read_regs(uint8_t i2c_addr, uint8_t reg_addr, uint8_t *data, uint16_
     return TWI_SUCCESS;
 }
 
+// Same as i2c_read_regs, but reads straight into data in one repeated start
+// transfer, so size is not limited to the rx buffer. For sensor FIFO bursts.
+uint8_t i2c_read_regs_burst(uint8_t i2c_addr, uint8_t reg_addr, uint8_t *data, uint16_t size) {
+    struct i2c_msg_s msg[2];
+    int ret;
+
+    if (!_dev) return TWI_OTHER_ERROR;
+
+    msg[0].frequency = _freq;
+    msg[0].addr      = i2c_addr;
+    msg[0].flags     = I2C_M_NOSTOP;
+    msg[0].buffer    = &reg_addr;
+    msg[0].length    = 1;
+
+    msg[1].frequency = _freq;
+    msg[1].addr      = i2c_addr;
+    msg[1].flags     = I2C_M_READ;
+    msg[1].buffer    = data;
+    msg[1].length    = size;
+
+    ret = I2C_TRANSFER(_dev, msg, 2);
+    if (ret == -ENODEV) {
+        // device not found
+        return TWI_NACK_ON_ADDRESS;
+    }
+    return (ret < 0) ? TWI_OTHER_ERROR : TWI_SUCCESS;
+}
+
 uint8_t i2c_read_data(uint8_t i2c_addr, uint8_t *data, uint16_t size) {
 
     uint16_t read = I2cRequest(i2c_addr, size, true);
@@ -102,6 +102,8 @@ uint8_t i2c_write_regs(uint8_t i2c_addr, uint8_t reg_addr, uint8_t *data, uint16
  */
 uint8_t i2c_read_regs(uint8_t i2c_addr, uint8_t reg_addr, uint8_t *data, uint16_t size);
 
+uint8_t i2c_read_regs_burst(uint8_t i2c_addr, uint8_t reg_addr, uint8_t *data, uint16_t size);
+
 uint8_t i2c_read_data(uint8_t i2c_addr, uint8_t *data, uint16_t size);
 
 uint8_t i2c_write_data(uint8_t i2c_addr, uint8_t *data, uint16_t size);
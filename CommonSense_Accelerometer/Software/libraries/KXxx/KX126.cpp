@@ -123,6 +123,34 @@ char KX126::get_rawval(unsigned char *data)
   return (rc);
 }
 
+/**
+ * Read x, y, z as signed counts, see get_sensitivity for counts per g
+ */
+char KX126::get_rawval(int16_t *data)
+{
+  char rc;
+  unsigned char val[6];
+
+  rc = get_rawval(val);
+  if (rc != 0) {
+    return (rc);
+  }
+
+  data[0] = (int16_t)(((uint16_t)val[1] << 8) | val[0]);
+  data[1] = (int16_t)(((uint16_t)val[3] << 8) | val[2]);
+  data[2] = (int16_t)(((uint16_t)val[5] << 8) | val[4]);
+
+  return (rc);
+}
+
+/**
+ * Counts per g for the configured range
+ */
+unsigned short KX126::get_sensitivity(void)
+{
+  return (_g_sens);
+}
+
 char KX126::get_val(float *data)
 {
   char rc;
@@ -146,6 +174,148 @@ char KX126::get_val(float *data)
   return (rc);
 }
 
+/**
+ * Switch to buffered sampling: the sensor samples at its own ODR into the
+ * hardware sample buffer (FIFO mode, 16bit), which is drained in bursts with
+ * get_buffer_rawval. The watermark is the buffer level in samples at which
+ * the buffer full interrupt would fire.
+ */
+char KX126::init_buffer(uint8_t odr, uint8_t watermark)
+{
+  return set_config(odr & KX126_ODCNTL_OSAMASK, watermark, KX126_BUF_CNTL2_VAL);
+}
+
+/**
+ * Back to register sampling at the default ODR, as set up by init
+ */
+char KX126::disable_buffer(void)
+{
+  return set_config(KX126_ODCNTL_VAL, 0, 0);
+}
+
+char KX126::set_config(uint8_t odcntl, uint8_t buf_cntl1, uint8_t buf_cntl2)
+{
+  char rc;
+  unsigned char cntl1;
+  unsigned char reg;
+
+  // Configuration registers can only be changed in stand-by
+  rc = read(KX126_CNTL1, &cntl1, sizeof(cntl1));
+  if (rc != 0) {
+    return (rc);
+  }
+  reg = cntl1 & ~KX126_CNTL1_PC1;
+  rc = write(KX126_CNTL1, &reg, sizeof(reg));
+  if (rc != 0) {
+    return (rc);
+  }
+
+  reg = odcntl;
+  rc = write(KX126_ODCNTL, &reg, sizeof(reg));
+  if (rc != 0) {
+    return (rc);
+  }
+
+  reg = buf_cntl1;
+  rc = write(KX126_BUF_CNTL1, &reg, sizeof(reg));
+  if (rc != 0) {
+    return (rc);
+  }
+
+  reg = buf_cntl2;
+  rc = write(KX126_BUF_CNTL2, &reg, sizeof(reg));
+  if (rc != 0) {
+    return (rc);
+  }
+
+  rc = clear_buffer();
+  if (rc != 0) {
+    return (rc);
+  }
+
+  reg = cntl1 | KX126_CNTL1_PC1;
+  rc = write(KX126_CNTL1, &reg, sizeof(reg));
+
+  return (rc);
+}
+
+char KX126::clear_buffer(void)
+{
+  unsigned char reg = 0;
+
+  // Any write to BUF_CLEAR empties the buffer
+  return write(KX126_BUF_CLEAR, &reg, sizeof(reg));
+}
+
+/**
+ * Number of samples waiting in the hardware buffer, negative on error
+ */
+int KX126::get_buffer_count(void)
+{
+  char rc;
+  unsigned char status[2];
+
+  rc = read(KX126_BUF_STATUS_1, status, sizeof(status));
+  if (rc != 0) {
+    return (-1);
+  }
+
+  return (((status[1] & KX126_BUF_STATUS_2_SMP_LEV_H) << 8) | status[0]) / KX126_BUF_SAMPLE_SIZE;
+}
+
+/**
+ * Drain up to max_samples x, y, z samples from the hardware buffer in a
+ * single I2C burst. Returns the number of samples read, negative on error.
+ */
+int KX126::get_buffer_rawval(int16_t *data, uint16_t max_samples)
+{
+  int count;
+  uint8_t *bytes = (uint8_t *)data;
+
+  count = get_buffer_count();
+  if (count <= 0) {
+    return (count);
+  }
+  if (count > max_samples) {
+    count = max_samples;
+  }
+
+  // BUF_READ does not auto increment, the whole burst comes from the buffer
+  if (Wire.readRegisters(_device_address, KX126_BUF_READ, bytes, count * KX126_BUF_SAMPLE_SIZE) != 0) {
+    return (-1);
+  }
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  // Samples are little endian
+  for (int i = 0; i < count * 3; i++) {
+    data[i] = (int16_t)(((uint16_t)bytes[2 * i + 1] << 8) | bytes[2 * i]);
+  }
+#endif
+
+  return (count);
+}
+
+/**
+ * Convert raw samples from get_buffer_rawval to g
+ */
+void KX126::convert_val(const int16_t *raw, float *data, uint16_t n_samples)
+{
+  const float scale = 1.0f / _g_sens;
+  uint32_t n_values = n_samples * 3;
+  uint32_t i = 0;
+
+  // _g_sens is a power of 2, so this matches the division in get_val exactly
+  for (; i + 4 <= n_values; i += 4) {
+    data[i + 0] = (float)raw[i + 0] * scale;
+    data[i + 1] = (float)raw[i + 1] * scale;
+    data[i + 2] = (float)raw[i + 2] * scale;
+    data[i + 3] = (float)raw[i + 3] * scale;
+  }
+  for (; i < n_values; i++) {
+    data[i] = (float)raw[i] * scale;
+  }
+}
+
 char KX126::write(uint8_t memory_address, uint8_t *data, uint8_t len)
 {
   char rc;
@@ -177,4 +347,4 @@ char KX126::read(uint8_t memory_address, uint8_t *data, uint8_t len)
   }
 
   return (0);
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -29,6 +29,12 @@
 #define KX126_CNTL1               (0x1A)
 #define KX126_CNTL2               (0x1B)
 #define KX126_ODCNTL              (0x1F)
+#define KX126_BUF_CNTL1           (0x5A)
+#define KX126_BUF_CNTL2           (0x5B)
+#define KX126_BUF_STATUS_1        (0x5C)
+#define KX126_BUF_STATUS_2        (0x5D)
+#define KX126_BUF_CLEAR           (0x5E)
+#define KX126_BUF_READ            (0x5F)
 
 #define KX126_CNTL1_TPE           (1 << 0)
 #define KX126_CNTL1_PDE           (1 << 1)
@@ -43,13 +49,33 @@
 
 #define KX126_CNTL2_SRST          (1 << 7)
 
+#define KX126_ODCNTL_OSA_12_5HZ   (0)
+#define KX126_ODCNTL_OSA_25HZ     (1)
 #define KX126_ODCNTL_OSA_50HZ     (2)
+#define KX126_ODCNTL_OSA_100HZ    (3)
+#define KX126_ODCNTL_OSA_200HZ    (4)
+#define KX126_ODCNTL_OSA_400HZ    (5)
+#define KX126_ODCNTL_OSA_800HZ    (6)
 #define KX126_ODCNTL_OSA_1600HZ    (7)
+#define KX126_ODCNTL_OSA_3200HZ   (12)
+#define KX126_ODCNTL_OSA_6400HZ   (13)
+#define KX126_ODCNTL_OSAMASK      (0x0F)
 #define KX126_ODCNTL_LPRO         (1 << 6)
 #define KX126_IIR_BYPASS          (1 << 7)
 
+#define KX126_BUF_CNTL2_BUFE      (1 << 7)
+#define KX126_BUF_CNTL2_BRES      (1 << 6)
+#define KX126_BUF_CNTL2_BFIE      (1 << 5)
+#define KX126_BUF_CNTL2_BM_FIFO   (0)
+#define KX126_BUF_CNTL2_BM_STREAM (1)
+
+#define KX126_BUF_STATUS_2_SMP_LEV_H  (0x07)
+
 #define KX126_CNTL1_VAL           (KX126_CNTL1_RES | KX126_CNTL1_GSEL_2G)
 #define KX126_ODCNTL_VAL          (KX126_ODCNTL_OSA_1600HZ)
+#define KX126_BUF_CNTL2_VAL       (KX126_BUF_CNTL2_BUFE | KX126_BUF_CNTL2_BRES | KX126_BUF_CNTL2_BM_FIFO)
+
+#define KX126_BUF_SAMPLE_SIZE     (6)       // 16bit x, y, z
 
 
 class KX126
@@ -59,12 +85,21 @@ class KX126
     ~KX126();
     char init(void);
     char get_rawval(unsigned char *data);
+    char get_rawval(int16_t *data);
     char get_val(float *data);
+    unsigned short get_sensitivity(void);
+    char init_buffer(uint8_t odr, uint8_t watermark);
+    char disable_buffer(void);
+    char clear_buffer(void);
+    int get_buffer_count(void);
+    int get_buffer_rawval(int16_t *data, uint16_t max_samples);
+    void convert_val(const int16_t *raw, float *data, uint16_t n_samples);
     char write(uint8_t memory_address, uint8_t *data, uint8_t len);
     char read(uint8_t memory_address, uint8_t *data, uint8_t len);
   private:
+    char set_config(uint8_t odcntl, uint8_t buf_cntl1, uint8_t buf_cntl2);
     uint8_t _device_address;
     unsigned short _g_sens;
 };
 
-#endif // _KX126_H_
\ No newline at end of file
+#endif // _KX126_H_
\ No newline at end of file
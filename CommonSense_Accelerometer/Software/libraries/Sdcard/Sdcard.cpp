@@ -539,6 +539,50 @@ int sdcard_read_end() {
 }
 
 
+int sdcard_write_erase_count(uint32_t count) {
+    sdcard_select();
+
+    if(sdcard_wait_not_busy() < 0) { // keep this!
+        sdcard_unselect();
+        return -1;
+    }
+
+    {
+        static const uint8_t cmd[] =
+            { 0x40 | 0x37 /* CMD55 */, 0x00, 0x00, 0x00, 0x00 /* ARG */, (0x7F << 1) | 1 /* CRC7 + end bit */ };
+        HAL_SPI_Transmit(nullptr, (uint8_t*)cmd, sizeof(cmd), HAL_MAX_DELAY);
+    }
+
+    if(sdcard_read_r1() != 0x00) {
+        sdcard_unselect();
+        return -2;
+    }
+
+    if(sdcard_wait_not_busy() < 0) { // keep this!
+        sdcard_unselect();
+        return -3;
+    }
+
+    /* ACMD23 (SET_WR_BLK_ERASE_COUNT) command, 23 bits of block count */
+    uint8_t cmd[] = {
+        0x40 | 0x17 /* ACMD23 */,
+        0x00, /* ARG */
+        (count >> 16) & 0x7F,
+        (count >> 8) & 0xFF,
+        count & 0xFF,
+        (0x7F << 1) | 1 /* CRC7 + end bit */
+    };
+    HAL_SPI_Transmit(nullptr, (uint8_t*)cmd, sizeof(cmd), HAL_MAX_DELAY);
+
+    if(sdcard_read_r1() != 0x00) {
+        sdcard_unselect();
+        return -4;
+    }
+
+    sdcard_unselect();
+    return 0;
+}
+
 int sdcard_write_begin(uint32_t block_num) {
     sdcard_select();
 
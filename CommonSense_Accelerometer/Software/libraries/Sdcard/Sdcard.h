@@ -102,6 +102,14 @@ int sdcard_read_end(void);
 
 // Write Multiple Blocks
 
+/**
+ * @brief  Tell the card how many blocks the next multiple block write covers
+ *         (ACMD23), so it can pre-erase them. Call right before sdcard_write_begin
+ * @param  [in] count number of blocks
+ * @retval 0 on success, < 0 on failure
+ */
+int sdcard_write_erase_count(uint32_t count);
+
 /**
  * @brief  Start writing of moltiple blocks
  * @param  [in] block_num block number
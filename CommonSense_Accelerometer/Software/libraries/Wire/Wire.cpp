@@ -184,6 +184,36 @@ uint8_t TwoWire::endTransmission(bool sendStop)
     return (ret < 0) ? TWI_OTHER_ERROR : TWI_SUCCESS;
 }
 
+// Write the register address and read length bytes straight into data,
+// in one transfer with a repeated start. Not limited to TWI_RX_BUF_LEN,
+// meant for burst reads from sensor FIFOs.
+uint8_t TwoWire::readRegisters(uint8_t address, uint8_t reg, uint8_t* data, size_t length)
+{
+    struct i2c_msg_s msg[2];
+    int ret;
+
+    if (!_dev) return TWI_OTHER_ERROR;
+
+    msg[0].frequency = _freq;
+    msg[0].addr      = address;
+    msg[0].flags     = I2C_M_NOSTOP;
+    msg[0].buffer    = &reg;
+    msg[0].length    = 1;
+
+    msg[1].frequency = _freq;
+    msg[1].addr      = address;
+    msg[1].flags     = I2C_M_READ;
+    msg[1].buffer    = data;
+    msg[1].length    = length;
+
+    ret = I2C_TRANSFER(_dev, msg, 2);
+    if (ret == -ENODEV) {
+        // device not found
+        return TWI_NACK_ON_ADDRESS;
+    }
+    return (ret < 0) ? TWI_OTHER_ERROR : TWI_SUCCESS;
+}
+
 // must be called in:
 // slave rx event callback
 // or after requestFrom(address, numBytes)
@@ -1,6 +1,15 @@
 #include <stdio.h>
+#include <string.h>
 #include <sys/boardctl.h>
+#include <sys/ioctl.h>
 #include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <nuttx/timers/timer.h>
+#include <nuttx/irq.h>
 #include <arch/board/board.h>
 #include <arch/cxd56xx/pin.h>
 #include <cxd56_uart.h>
@@ -42,9 +51,32 @@ extern "C" void spresense_time_cb(uint32_t *sec, uint32_t *nano);
 #define getreg32(a)     (*(volatile uint32_t *)(a))
 #define CONSOLE_BASE    CXD56_UART1_BASE
 
+/* Console transmit buffer on the UART1 registers, see uart_tx.h */
+#define UART_TX_FIFO_FULL()     (getreg32(CONSOLE_BASE + CXD56_UART_FR) & UART_FLAG_TXFF)
+#define UART_TX_BUSY()          (getreg32(CONSOLE_BASE + CXD56_UART_FR) & UART_FLAG_BUSY)
+#define UART_TX_PUT(byte)       putreg32((uint32_t)(byte), CONSOLE_BASE + CXD56_UART_DR)
+#include "uart_tx.h"
+
+/* Hardware timer used to pace sensor sampling */
+#define SAMPLE_TIMER_DEVPATH    "/dev/timer0"
+#define SAMPLE_TIMER_SIGNO      2
+#define SAMPLE_TIMER_PRIORITY   200
+
+/* Largest burst read from the accelerometer sample buffer */
+#define ACC_BUFFER_MAX_SAMPLES  64
+
 /* Private variables ------------------------------------------------------- */
 KX126 kx126(KX126_DEVICE_ADDRESS_1F);
 
+/* Accelerometer sample buffer */
+static int16_t acc_buffer_raw[ACC_BUFFER_MAX_SAMPLES * 3];
+
+/* Sample timer variables */
+static int sample_timer_fd = -1;
+static pthread_t sample_timer_pid = -1;
+static sem_t sample_timer_sem;
+static void (* volatile sample_timer_tick)(void) = NULL;
+
 /* Audio variables */
 //AudioClass *theAudio;
 static const int32_t buffer_size = 1600; /*768sample,1ch,16bit*/
@@ -105,6 +137,7 @@ extern "C" int spresense_main(void)
     boardctl(BOARDIOC_INIT, 0);
 
     disable_uart_irq();
+    start_uart_tx();
     handle_sony_id();
 
     tests();
@@ -151,6 +184,23 @@ char spresense_getchar(void)
     }
 }
 
+/**
+ * @brief Get a byte directly from the UART, binary safe
+ *
+ * @return int received byte, -1 if the receive FIFO is empty
+ */
+int spresense_getbyte(void)
+{
+    uint32_t reg = 0;
+    reg = getreg32(CONSOLE_BASE + CXD56_UART_FR);
+    if ((UART_FR_RXFE & reg) && !(UART_FR_RXFF & reg)) {
+        return -1;
+    }
+    else {
+        return (int)(getreg32(CONSOLE_BASE + CXD56_UART_DR) & 0xFF);
+    }
+}
+
 /**
  * @brief Write a byte straight to the UART DR register
  *
@@ -192,6 +242,202 @@ int spresense_getAcc(float acc_val[3])
     return (int)kx126.get_val(acc_val);
 }
 
+/**
+ * @brief Read the accelerometer as raw counts, see spresense_getAccResolution
+ */
+int spresense_getAccRaw(int16_t acc_raw[3])
+{
+    return (int)kx126.get_rawval(acc_raw);
+}
+
+/**
+ * @brief Accelerometer resolution in g per count
+ */
+float spresense_getAccResolution(void)
+{
+    return 1.0f / kx126.get_sensitivity();
+}
+
+/**
+ * @brief Let the accelerometer sample into its hardware buffer at odr_hz
+ *
+ * @param odr_hz sample rate, must be one of the KX126 output data rates
+ * @param watermark buffer level in samples
+ * @return false if the rate is not supported, keep using spresense_getAcc
+ */
+bool spresense_startAccBuffer(float odr_hz, uint8_t watermark)
+{
+    static const struct { float hz; uint8_t osa; } odr_table[] = {
+        { 12.5f, KX126_ODCNTL_OSA_12_5HZ }, { 25.f, KX126_ODCNTL_OSA_25HZ },
+        { 50.f, KX126_ODCNTL_OSA_50HZ }, { 100.f, KX126_ODCNTL_OSA_100HZ },
+        { 200.f, KX126_ODCNTL_OSA_200HZ }, { 400.f, KX126_ODCNTL_OSA_400HZ },
+        { 800.f, KX126_ODCNTL_OSA_800HZ }, { 1600.f, KX126_ODCNTL_OSA_1600HZ },
+        { 3200.f, KX126_ODCNTL_OSA_3200HZ }, { 6400.f, KX126_ODCNTL_OSA_6400HZ },
+    };
+
+    for (size_t i = 0; i < sizeof(odr_table) / sizeof(odr_table[0]); i++) {
+        float diff = odr_hz - odr_table[i].hz;
+        if (diff < 0.f) {
+            diff = -diff;
+        }
+        if (diff <= odr_table[i].hz * 0.001f) {
+            return kx126.init_buffer(odr_table[i].osa, watermark) == 0;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Read all samples waiting in the accelerometer buffer in one burst
+ *
+ * @param acc_val x, y, z values in g
+ * @param max_samples room in acc_val, in samples
+ * @return number of samples read, negative on error
+ */
+int spresense_getAccBuffer(float *acc_val, uint16_t max_samples)
+{
+    if (max_samples > ACC_BUFFER_MAX_SAMPLES) {
+        max_samples = ACC_BUFFER_MAX_SAMPLES;
+    }
+
+    int count = kx126.get_buffer_rawval(acc_buffer_raw, max_samples);
+    if (count > 0) {
+        kx126.convert_val(acc_buffer_raw, acc_val, (uint16_t)count);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Read all samples waiting in the accelerometer buffer in one burst, as raw counts
+ *
+ * @param acc_raw x, y, z counts
+ * @param max_samples room in acc_raw, in samples
+ * @return number of samples read, negative on error
+ */
+int spresense_getAccBufferRaw(int16_t *acc_raw, uint16_t max_samples)
+{
+    return kx126.get_buffer_rawval(acc_raw, max_samples);
+}
+
+/**
+ * @brief Back to reading single samples with spresense_getAcc
+ */
+void spresense_stopAccBuffer(void)
+{
+    kx126.disable_buffer();
+}
+
+/**
+ * @brief Sample timer thread. The timer driver signals this thread on every
+ * period; sensor reads go over I2C so they cannot be done from the timer irq.
+ */
+static void *sample_timer_daemon(void *arg)
+{
+    sigset_t set;
+    int sem_value;
+
+    (void)arg;
+
+    sigemptyset(&set);
+    sigaddset(&set, SAMPLE_TIMER_SIGNO);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+
+    for (; ; ) {
+        if (sigwaitinfo(&set, NULL) != SAMPLE_TIMER_SIGNO) {
+            continue;
+        }
+
+        void (*tick)(void) = sample_timer_tick;
+        if (tick) {
+            tick();
+        }
+
+        /* Wake the reader, but don't let the count run away while it is busy */
+        if ((sem_getvalue(&sample_timer_sem, &sem_value) == 0) && (sem_value <= 0)) {
+            sem_post(&sample_timer_sem);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start calling tick every interval_us from the sample timer thread
+ *
+ * @param interval_us sample period in microseconds
+ * @param tick called from the sample timer thread
+ * @return true success
+ */
+bool spresense_startSampleTimer(uint32_t interval_us, void (*tick)(void))
+{
+    struct timer_notify_s notify;
+
+    if (sample_timer_fd < 0) {
+        sample_timer_fd = open(SAMPLE_TIMER_DEVPATH, O_RDONLY);
+        if (sample_timer_fd < 0) {
+            printf("ERROR: Failed to open %s (errno=%d)\r\n", SAMPLE_TIMER_DEVPATH, errno);
+            return false;
+        }
+        sem_init(&sample_timer_sem, 0, 0);
+    }
+
+    if (sample_timer_pid < 0) {
+        struct sched_param param;
+        pthread_attr_t attr;
+
+        pthread_attr_init(&attr);
+        attr.stacksize = 2048;
+        param.sched_priority = SAMPLE_TIMER_PRIORITY;
+        pthread_attr_setschedparam(&attr, &param);
+
+        if (pthread_create(&sample_timer_pid, &attr, sample_timer_daemon, NULL) != 0) {
+            sample_timer_pid = -1;
+            return false;
+        }
+        pthread_setname_np(sample_timer_pid, "sample_timer");
+    }
+
+    ioctl(sample_timer_fd, TCIOC_STOP, 0);
+    sample_timer_tick = tick;
+    while (sem_trywait(&sample_timer_sem) == 0);
+
+    notify.pid = (pid_t)sample_timer_pid;
+    notify.event.sigev_notify = SIGEV_SIGNAL;
+    notify.event.sigev_signo = SAMPLE_TIMER_SIGNO;
+    notify.event.sigev_value.sival_int = 0;
+
+    if ((ioctl(sample_timer_fd, TCIOC_SETTIMEOUT, (unsigned long)interval_us) < 0) ||
+        (ioctl(sample_timer_fd, TCIOC_NOTIFICATION, (unsigned long)((uintptr_t)&notify)) < 0) ||
+        (ioctl(sample_timer_fd, TCIOC_START, 0) < 0)) {
+        printf("ERROR: Failed to start sample timer (errno=%d)\r\n", errno);
+        sample_timer_tick = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Stop the sample timer, the thread stays parked for the next start
+ */
+void spresense_stopSampleTimer(void)
+{
+    if (sample_timer_fd >= 0) {
+        ioctl(sample_timer_fd, TCIOC_STOP, 0);
+    }
+    sample_timer_tick = NULL;
+}
+
+/**
+ * @brief Block until the sample timer thread has handled its next period
+ */
+void spresense_waitSampleTimer(void)
+{
+    while ((sem_wait(&sample_timer_sem) != 0) && (errno == EINTR));
+}
+
 /**
  * @brief Create audio instance and setup audio channel
  * @details Uses PCM format MONO @ 16KHz
@@ -294,7 +540,9 @@ extern "C" bool spresense_openFile(const char *name, bool write)
         SdFile.close();
     }
 
-    SdFile = write == true ? File(name, FILE_WRITE) : File(name);
+    /* FILE_WRITE opens in append mode, which ignores seek(). Samples are
+     * written at their address, so open for in-place read/write instead */
+    SdFile = write == true ? File(name, O_RDWR | O_CREAT) : File(name);
 
     /* Check if opened & set to start position */
     if (SdFile) {
@@ -308,6 +556,23 @@ extern "C" bool spresense_openFile(const char *name, bool write)
     return success;
 }
 
+/**
+ * @brief Move the read/write position of the opened file
+ *
+ * @param name
+ * @param position byte offset from the start of the file
+ * @return true success
+ */
+extern "C" bool spresense_seekFile(const char *name, uint32_t position)
+{
+    if (!SdFile) {
+        printf("File %s not open\r\n", name);
+        return false;
+    }
+
+    return SdFile.seek(position);
+}
+
 /**
  * @brief Close the file
  *
@@ -464,6 +729,7 @@ static void empty_audio_fifo(void)
  */
 void set_max_data_output_baudrate_c()
 {
+    spresense_flushTx();
     cxd56_setbaud(CONSOLE_BASE, BOARD_UART1_BASEFREQ, MAX_BAUD);
 }
 
@@ -472,5 +738,6 @@ void set_max_data_output_baudrate_c()
  */
 void set_default_data_output_baudrate_c()
 {
+    spresense_flushTx();
     cxd56_setbaud(CONSOLE_BASE, BOARD_UART1_BASEFREQ, DEFAULT_BAUD);
 }
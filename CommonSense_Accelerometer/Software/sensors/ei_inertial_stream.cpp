@@ -0,0 +1,197 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ei_config_types.h"
+#include "ei_inertial_stream.h"
+#include "ei_inertialsensor.h"
+#include "ei_device_sony_spresense.h"
+#include "firmware-sdk/at_frame_lib.h"
+#include "firmware-sdk/ei_device_interface.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define STREAM_HEADER_SIZE      18
+#define STREAM_SAMPLE_SIZE      (N_AXIS_SAMPLED * sizeof(int16_t))
+#define STREAM_MAX_SAMPLES      ((EI_FRAME_MAX_PAYLOAD - STREAM_HEADER_SIZE) / STREAM_SAMPLE_SIZE)
+
+extern ei_config_t *ei_config_get_config();
+
+/* Private variables ------------------------------------------------------- */
+static uint8_t stream_frame[EI_FRAME_HEADER_SIZE + EI_FRAME_MAX_PAYLOAD + EI_FRAME_CRC_SIZE];
+static uint8_t stream_seq;
+static uint32_t stream_serial_dropped;
+
+/* Private functions ------------------------------------------------------- */
+
+static void put_le(uint8_t *out, uint64_t value, int size)
+{
+    for (int i = 0; i < size; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static int16_t stream_quantize(float value, float scale)
+{
+    float v = value * scale;
+
+    if (v >= 32767.f) {
+        return 32767;
+    }
+    if (v <= -32768.f) {
+        return -32768;
+    }
+    return (int16_t)(v >= 0.f ? v + 0.5f : v - 0.5f);
+}
+
+/**
+ * @brief      Complete the frame header and queue it for the serial port.
+ *             If it does not fit in the transmit buffer it is dropped.
+ */
+static void stream_send(uint64_t timestamp_us, uint16_t n_samples)
+{
+    uint8_t *payload = &stream_frame[EI_FRAME_HEADER_SIZE];
+
+    put_le(&payload[0], timestamp_us, 8);
+    put_le(&payload[8], n_samples, 2);
+    put_le(&payload[10], ei_inertial_get_dropped_samples(), 4);
+    put_le(&payload[14], stream_serial_dropped, 4);
+
+    size_t size = ei_frame_encode(stream_frame, EI_FRAME_TYPE_STREAM, stream_seq++,
+        STREAM_HEADER_SIZE + n_samples * STREAM_SAMPLE_SIZE);
+
+    uint32_t dropped_bytes = ei_serial_get_tx_dropped();
+    ei_write_string((char *)stream_frame, (int)size);
+    if (ei_serial_get_tx_dropped() != dropped_bytes) {
+        stream_serial_dropped += n_samples;
+    }
+}
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief      Sample and stream until the host sends 'b'
+ *
+ * @param[in]  sample_interval_ms  The sample interval milliseconds
+ *
+ * @return     false if sampling could not start or the sensor failed
+ */
+bool ei_inertial_stream(float sample_interval_ms)
+{
+    const float scale_acc = 1e6f / EI_STREAM_ACC_LSB_UM_S2;
+    const float scale_gyr = 1e3f / EI_STREAM_GYR_LSB_MDPS;
+    ei_inertial_sample_t sample;
+    uint64_t frame_start_us = 0;
+    uint16_t n_samples = 0;
+    uint32_t n_streamed = 0;
+    bool success = true;
+
+    stream_seq = 0;
+    stream_serial_dropped = 0;
+
+    /* drop whatever followed the AT command */
+    while (ei_get_serial_byte() >= 0);
+
+    if (ei_inertial_sample_start(NULL, sample_interval_ms) == false) {
+        return false;
+    }
+
+    ei_printf("STREAM %d,%d,%lu,%d,%d\r\n", EI_STREAM_VERSION, N_AXIS_SAMPLED,
+        (unsigned long)((sample_interval_ms * 1000.f) + 0.5f), EI_STREAM_ACC_LSB_UM_S2, EI_STREAM_GYR_LSB_MDPS);
+
+    ei_serial_set_tx_drop(true);
+
+    while (ei_get_serial_byte() != 'b') {
+        if (ei_inertial_read_sample(&sample) != 0) {
+            success = false;
+            break;
+        }
+
+        if (n_samples == 0) {
+            frame_start_us = sample.timestamp_us;
+        }
+
+        uint8_t *out = &stream_frame[EI_FRAME_HEADER_SIZE + STREAM_HEADER_SIZE + n_samples * STREAM_SAMPLE_SIZE];
+        for (int i = 0; i < N_AXIS_SAMPLED; i++) {
+            put_le(&out[i * 2], (uint16_t)stream_quantize(sample.data[i], i < 3 ? scale_acc : scale_gyr), 2);
+        }
+        n_samples++;
+        n_streamed++;
+
+        if ((n_samples == STREAM_MAX_SAMPLES) ||
+            ((sample.timestamp_us - frame_start_us) >= (EI_STREAM_FRAME_MS * 1000))) {
+            stream_send(frame_start_us, n_samples);
+            n_samples = 0;
+        }
+    }
+
+    if (n_samples > 0) {
+        stream_send(frame_start_us, n_samples);
+    }
+
+    ei_serial_set_tx_drop(false);
+    ei_inertial_sample_stop();
+    EiDevice.set_state(eiStateFinished);
+
+    ei_printf("\r\nStreamed %lu samples, dropped %lu (sampler), %lu (serial)\r\n",
+        (unsigned long)n_streamed, (unsigned long)ei_inertial_get_dropped_samples(),
+        (unsigned long)stream_serial_dropped);
+
+    if (!success) {
+        ei_printf("ERR: Failed to read the sensor\r\n");
+    }
+
+    return success;
+}
+
+/**
+ * @brief      AT+STREAM= handler
+ *
+ * @param      interval_s   Sample interval in ms, 0 uses the configured interval
+ * @param      baudrate_s   'y' to stream at the maximum baud rate
+ */
+void ei_inertial_stream_at(char *interval_s, char *baudrate_s)
+{
+    float interval_ms = (float)atof(interval_s);
+    if (interval_ms <= 0.f) {
+        interval_ms = ei_config_get_config()->sample_interval_ms;
+    }
+
+    bool use_max_baudrate = (baudrate_s[0] == 'y');
+
+    if (use_max_baudrate) {
+        ei_printf("OK\r\n");
+        EiDevice.delay_ms(100);
+        EiDevice.set_max_data_output_baudrate();
+        EiDevice.delay_ms(100);
+    }
+
+    ei_inertial_stream(interval_ms);
+
+    if (use_max_baudrate) {
+        EiDevice.delay_ms(100);
+        EiDevice.set_default_data_output_baudrate();
+        EiDevice.delay_ms(100);
+    }
+}
@@ -0,0 +1,70 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EI_INERTIAL_STREAM_H
+#define EI_INERTIAL_STREAM_H
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Live streaming of the inertial samples, started with AT+STREAM=.
+ *
+ * The device answers with one text line
+ *
+ *     STREAM <version>,<axes>,<interval us>,<acc lsb um/s2>,<gyr lsb mdps>\r\n
+ *
+ * followed by EI_FRAME_TYPE_STREAM frames (see at_frame_lib.h), which are
+ * not acknowledged. The payload of each frame, little endian:
+ *
+ *     u64 timestamp of the first sample (us)
+ *     u16 number of samples
+ *     u32 samples dropped by the sampler since the start (reader too slow)
+ *     u32 samples dropped on the serial port since the start (host too slow)
+ *     i16 samples[n][axes]
+ *
+ * A frame is sent every EI_STREAM_FRAME_MS or when it is full. When the
+ * serial transmit buffer has no room, the frame is dropped as a whole and
+ * counted, sampling never waits for the host. Streaming stops when the
+ * host sends 'b'.
+ */
+
+#define EI_STREAM_VERSION           1
+
+#ifndef EI_STREAM_FRAME_MS
+#define EI_STREAM_FRAME_MS          100
+#endif
+
+/** Resolution of the streamed values */
+#ifndef EI_STREAM_ACC_LSB_UM_S2
+#define EI_STREAM_ACC_LSB_UM_S2     2000    /* 0.002 m/s2, range +-65 m/s2 */
+#endif
+#ifndef EI_STREAM_GYR_LSB_MDPS
+#define EI_STREAM_GYR_LSB_MDPS      100     /* 0.1 dps, range +-3276 dps */
+#endif
+
+/* Function prototypes ----------------------------------------------------- */
+bool ei_inertial_stream(float sample_interval_ms);
+void ei_inertial_stream_at(char *interval_s, char *baudrate_s);
+
+#endif
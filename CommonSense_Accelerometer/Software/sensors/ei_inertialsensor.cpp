@@ -27,43 +27,308 @@
 #include "ei_config_types.h"
 #include "ei_inertialsensor.h"
 #include "ei_device_sony_spresense.h"
+#include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#include "edge-impulse-sdk/dsp/ei_profiler.h"
 #include "sensor_aq.h"
+#include "ei_sample_ring.h"
+#if EI_INERTIAL_DEVICE == EI_INERTIAL_DEVICE_LSM6DSO32
+#include "ei_lsm6dso32.h"
+#endif
 
 /* Constant defines -------------------------------------------------------- */
 #define CONVERT_G_TO_MS2    9.80665f
 
-#define ACC_SAMPLE_TIME_MS  0.49922f
-#define FLASH_WRITE_TIME_MS 5.288f
+/* Hardware buffer mode: drain the sensor every BURST_PERIOD_MS, at most BURST_MAX_SAMPLES at once */
+#define BURST_PERIOD_MS         100
+#define BURST_MAX_SAMPLES       64
 
 extern ei_config_t *ei_config_get_config();
 extern EI_CONFIG_ERROR ei_config_set_sample_interval(float interval);
 
+#if EI_INERTIAL_DEVICE == EI_INERTIAL_DEVICE_LSM6DSO32
+/* Accelerometer in g followed by gyroscope in dps, FIFO entries are tagged and paired */
+#define sensor_read             ei_lsm6dso32_read
+#define sensor_buffer_start     ei_lsm6dso32_fifo_start
+#define sensor_buffer_read      ei_lsm6dso32_fifo_read
+#define sensor_buffer_stop      ei_lsm6dso32_fifo_stop
+#elif EI_INERTIAL_RAW_COUNTS == 1
+/* Accelerometer in counts, spresense_getAccResolution g per count */
+extern int spresense_getAccRaw(int16_t acc_raw[3]);
+extern float spresense_getAccResolution(void);
+extern bool spresense_startAccBuffer(float odr_hz, uint8_t watermark);
+extern int spresense_getAccBufferRaw(int16_t *acc_raw, uint16_t max_samples);
+extern void spresense_stopAccBuffer(void);
+
+#define sensor_read             spresense_getAccRaw
+#define sensor_buffer_start     spresense_startAccBuffer
+#define sensor_buffer_read      spresense_getAccBufferRaw
+#define sensor_buffer_stop      spresense_stopAccBuffer
+#else
 extern int spresense_getAcc(float acc_val[3]);
+extern bool spresense_startAccBuffer(float odr_hz, uint8_t watermark);
+extern int spresense_getAccBuffer(float *acc_val, uint16_t max_samples);
+extern void spresense_stopAccBuffer(void);
+
+#define sensor_read             spresense_getAcc
+#define sensor_buffer_start     spresense_startAccBuffer
+#define sensor_buffer_read      spresense_getAccBuffer
+#define sensor_buffer_stop      spresense_stopAccBuffer
+#endif
+
+/* What the sensor functions deliver and the ring holds, converted by the reader */
+#if EI_INERTIAL_RAW_COUNTS == 1
+typedef int16_t raw_format_t;
+#else
+typedef float raw_format_t;
+#endif
+
+typedef struct {
+    uint64_t timestamp_us;
+    raw_format_t data[N_AXIS_SAMPLED];
+} raw_sample_t;
+
+#if defined(EI_INERTIAL_SIMULATED_CLOCK) && (EI_INERTIAL_SIMULATED_CLOCK == 1)
+static bool sample_timer_start(uint32_t interval_us, void (*tick)(void));
+static void sample_timer_stop(void);
+static void sample_timer_wait(void);
+static uint64_t sample_timer_now_us(void);
+#else
+extern bool spresense_startSampleTimer(uint32_t interval_us, void (*tick)(void));
+extern void spresense_stopSampleTimer(void);
+extern void spresense_waitSampleTimer(void);
+
+#define sample_timer_start  spresense_startSampleTimer
+#define sample_timer_stop   spresense_stopSampleTimer
+#define sample_timer_wait   spresense_waitSampleTimer
+#define sample_timer_now_us ei_read_timer_us
+#endif
 
 /* Private variables ------------------------------------------------------- */
-static uint32_t samplerate_divider;
+static EiSampleRing<raw_sample_t, EI_INERTIAL_RING_SIZE> sample_ring;
+static uint32_t dropped_samples;
+static bool sensor_error;
+static bool sampling;
+static bool burst_mode;
+static uint32_t sample_interval_us;
+static raw_format_t burst_data[BURST_MAX_SAMPLES * N_AXIS_SAMPLED];
 static float imu_data[N_AXIS_SAMPLED];
 
 sampler_callback  cb_sampler;
 
+/**
+ * @brief      Acceleration in sensor units to m/s2
+ */
+static float raw_acc_scale(void)
+{
+#if EI_INERTIAL_RAW_COUNTS == 1
+    return CONVERT_G_TO_MS2 * spresense_getAccResolution();
+#else
+    return CONVERT_G_TO_MS2;
+#endif
+}
 
 /**
- * @brief      Get data from sensor, convert and call callback to handle
+ * @brief      Queue one sensor sample (acceleration in g or counts, then any
+ *             other axes) as is, the reader converts it
  */
-int ei_inertial_read_data(void)
+static void queue_sample(const raw_format_t *values, uint64_t timestamp_us)
 {
-    float acc_data[3];
-    volatile uint32_t div_sample_count;
+    raw_sample_t sample;
+
+    sample.timestamp_us = timestamp_us;
+    for (int i = 0; i < N_AXIS_SAMPLED; i++) {
+        sample.data[i] = values[i];
+    }
+
+    if (sample_ring.push(sample) == false) {
+        __atomic_add_fetch(&dropped_samples, 1, __ATOMIC_RELAXED);
+    }
+}
 
-    for (div_sample_count = 0; div_sample_count < samplerate_divider; div_sample_count++) {
-        if(spresense_getAcc(acc_data)) {
+/**
+ * @brief      Called by the sample timer on every period. Reads the sensor and
+ *             queues the timestamped sample for ei_inertial_read_data
+ */
+static void inertial_sample_tick(void)
+{
+    raw_format_t sensor_data[N_AXIS_SAMPLED];
+    uint64_t timestamp_us = sample_timer_now_us();
+    EI_PROFILER_STAGE_BEGIN(acquisition_mark);
+
+    if (burst_mode) {
+        int count = sensor_buffer_read(burst_data, BURST_MAX_SAMPLES);
+        if (count < 0) {
+            __atomic_store_n(&sensor_error, true, __ATOMIC_RELEASE);
+            return;
+        }
+
+        /* Newest sample was taken about now, the others one sensor period apart */
+        timestamp_us -= (uint64_t)(count - 1) * sample_interval_us;
+        for (int i = 0; i < count; i++) {
+            queue_sample(&burst_data[i * N_AXIS_SAMPLED], timestamp_us);
+            timestamp_us += sample_interval_us;
+        }
+        EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_ACQUISITION, acquisition_mark);
+        return;
+    }
+
+    if(sensor_read(sensor_data)) {
+        __atomic_store_n(&sensor_error, true, __ATOMIC_RELEASE);
+        return;
+    }
+
+    queue_sample(sensor_data, timestamp_us);
+    EI_PROFILER_STAGE_END(EI_PROFILER_STAGE_ACQUISITION, acquisition_mark);
+}
+
+/**
+ * @brief      Wait for the next sample from the sample timer, in sensor units
+ */
+static int read_raw_sample(raw_sample_t *sample)
+{
+    if (sampling == false) {
+        return -1;
+    }
+
+    while (sample_ring.pop(sample) == false) {
+        if (__atomic_load_n(&sensor_error, __ATOMIC_ACQUIRE)) {
             return -1;
         }
+        sample_timer_wait();
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      Wait for the next sample from the sample timer
+ *
+ * @param      sample  Filled with the oldest queued sample, acceleration in m/s2
+ *
+ * @return     0 on success, -1 if sampling is not started or the sensor failed
+ */
+int ei_inertial_read_sample(ei_inertial_sample_t *sample)
+{
+    raw_sample_t raw;
+
+    if (read_raw_sample(&raw) != 0) {
+        return -1;
+    }
+
+    float acc_scale = raw_acc_scale();
+
+    sample->timestamp_us = raw.timestamp_us;
+    for (int i = 0; i < N_AXIS_SAMPLED; i++) {
+        sample->data[i] = (float)raw.data[i] * (i < 3 ? acc_scale : 1.0f);
+    }
+
+    return 0;
+}
+
+#if EI_INERTIAL_RAW_COUNTS == 1
+/**
+ * @brief      Wait for the next sample from the sample timer, as counts
+ *
+ * @param      counts  Filled with the first axes of the oldest queued sample
+ * @param[in]  axes    Number of axes, at most N_AXIS_SAMPLED
+ *
+ * @return     0 on success, -1 if sampling is not started or the sensor failed
+ */
+int ei_inertial_read_counts(int16_t *counts, uint32_t axes)
+{
+    raw_sample_t raw;
+
+    if (axes > N_AXIS_SAMPLED || read_raw_sample(&raw) != 0) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < axes; i++) {
+        counts[i] = raw.data[i];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      Acceleration in m/s2 per count of ei_inertial_read_counts
+ */
+float ei_inertial_count_scale(void)
+{
+    return raw_acc_scale();
+}
+#endif
+
+/**
+ * @brief      Prepare a window for ei_inertial_read_window
+ *
+ * @param      window   The window
+ * @param      buffer   Room for axes * samples values
+ * @param[in]  samples  Samples per axis
+ * @param[in]  axes     Axes kept of every sample, at most N_AXIS_SAMPLED
+ * @param[in]  scale    Multiplier for every value, e.g. the scale of the DSP block
+ *
+ * @return     false if the axes are not available
+ */
+bool ei_inertial_window_init(ei_inertial_window_t *window, float *buffer, uint32_t samples, uint32_t axes, float scale)
+{
+    if (axes == 0 || axes > N_AXIS_SAMPLED) {
+        return false;
     }
 
-    imu_data[0] = acc_data[0] * CONVERT_G_TO_MS2;
-    imu_data[1] = acc_data[1] * CONVERT_G_TO_MS2;
-    imu_data[2] = acc_data[2] * CONVERT_G_TO_MS2;
+    window->buffer = buffer;
+    window->samples = samples;
+    window->axes = axes;
+    window->count = 0;
+    window->scale = scale;
+    window->acc_scale = raw_acc_scale() * scale;
+
+    return true;
+}
+
+/**
+ * @brief      Wait for the next sample and store it in the window, every axis
+ *             in its own row. Conversion and scale are one multiply per value.
+ *
+ * @return     0 on success, -1 if the window is full, sampling is not started
+ *             or the sensor failed
+ */
+int ei_inertial_read_window(ei_inertial_window_t *window)
+{
+    EI_PROFILER_TRACE_SCOPE("ei_inertial_read_window");
+    raw_sample_t sample;
+
+    if (window->count >= window->samples) {
+        return -1;
+    }
+
+    if (read_raw_sample(&sample) != 0) {
+        return -1;
+    }
+
+    float *out = window->buffer + window->count;
+    for (uint32_t ax = 0; ax < window->axes; ax++) {
+        out[ax * window->samples] = (float)sample.data[ax] * (ax < 3 ? window->acc_scale : window->scale);
+    }
+    window->count++;
+
+    return 0;
+}
+
+/**
+ * @brief      Get data from sensor, convert and call callback to handle
+ */
+int ei_inertial_read_data(void)
+{
+    EI_PROFILER_TRACE_SCOPE("ei_inertial_read_data");
+    ei_inertial_sample_t sample;
+
+    if (ei_inertial_read_sample(&sample) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < N_AXIS_SAMPLED; i++) {
+        imu_data[i] = sample.data[i];
+    }
 
     cb_sampler((const void *)&imu_data[0], SIZEOF_N_AXIS_SAMPLED);
 
@@ -71,25 +336,137 @@ int ei_inertial_read_data(void)
 }
 
 /**
- * @brief      Setup timing and data handle callback function
+ * @brief      Setup data handle callback function and start the sample timer.
+ *             Samples are taken at sample_interval_ms from now on, also while
+ *             the caller is busy, until ei_inertial_sample_stop is called.
  *
  * @param[in]  callsampler         Function to handle the sampled data
  * @param[in]  sample_interval_ms  The sample interval milliseconds
  *
- * @return     true
+ * @return     false if the sample timer could not be started
  */
 bool ei_inertial_sample_start(sampler_callback callsampler, float sample_interval_ms)
 {
+    uint32_t interval_us = (uint32_t)((sample_interval_ms * 1000.f) + 0.5f);
+    uint32_t timer_us = interval_us;
+
+    ei_inertial_sample_stop();
+
     cb_sampler = callsampler;
+    sample_ring.reset();
+    dropped_samples = 0;
+    sensor_error = false;
+    sample_interval_us = interval_us;
+
+    if (interval_us == 0) {
+        ei_printf("ERR: Invalid sample interval\r\n");
+        return false;
+    }
 
-    samplerate_divider = (int)(sample_interval_ms / ACC_SAMPLE_TIME_MS);
-    samplerate_divider += ((int)sample_interval_ms);
+    /* If the sensor can sample at this rate itself, only wake up to drain its buffer */
+    uint32_t watermark = (BURST_PERIOD_MS * 1000) / interval_us;
+    if (watermark > (BURST_MAX_SAMPLES / 2)) {
+        watermark = BURST_MAX_SAMPLES / 2;
+    }
+    burst_mode = (watermark > 1) && sensor_buffer_start(1000.f / sample_interval_ms, watermark);
+    if (burst_mode) {
+        timer_us = interval_us * watermark;
+    }
 
+    if (sample_timer_start(timer_us, &inertial_sample_tick) == false) {
+        ei_printf("ERR: Failed to start the sample timer\r\n");
+        ei_inertial_sample_stop();
+        return false;
+    }
+
+    sampling = true;
     EiDevice.set_state(eiStateSampling);
 
     return true;
 }
 
+/**
+ * @brief      Stop the sample timer, samples still queued are discarded
+ */
+void ei_inertial_sample_stop(void)
+{
+    if (sampling) {
+        sample_timer_stop();
+        sampling = false;
+    }
+
+    if (burst_mode) {
+        sensor_buffer_stop();
+        burst_mode = false;
+    }
+}
+
+/**
+ * @brief      Number of samples lost since ei_inertial_sample_start because
+ *             the reader did not keep up with the sample timer
+ */
+uint32_t ei_inertial_get_dropped_samples(void)
+{
+    return __atomic_load_n(&dropped_samples, __ATOMIC_RELAXED);
+}
+
+#if defined(EI_INERTIAL_SIMULATED_CLOCK) && (EI_INERTIAL_SIMULATED_CLOCK == 1)
+/* Simulated sample timer -------------------------------------------------- */
+static uint64_t sim_time_us;
+static uint64_t sim_next_tick_us;
+static uint32_t sim_interval_us;
+static void (*sim_tick)(void);
+
+static bool sample_timer_start(uint32_t interval_us, void (*tick)(void))
+{
+    sim_interval_us = interval_us;
+    sim_next_tick_us = sim_time_us + interval_us;
+    sim_tick = tick;
+
+    return true;
+}
+
+static void sample_timer_stop(void)
+{
+    sim_tick = NULL;
+}
+
+/* Nothing else runs the clock while the reader is waiting, jump to the next period */
+static void sample_timer_wait(void)
+{
+    if (sim_tick) {
+        ei_inertial_sim_advance_us(sim_next_tick_us - sim_time_us);
+    }
+}
+
+static uint64_t sample_timer_now_us(void)
+{
+    return sim_time_us;
+}
+
+/**
+ * @brief      Advance the simulated clock, firing the sample timer for every
+ *             period that passes. Use it to model time spent in DSP or inference.
+ */
+void ei_inertial_sim_advance_us(uint64_t time_us)
+{
+    uint64_t end_us = sim_time_us + time_us;
+
+    while (sim_tick && sim_next_tick_us <= end_us) {
+        sim_time_us = sim_next_tick_us;
+        sim_next_tick_us += sim_interval_us;
+        sim_tick();
+    }
+
+    sim_time_us = end_us;
+}
+
+uint64_t ei_inertial_sim_get_time_us(void)
+{
+    return sim_time_us;
+}
+#endif
+
 /**
  * @brief      Setup payload header
  *
@@ -111,7 +488,10 @@ bool ei_inertial_setup_data_sampling(void)
         ei_config_get_config()->sample_interval_ms,
         // The axes which you'll use. The units field needs to comply to SenML units (see https://www.iana.org/assignments/senml/senml.xhtml)
         { { "accX", "m/s2" }, { "accY", "m/s2" }, { "accZ", "m/s2" },
-          /*{ "gyrX", "dps" }, { "gyrY", "dps" }, { "gyrZ", "dps" } */ },
+#if N_AXIS_SAMPLED == 6
+          { "gyrX", "dps" }, { "gyrY", "dps" }, { "gyrZ", "dps" }
+#endif
+        },
     };
 
     EiDevice.set_state(eiStateErasingFlash);
@@ -119,4 +499,4 @@ bool ei_inertial_setup_data_sampling(void)
     EiDevice.set_state(eiStateIdle);
 
     return true;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -24,17 +24,75 @@
 #define EI_INERTIAL_SENSOR
 
 /* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
 #include "ei_sampler.h"
 
+/** Sensors the inertial sampler can read from */
+#define EI_INERTIAL_DEVICE_KX126        1
+#define EI_INERTIAL_DEVICE_LSM6DSO32    2
+
+#ifndef EI_INERTIAL_DEVICE
+#define EI_INERTIAL_DEVICE      EI_INERTIAL_DEVICE_KX126
+#endif
+
+/** Queue raw sensor counts instead of g, for the fixed-point DSP path */
+#ifndef EI_INERTIAL_RAW_COUNTS
+#define EI_INERTIAL_RAW_COUNTS  0
+#endif
+
+#if EI_INERTIAL_RAW_COUNTS == 1 && EI_INERTIAL_DEVICE != EI_INERTIAL_DEVICE_KX126
+#error "EI_INERTIAL_RAW_COUNTS is only supported on the KX126"
+#endif
+
 /** Number of axis used and sample data format */
 typedef float sample_format_t;
+#if EI_INERTIAL_DEVICE == EI_INERTIAL_DEVICE_LSM6DSO32
+#define N_AXIS_SAMPLED			6
+#else
 #define N_AXIS_SAMPLED			3
+#endif
 #define SIZEOF_N_AXIS_SAMPLED	(sizeof(sample_format_t) * N_AXIS_SAMPLED)
 
+/** Number of samples buffered between the sample timer and the reader, power of 2 */
+#ifndef EI_INERTIAL_RING_SIZE
+#define EI_INERTIAL_RING_SIZE	256
+#endif
+
+/** One timestamped sample as taken by the sample timer */
+typedef struct {
+    uint64_t timestamp_us;
+    sample_format_t data[N_AXIS_SAMPLED];
+} ei_inertial_sample_t;
+
+/** Window that ei_inertial_read_window fills with one row per axis */
+typedef struct {
+    float *buffer;              // axes * samples values
+    uint32_t samples;           // samples per axis
+    uint32_t axes;              // first axes of every sample that are kept
+    uint32_t count;             // samples in the window so far
+    float scale;                // multiplier on top of m/s2 (acceleration) and the sensor units
+    float acc_scale;            // sensor units to m/s2 and scale as one constant
+} ei_inertial_window_t;
+
 
 /* Function prototypes ----------------------------------------------------- */
 int ei_inertial_read_data(void);
+int ei_inertial_read_sample(ei_inertial_sample_t *sample);
+bool ei_inertial_window_init(ei_inertial_window_t *window, float *buffer, uint32_t samples, uint32_t axes, float scale);
+int ei_inertial_read_window(ei_inertial_window_t *window);
+#if EI_INERTIAL_RAW_COUNTS == 1
+int ei_inertial_read_counts(int16_t *counts, uint32_t axes);
+float ei_inertial_count_scale(void);
+#endif
 bool ei_inertial_sample_start(sampler_callback callback, float sample_interval_ms);
+void ei_inertial_sample_stop(void);
+uint32_t ei_inertial_get_dropped_samples(void);
 bool ei_inertial_setup_data_sampling(void);
 
-#endif
\ No newline at end of file
+#if defined(EI_INERTIAL_SIMULATED_CLOCK) && (EI_INERTIAL_SIMULATED_CLOCK == 1)
+void ei_inertial_sim_advance_us(uint64_t time_us);
+uint64_t ei_inertial_sim_get_time_us(void);
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,285 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+
+#include "ei_lsm6dso32.h"
+#include "ei_device_sony_spresense.h"
+#include "../libraries/Lsm6dso32/Lsm6dso32.h"
+#include "../libraries/I2c/I2c.h"
+
+/* Constant defines -------------------------------------------------------- */
+#define ACC_G_PER_LSB       (0.122f / 1000.f)   // +/-4 g full scale
+#define GYR_DPS_PER_LSB     (70.f / 1000.f)     // +/-2000 dps full scale
+
+#define FIFO_WORD_SIZE      7                   // tag + x, y, z
+#define FIFO_TAG_SHIFT      3
+#define FIFO_MAX_WORDS      128                 // per burst read
+
+/* Private variables ------------------------------------------------------- */
+static stmdev_ctx_t dev_ctx;
+static bool initialised = false;
+static bool running = false;
+
+static uint8_t fifo_raw[FIFO_MAX_WORDS * FIFO_WORD_SIZE];
+static float fifo_acc[3];
+static float fifo_gyr[3];
+static bool fifo_have_acc;
+static bool fifo_have_gyr;
+static uint32_t fifo_overruns;
+
+/** Output data rates shared by accelerometer, gyroscope and FIFO batching (enum value = index + 1) */
+static const float odr_table[] = { 12.5f, 26.f, 52.f, 104.f, 208.f, 417.f, 833.f, 1667.f, 3333.f, 6667.f };
+
+static inline int16_t get_int16(const uint8_t *data)
+{
+    return (int16_t)(((uint16_t)data[1] << 8) | data[0]);
+}
+
+/**
+ * @brief      Reset the sensor and set full scales. Output data rate stays off
+ *             until a read or FIFO mode is started.
+ *
+ * @return     false if the sensor does not answer
+ */
+bool ei_lsm6dso32_init(void)
+{
+    uint8_t whoami = 0;
+    uint8_t rst;
+
+    if (initialised) {
+        return true;
+    }
+
+    i2c_init();
+    i2c_set_freq(TWI_FREQ_400KHZ);
+
+    lsm6dso32_device_id_get(&dev_ctx, &whoami);
+    if (whoami != LSM6DSO32_ID) {
+        ei_printf("ERR: Can't find LSM6DSO32 (0x%X)\r\n", whoami);
+        return false;
+    }
+
+    lsm6dso32_reset_set(&dev_ctx, PROPERTY_ENABLE);
+    do {
+        lsm6dso32_reset_get(&dev_ctx, &rst);
+    } while (rst);
+
+    lsm6dso32_i3c_disable_set(&dev_ctx, LSM6DSO32_I3C_DISABLE);
+    lsm6dso32_block_data_update_set(&dev_ctx, PROPERTY_ENABLE);
+    lsm6dso32_xl_full_scale_set(&dev_ctx, LSM6DSO32_4g);
+    lsm6dso32_gy_full_scale_set(&dev_ctx, LSM6DSO32_2000dps);
+
+    initialised = true;
+
+    return true;
+}
+
+/**
+ * @brief      Read the latest sample from the output registers
+ *
+ * @param      data  EI_LSM6DSO32_AXES values
+ *
+ * @return     0 on success
+ */
+int ei_lsm6dso32_read(float *data)
+{
+    uint8_t raw[12];
+
+    if (ei_lsm6dso32_init() == false) {
+        return -1;
+    }
+
+    /* Run at 833 Hz when polled, so any timer rate below it sees fresh data */
+    if (running == false) {
+        lsm6dso32_xl_data_rate_set(&dev_ctx, LSM6DSO32_XL_ODR_833Hz_HIGH_PERF);
+        lsm6dso32_gy_data_rate_set(&dev_ctx, LSM6DSO32_GY_ODR_833Hz_HIGH_PERF);
+        running = true;
+    }
+
+    /* OUTX_L_G .. OUTZ_H_A in one read */
+    if (lsm6dso32_read_reg(&dev_ctx, LSM6DSO32_OUTX_L_G, raw, sizeof(raw)) != 0) {
+        return -1;
+    }
+
+    data[0] = get_int16(&raw[6]) * ACC_G_PER_LSB;
+    data[1] = get_int16(&raw[8]) * ACC_G_PER_LSB;
+    data[2] = get_int16(&raw[10]) * ACC_G_PER_LSB;
+    data[3] = get_int16(&raw[0]) * GYR_DPS_PER_LSB;
+    data[4] = get_int16(&raw[2]) * GYR_DPS_PER_LSB;
+    data[5] = get_int16(&raw[4]) * GYR_DPS_PER_LSB;
+
+    return 0;
+}
+
+/**
+ * @brief      Batch accelerometer and gyroscope into the hardware FIFO at odr_hz
+ *
+ * @param[in]  odr_hz     Sample rate, must be one of the sensor output data rates
+ * @param[in]  watermark  FIFO level in samples (accelerometer + gyroscope pairs)
+ *
+ * @return     false if the rate is not supported or the sensor does not answer
+ */
+bool ei_lsm6dso32_fifo_start(float odr_hz, uint16_t watermark)
+{
+    int odr_ix = -1;
+
+    for (size_t i = 0; i < sizeof(odr_table) / sizeof(odr_table[0]); i++) {
+        float diff = odr_hz - odr_table[i];
+        if (diff < 0.f) {
+            diff = -diff;
+        }
+        if (diff <= odr_table[i] * 0.01f) {
+            odr_ix = (int)i + 1;
+            break;
+        }
+    }
+
+    if (odr_ix < 0 || ei_lsm6dso32_init() == false) {
+        return false;
+    }
+
+    fifo_have_acc = false;
+    fifo_have_gyr = false;
+    fifo_overruns = 0;
+
+    /* Going through bypass empties the FIFO */
+    int32_t ret = lsm6dso32_fifo_mode_set(&dev_ctx, LSM6DSO32_BYPASS_MODE);
+    ret |= lsm6dso32_fifo_watermark_set(&dev_ctx, watermark * 2);
+    ret |= lsm6dso32_fifo_xl_batch_set(&dev_ctx, (lsm6dso32_bdr_xl_t)odr_ix);
+    ret |= lsm6dso32_fifo_gy_batch_set(&dev_ctx, (lsm6dso32_bdr_gy_t)odr_ix);
+    ret |= lsm6dso32_fifo_temp_batch_set(&dev_ctx, LSM6DSO32_TEMP_NOT_BATCHED);
+    ret |= lsm6dso32_fifo_timestamp_decimation_set(&dev_ctx, LSM6DSO32_NO_DECIMATION);
+    ret |= lsm6dso32_fifo_mode_set(&dev_ctx, LSM6DSO32_STREAM_MODE);
+    ret |= lsm6dso32_xl_data_rate_set(&dev_ctx, (lsm6dso32_odr_xl_t)odr_ix);
+    ret |= lsm6dso32_gy_data_rate_set(&dev_ctx, (lsm6dso32_odr_g_t)odr_ix);
+    running = true;
+
+    return ret == 0;
+}
+
+/**
+ * @brief      Drain the FIFO in one burst and pair the tagged accelerometer and
+ *             gyroscope words into samples. A half pair is kept for the next call.
+ *
+ * @param      data         Room for max_samples * EI_LSM6DSO32_AXES values
+ * @param[in]  max_samples  The maximum samples
+ *
+ * @return     Number of samples, negative on error
+ */
+int ei_lsm6dso32_fifo_read(float *data, uint16_t max_samples)
+{
+    uint8_t status[2];
+    uint32_t words;
+    int count = 0;
+
+    if (max_samples == 0) {
+        return 0;
+    }
+
+    /* FIFO_STATUS1 and FIFO_STATUS2 */
+    if (lsm6dso32_read_reg(&dev_ctx, LSM6DSO32_FIFO_STATUS1, status, sizeof(status)) != 0) {
+        return -1;
+    }
+
+    lsm6dso32_fifo_status2_t *status2 = (lsm6dso32_fifo_status2_t *)&status[1];
+    words = ((uint32_t)status2->diff_fifo << 8) | status[0];
+
+    if (status2->fifo_ovr_ia) {
+        /* Oldest words were overwritten, don't pair across the gap */
+        fifo_overruns++;
+        fifo_have_acc = false;
+        fifo_have_gyr = false;
+    }
+
+    /* Every two words can complete a sample, plus one for a pending half pair */
+    if (words > ((uint32_t)max_samples * 2) - 1) {
+        words = ((uint32_t)max_samples * 2) - 1;
+    }
+    if (words > FIFO_MAX_WORDS) {
+        words = FIFO_MAX_WORDS;
+    }
+    if (words == 0) {
+        return 0;
+    }
+
+    /* The address wraps from FIFO_DATA_OUT_Z_H back to FIFO_DATA_OUT_TAG */
+    if (i2c_read_regs_burst(LSM6DSO32_I2C_ADD, LSM6DSO32_FIFO_DATA_OUT_TAG, fifo_raw, words * FIFO_WORD_SIZE) != TWI_SUCCESS) {
+        return -1;
+    }
+
+    for (uint32_t w = 0; w < words; w++) {
+        const uint8_t *word = &fifo_raw[w * FIFO_WORD_SIZE];
+
+        switch (word[0] >> FIFO_TAG_SHIFT) {
+            case LSM6DSO32_XL_NC_TAG:
+                fifo_acc[0] = get_int16(&word[1]) * ACC_G_PER_LSB;
+                fifo_acc[1] = get_int16(&word[3]) * ACC_G_PER_LSB;
+                fifo_acc[2] = get_int16(&word[5]) * ACC_G_PER_LSB;
+                fifo_have_acc = true;
+                break;
+            case LSM6DSO32_GYRO_NC_TAG:
+                fifo_gyr[0] = get_int16(&word[1]) * GYR_DPS_PER_LSB;
+                fifo_gyr[1] = get_int16(&word[3]) * GYR_DPS_PER_LSB;
+                fifo_gyr[2] = get_int16(&word[5]) * GYR_DPS_PER_LSB;
+                fifo_have_gyr = true;
+                break;
+            default:
+                /* Config change, timestamp, temperature.. are not batched, skip */
+                break;
+        }
+
+        if (fifo_have_acc && fifo_have_gyr) {
+            float *sample = &data[count * EI_LSM6DSO32_AXES];
+            memcpy(&sample[0], fifo_acc, sizeof(fifo_acc));
+            memcpy(&sample[3], fifo_gyr, sizeof(fifo_gyr));
+            fifo_have_acc = false;
+            fifo_have_gyr = false;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief      Stop batching and power down, back to polled reads
+ */
+void ei_lsm6dso32_fifo_stop(void)
+{
+    lsm6dso32_fifo_mode_set(&dev_ctx, LSM6DSO32_BYPASS_MODE);
+    lsm6dso32_fifo_xl_batch_set(&dev_ctx, LSM6DSO32_XL_NOT_BATCHED);
+    lsm6dso32_fifo_gy_batch_set(&dev_ctx, LSM6DSO32_GY_NOT_BATCHED);
+    lsm6dso32_xl_data_rate_set(&dev_ctx, LSM6DSO32_XL_ODR_OFF);
+    lsm6dso32_gy_data_rate_set(&dev_ctx, LSM6DSO32_GY_ODR_OFF);
+    running = false;
+}
+
+/**
+ * @brief      Number of FIFO overruns seen since ei_lsm6dso32_fifo_start
+ */
+uint32_t ei_lsm6dso32_get_fifo_overruns(void)
+{
+    return fifo_overruns;
+}
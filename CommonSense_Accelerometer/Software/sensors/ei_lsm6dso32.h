@@ -0,0 +1,41 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EI_LSM6DSO32_H
+#define EI_LSM6DSO32_H
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Values per sample: accX, accY, accZ in g, gyrX, gyrY, gyrZ in dps */
+#define EI_LSM6DSO32_AXES      6
+
+/* Function prototypes ----------------------------------------------------- */
+bool ei_lsm6dso32_init(void);
+int ei_lsm6dso32_read(float *data);
+bool ei_lsm6dso32_fifo_start(float odr_hz, uint16_t watermark);
+int ei_lsm6dso32_fifo_read(float *data, uint16_t max_samples);
+void ei_lsm6dso32_fifo_stop(void);
+uint32_t ei_lsm6dso32_get_fifo_overruns(void);
+
+#endif
@@ -154,7 +154,7 @@ static void get_dsp_data(void (*callback)(void *buffer, uint32_t n_bytes))
 
     // callback((void *)&audio_buffer[0], length * sizeof(short));
 
-    size_t length;
+    unsigned int length;
     if(spresense_getAudio((char *)&audio_buffer[0], &length)) {
         callback((void *)&audio_buffer[0], length);
     }
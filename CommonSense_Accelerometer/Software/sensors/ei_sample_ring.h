@@ -0,0 +1,109 @@
+/* Edge Impulse ingestion SDK
+ * Copyright (c) 2020 EdgeImpulse Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EI_SAMPLE_RING_H
+#define EI_SAMPLE_RING_H
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief      Lock-free single-producer / single-consumer ring buffer.
+ *
+ * One context (timer thread, data-ready handler) may call push(), one other
+ * context may call pop(). Head and tail are free running counters, so the
+ * ring holds the full N elements. N must be a power of two.
+ */
+template<typename T, uint32_t N>
+class EiSampleRing {
+public:
+    EiSampleRing() : _head(0), _tail(0) { }
+
+    /**
+     * @brief      Empty the ring. Only call while the producer is stopped.
+     */
+    void reset(void)
+    {
+        __atomic_store_n(&_tail, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&_head, 0, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * @brief      Add an element (producer side)
+     *
+     * @return     false if the ring is full, the element is not stored
+     */
+    bool push(const T &item)
+    {
+        uint32_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        uint32_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+
+        if ((uint32_t)(head - tail) >= N) {
+            return false;
+        }
+
+        _buffer[head & (N - 1)] = item;
+        __atomic_store_n(&_head, head + 1, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+    /**
+     * @brief      Remove the oldest element (consumer side)
+     *
+     * @return     false if the ring is empty
+     */
+    bool pop(T *item)
+    {
+        uint32_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+        uint32_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+
+        if (head == tail) {
+            return false;
+        }
+
+        *item = _buffer[tail & (N - 1)];
+        __atomic_store_n(&_tail, tail + 1, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+    /**
+     * @brief      Number of elements waiting, safe to call from either side
+     */
+    uint32_t count(void) const
+    {
+        return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+    }
+
+    static uint32_t capacity(void) { return N; }
+
+private:
+    static_assert(N != 0 && (N & (N - 1)) == 0, "EiSampleRing size must be a power of two");
+
+    T _buffer[N];
+    uint32_t _head;
+    uint32_t _tail;
+};
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ * Console transmit buffer: writes are copied into a ring and a low priority
+ * thread moves them to the UART while the application waits.
+ *
+ * Include once, from the file that owns the UART. Define before including:
+ * - UART_TX_FIFO_FULL()  non-zero while the transmit FIFO is full
+ * - UART_TX_BUSY()       non-zero while the UART is still sending
+ * - UART_TX_PUT(byte)    write one byte to the transmit FIFO
+ * and provide spresense_putchar(), enter_critical_section() and
+ * leave_critical_section(). Host benchmarks run it against a simulated UART.
+ */
+
+#ifndef _UART_TX_H_
+#define _UART_TX_H_
+
+/* Include ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/* Constant defines -------------------------------------------------------- */
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE     4096
+#endif
+#ifndef UART_TX_PRIORITY
+#define UART_TX_PRIORITY        50
+#endif
+#ifndef UART_TX_STACK_SIZE
+#define UART_TX_STACK_SIZE      1024
+#endif
+
+/* Extern reference -------------------------------------------------------- */
+void spresense_putchar(char byte);
+
+/* Private variables ------------------------------------------------------- */
+static char uart_tx_buffer[UART_TX_BUFFER_SIZE];
+static uint32_t uart_tx_head = 0;           /* Free running, written by callers */
+static uint32_t uart_tx_tail = 0;           /* Free running, moved to the UART */
+static pthread_t uart_tx_pid;
+static bool uart_tx_running = false;
+static sem_t uart_tx_sem;
+static bool uart_tx_drop_when_full = false;
+static uint32_t uart_tx_dropped = 0;
+
+/* Private functions ------------------------------------------------------- */
+
+/**
+ * @brief Move buffered bytes to the UART until its FIFO is full.
+ * Call from a critical section.
+ *
+ * @return true when the transmit buffer is empty
+ */
+static bool uart_tx_fill_fifo(void)
+{
+    while (uart_tx_tail != uart_tx_head) {
+        if (UART_TX_FIFO_FULL()) {
+            return false;
+        }
+        UART_TX_PUT(uart_tx_buffer[uart_tx_tail % UART_TX_BUFFER_SIZE]);
+        uart_tx_tail++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Console transmit thread. Runs below the application, so it keeps the
+ * UART FIFO topped up whenever the application waits (sample timer, input)
+ */
+static void *uart_tx_daemon(void *arg)
+{
+    (void)arg;
+
+    for (; ; ) {
+        sem_wait(&uart_tx_sem);
+
+        bool empty = false;
+        while (!empty) {
+            irqstate_t flags = enter_critical_section();
+            empty = uart_tx_fill_fifo();
+            leave_critical_section(flags);
+
+            /* Wait for room outside the critical section */
+            while (!empty && UART_TX_FIFO_FULL());
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Start the console transmit thread. Until it runs, writes go straight
+ * to the UART
+ */
+static void start_uart_tx(void)
+{
+    struct sched_param param;
+    pthread_attr_t attr;
+
+    sem_init(&uart_tx_sem, 0, 0);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, UART_TX_STACK_SIZE);
+    param.sched_priority = UART_TX_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+
+    if (pthread_create(&uart_tx_pid, &attr, uart_tx_daemon, NULL) != 0) {
+        return;
+    }
+    pthread_setname_np(uart_tx_pid, "uart_tx");
+    uart_tx_running = true;
+}
+
+/* Public functions -------------------------------------------------------- */
+
+/**
+ * @brief Queue data for the console UART without waiting for it to be sent.
+ * When the buffer is full the caller waits for the UART, or with the drop
+ * policy the whole write is dropped (so lines don't get cut up)
+ *
+ * @param data
+ * @param length in bytes
+ * @return number of bytes queued
+ */
+uint32_t spresense_writeBuffered(const char *data, uint32_t length)
+{
+    uint32_t written = 0;
+    int sem_value;
+
+    if (!uart_tx_running) {
+        for (uint32_t i = 0; i < length; i++) {
+            spresense_putchar(data[i]);
+        }
+        return length;
+    }
+
+    while (written < length) {
+        irqstate_t flags = enter_critical_section();
+
+        uint32_t space = UART_TX_BUFFER_SIZE - (uart_tx_head - uart_tx_tail);
+        if (uart_tx_drop_when_full && (space < length)) {
+            uart_tx_dropped += length;
+            leave_critical_section(flags);
+            return 0;
+        }
+
+        uint32_t n_bytes = length - written;
+        if (n_bytes > space) {
+            n_bytes = space;
+        }
+
+        uint32_t index = uart_tx_head % UART_TX_BUFFER_SIZE;
+        uint32_t first = UART_TX_BUFFER_SIZE - index;
+        if (first > n_bytes) {
+            first = n_bytes;
+        }
+        memcpy(&uart_tx_buffer[index], &data[written], first);
+        memcpy(&uart_tx_buffer[0], &data[written + first], n_bytes - first);
+        uart_tx_head += n_bytes;
+        written += n_bytes;
+
+        /* Short writes leave right away through the FIFO */
+        uart_tx_fill_fifo();
+
+        leave_critical_section(flags);
+
+        if (written < length) {
+            /* Buffer full, wait for the UART like an unbuffered write would */
+            while (UART_TX_FIFO_FULL());
+        }
+    }
+
+    if ((uart_tx_head != uart_tx_tail) &&
+        (sem_getvalue(&uart_tx_sem, &sem_value) == 0) && (sem_value <= 0)) {
+        sem_post(&uart_tx_sem);
+    }
+
+    return written;
+}
+
+/**
+ * @brief Wait until everything queued has left the UART
+ */
+void spresense_flushTx(void)
+{
+    bool empty = false;
+
+    while (!empty) {
+        irqstate_t flags = enter_critical_section();
+        empty = uart_tx_fill_fifo();
+        leave_critical_section(flags);
+    }
+
+    while (UART_TX_BUSY());
+}
+
+/**
+ * @brief Select what spresense_writeBuffered does when the buffer is full
+ *
+ * @param drop true: drop the write, false: wait for the UART
+ */
+void spresense_setTxDropWhenFull(bool drop)
+{
+    uart_tx_drop_when_full = drop;
+}
+
+/**
+ * @brief Number of bytes dropped because the transmit buffer was full
+ */
+uint32_t spresense_getTxDropped(void)
+{
+    return uart_tx_dropped;
+}
+
+#endif // _UART_TX_H_